@@ -1,3 +1,13 @@
+INTERFACE [mp]:
+
+#include <globalconfig.h>
+
+enum { Tbuf_max_rings = CONFIG_MP_MAX_CPUS };
+
+INTERFACE [!mp]:
+
+enum { Tbuf_max_rings = 1 };
+
 INTERFACE:
 
 #include "types.h"
@@ -28,9 +38,33 @@ enum {
   Kern_cnt_schedule          = 9,
   Kern_cnt_iobmap_tlb_flush  = 10,
   Kern_cnt_exc_ipc           = 11,
+  Kern_cnt_xcpu_tlb_flush    = 12,
+  Kern_cnt_tlb_flush_range   = 13,
+  Kern_cnt_drq               = 14,
+  Kern_cnt_rcu_batch         = 15,
+  Kern_cnt_slab_alloc        = 16,
+  Kern_cnt_timeout           = 17,
+  Kern_cnt_pf_around         = 18,
+  Kern_cnt_pf_around_pages   = 19,
   Kern_cnt_max
 };
 
+/** Kernel event counters of one CPU.  Only the owning CPU writes its
+    block, readers sum up the blocks of all CPUs without locking. */
+struct Tracebuffer_kern_cnt
+{
+  Mword cnt[Kern_cnt_max];
+} __attribute__((aligned(64)));
+
+/** Per-CPU trace ring as seen by user level.  Each ring is split into
+    two halves; version[i] is incremented whenever half i was filled. */
+struct Tracebuffer_status_ring
+{
+  Address    tracebuffer;
+  Unsigned32 size;
+  Unsigned32 version[2];
+};
+
 struct Tracebuffer_status_window
 {
   Address    tracebuffer;
@@ -48,5 +82,27 @@ struct Tracebuffer_status
   Unsigned32 scaler_tsc_to_us;
   Unsigned32 scaler_ns_to_tsc;
 
-  Unsigned32 kerncnts[Kern_cnt_max];
+  /* per-CPU counter blocks (Tracebuffer_kern_cnt), one for each ring;
+     kerncnt_area is the physical address of the first block and the
+     whole area is 1 << kerncnt_order bytes */
+  Address    kerncnt_area;
+  Unsigned32 kerncnt_order;
+  Unsigned32 kerncnt_stride;
+
+  /* window[] and current describe the ring of the boot CPU */
+  Unsigned32                num_rings;
+  Tracebuffer_status_ring   rings[Tbuf_max_rings];
+};
+
+/** Consumer state of one ring for a collector that streams the trace
+    buffer out (Jdb_tbuf_export).  The collector provides one of these
+    per ring in its kernel-user memory.  head and tail are free-running
+    entry counters: entry n of a ring is in slot n % (size / entry size)
+    of Tracebuffer_status_ring::tracebuffer. */
+struct Tracebuffer_export_ring
+{
+  Mword head;     ///< entries committed, written by the kernel
+  Mword tail;     ///< entries consumed, written by the collector
+  Mword dropped;  ///< entries overwritten before they were consumed
+  Mword notified; ///< high-watermark IRQs raised for this ring
 };
@@ -202,14 +202,15 @@ Jdb::handle_int3_threadctx_generic(Trap_state *ts)
 	    }
 	  break;
 	case 30:
-#if 0
+	  // only the kernel's symbols and lines can be registered, see
+	  // Jdb_symbol::lookup()
 	  switch (ts->value2())
 	    {
 	    case 1: // fiasco_register_symbols
 		{
 		  Jdb_symbols_frame *regs =
 		    reinterpret_cast<Jdb_symbols_frame*>(ts);
-		  Jdb_dbinfo::set(Jdb_symbol::lookup(Kobject::dcast<Task*>(os->lookup(regs->task()))),
+		  Jdb_dbinfo::set(Jdb_symbol::lookup(0),
 				  regs->addr(), regs->size());
 		}
 	      break;
@@ -217,12 +218,11 @@ Jdb::handle_int3_threadctx_generic(Trap_state *ts)
 		{
 		  Jdb_lines_frame *regs =
 		    reinterpret_cast<Jdb_lines_frame*>(ts);
-		  Jdb_dbinfo::set(Jdb_lines::lookup(regs->task()),
+		  Jdb_dbinfo::set(Jdb_lines::lookup(0),
 				  regs->addr(), regs->size());
 		}
 	      break;
 	    }
-#endif
 	  break;
 	default: // ko
 	  if (todo < ' ')
@@ -188,11 +188,17 @@ Jdb_kobject_irq::show_kobject_short(char *buf, int max, Kobject_common *o)
   Kobject_common *w = follow_link(o);
   Irq_sender *t = Jdb_kobject_irq::dcast<Irq_sender*>(o);
 
-  return snprintf(buf, max, " I=%3lx %s L=%lx T=%lx F=%x Q=%d",
-                  i->pin(), i->chip()->chip_type(), i->obj_id(),
-                  w != o ?  w->dbg_info()->dbg_id() : 0,
-		  (unsigned)i->flags(),
-                  t ? t->queued() : -1);
+  int l = snprintf(buf, max, " I=%3lx %s L=%lx T=%lx F=%x Q=%d",
+                   i->pin(), i->chip()->chip_type(), i->obj_id(),
+                   w != o ?  w->dbg_info()->dbg_id() : 0,
+                   (unsigned)i->flags(),
+                   t ? t->queued() : -1);
+
+  Mword hits, msgs;
+  if (t && t->coalesce_stats(&hits, &msgs) && l < max)
+    l += snprintf(buf + l, max - l, " C=%lu/%lu", hits, msgs);
+
+  return l;
 }
 
 static
@@ -3,6 +3,7 @@ IMPLEMENTATION:
 #include <cstdio>
 #include <cstring>
 #include "config.h"
+#include "cpu.h"
 #include "jdb_tbuf.h"
 #include "jdb_module.h"
 #include "kern_cnt.h"
@@ -24,8 +25,20 @@ void
 Jdb_counters::show()
 {
   putchar('\n');
+  printf("  %-25s%12s", "", "total");
+  for (Cpu_number c = Cpu_number::first(); c < Config::max_num_cpus(); ++c)
+    if (Cpu::online(c))
+      printf("  %8s%-2u", "CPU", cxx::int_value<Cpu_number>(c));
+  putchar('\n');
+
   for (unsigned i=0; i<Kern_cnt_max; i++)
-    printf("  %-25s%10ld\n", Kern_cnt::get_str(i), *Kern_cnt::get_ctr(i));
+    {
+      printf("  %-25s%12lu", Kern_cnt::get_str(i), Kern_cnt::sum(i));
+      for (Cpu_number c = Cpu_number::first(); c < Config::max_num_cpus(); ++c)
+        if (Cpu::online(c))
+          printf("  %10lu", Kern_cnt::get(c, i));
+      putchar('\n');
+    }
   putchar('\n');
 }
 
@@ -33,8 +46,7 @@ PRIVATE
 void
 Jdb_counters::reset()
 {
-  memset(Jdb_tbuf::status()->kerncnts, 0, 
-         sizeof(Jdb_tbuf::status()->kerncnts));
+  Kern_cnt::reset();
 }
 
 PUBLIC
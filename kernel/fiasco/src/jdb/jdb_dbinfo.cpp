@@ -32,6 +32,29 @@ Jdb_dbinfo::init_symbols_lines ()
       ->unaligned_alloc(p*Config::PAGE_SIZE), p);
 }
 
+// Give `info` memory for its address index.  Without the index, lookups
+// still work but scan all entries.
+PRIVATE static
+template< typename INFO >
+void
+Jdb_dbinfo::set_index(INFO *info)
+{
+  void *mem;
+
+  if (info->index_size() && (mem = alloc_index(info->index_size())))
+    info->set_index(mem);
+}
+
+PRIVATE static
+template< typename INFO >
+void
+Jdb_dbinfo::drop_index(INFO *info)
+{
+  if (info->index())
+    free_index(info->index(), info->index_size());
+  info->clear_index();
+}
+
 
 //---------------------------------------------------------------------------
 IMPLEMENTATION[ia32,amd64]:
@@ -154,6 +177,57 @@ Jdb_dbinfo::return_pages(Address addr, unsigned pages)
 //---------------------------------------------------------------------------
 IMPLEMENTATION[ia32, amd64]:
 
+// An index can be larger than the biggest block of Kmem_alloc, so it
+// consists of single pages that are mapped contiguously in the debug area.
+PRIVATE static
+void *
+Jdb_dbinfo::alloc_index(size_t size)
+{
+  unsigned pages = (size + Config::PAGE_SIZE - 1) / Config::PAGE_SIZE;
+  Address virt = reserve_pages(pages);
+
+  if (!virt)
+    return 0;
+
+  for (unsigned i = 0; i < pages; i++)
+    {
+      void *page = Kmem_alloc::allocator()->alloc(Config::PAGE_SHIFT);
+      if (!page)
+	{
+	  free_pages(virt, i);
+	  unmap(virt, pages * Config::PAGE_SIZE);
+	  return 0;
+	}
+
+      Kmem::kdir->map(Kmem::virt_to_phys(page),
+	  Virt_addr(virt + i * Config::PAGE_SIZE), Virt_size(Config::PAGE_SIZE),
+	  Pt_entry::Valid | Pt_entry::Writable | Pt_entry::Referenced
+	  | Pt_entry::Dirty, Pdir::Depth, false, Ptab::Null_alloc());
+    }
+
+  return (void *)virt;
+}
+
+PRIVATE static
+void
+Jdb_dbinfo::free_pages(Address virt, unsigned pages)
+{
+  for (unsigned i = 0; i < pages; i++)
+    Kmem_alloc::allocator()->free(Config::PAGE_SHIFT,
+	Kmem::phys_to_virt(Kmem::virt_to_phys((void *)(virt
+	                                               + i * Config::PAGE_SIZE))));
+}
+
+PRIVATE static
+void
+Jdb_dbinfo::free_index(void *index, size_t size)
+{
+  unsigned pages = (size + Config::PAGE_SIZE - 1) / Config::PAGE_SIZE;
+
+  free_pages((Address)index, pages);
+  unmap((Address)index, pages * Config::PAGE_SIZE);
+}
+
 PUBLIC static
 bool
 Jdb_dbinfo::map(Address phys, size_t &size, Address &virt)
@@ -199,6 +273,7 @@ Jdb_dbinfo::set(Jdb_symbol_info *sym, Address phys, size_t size)
   if (!sym)
     return;
 
+  drop_index (sym);
   if (!phys)
     {
       sym->get (virt, size);
@@ -217,7 +292,10 @@ Jdb_dbinfo::set(Jdb_symbol_info *sym, Address phys, size_t size)
     {
       unmap (virt, size);
       sym->reset ();
+      return;
     }
+
+  set_index (sym);
 }
 
 PUBLIC static
@@ -229,6 +307,7 @@ Jdb_dbinfo::set(Jdb_lines_info *lin, Address phys, size_t size)
   if (!lin)
     return;
 
+  drop_index(lin);
   if (!phys)
     {
       lin->get(virt, size);
@@ -237,6 +316,7 @@ Jdb_dbinfo::set(Jdb_lines_info *lin, Address phys, size_t size)
 
       unmap(virt, size);
       lin->reset ();
+      return;
     }
 
   if (!map(phys, size, virt))
@@ -246,7 +326,10 @@ Jdb_dbinfo::set(Jdb_lines_info *lin, Address phys, size_t size)
     {
       unmap(virt, size);
       lin->reset();
+      return;
     }
+
+  set_index(lin);
 }
 
 
@@ -270,6 +353,33 @@ Jdb_dbinfo::init()
   init_symbols_lines();
 }
 
+// Indexes beyond the biggest block of Kmem_alloc fall back to scanning.
+PRIVATE static
+unsigned
+Jdb_dbinfo::index_order(size_t size)
+{
+  unsigned order = Config::PAGE_SHIFT;
+
+  while ((1UL << order) < size)
+    order++;
+
+  return order;
+}
+
+PRIVATE static
+void *
+Jdb_dbinfo::alloc_index(size_t size)
+{
+  return Kmem_alloc::allocator()->alloc(index_order(size));
+}
+
+PRIVATE static
+void
+Jdb_dbinfo::free_index(void *index, size_t size)
+{
+  Kmem_alloc::allocator()->free(index_order(size), index);
+}
+
 PUBLIC static
 void
 Jdb_dbinfo::set(Jdb_symbol_info *sym, Address phys, size_t size)
@@ -277,10 +387,11 @@ Jdb_dbinfo::set(Jdb_symbol_info *sym, Address phys, size_t size)
   if (!sym)
     return;
 
+  drop_index(sym);
   if (!phys)
     sym->reset();
-  else
-    sym->set(Mem_layout::phys_to_pmem(phys), size);
+  else if (sym->set(Mem_layout::phys_to_pmem(phys), size))
+    set_index(sym);
 }
 
 PUBLIC static
@@ -290,8 +401,9 @@ Jdb_dbinfo::set(Jdb_lines_info *lin, Address phys, size_t size)
   if (!lin)
     return;
 
+  drop_index(lin);
   if (!phys)
     lin->reset();
-  else
-    lin->set(Mem_layout::phys_to_pmem(phys), size);
+  else if (lin->set(Mem_layout::phys_to_pmem(phys), size))
+    set_index(lin);
 }
@@ -47,9 +47,16 @@ Jdb_ipc_gate::show_kobject_short(char *buf, int max, Kobject_common *o)
   if (!g)
     return 0;
 
-  return snprintf(buf, max, " L=%s%08lx\033[0m D=%lx",
-                  (g->id() & 3) ? JDB_ANSI_COLOR(lightcyan) : "",
-                  g->id(), g->thread() ? g->thread()->dbg_info()->dbg_id() : 0);
+  int len = snprintf(buf, max, " L=%s%08lx\033[0m D=%lx",
+                     (g->id() & 3) ? JDB_ANSI_COLOR(lightcyan) : "",
+                     g->id(),
+                     g->thread() ? g->thread()->dbg_info()->dbg_id() : 0);
+
+  if (Ipc_gate_queue const *q = g->queue())
+    len += snprintf(buf + len, max - len, " Q=%u/%u",
+                    q->depth(), q->slots());
+
+  return len;
 }
 
 PUBLIC
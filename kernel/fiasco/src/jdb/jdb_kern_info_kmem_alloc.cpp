@@ -4,6 +4,7 @@ IMPLEMENTATION:
 #include "jdb_kern_info.h"
 #include "kmem_alloc.h"
 #include "kmem_slab.h"
+#include "zero_page_pool.h"
 
 class Jdb_kern_info_memory : public Jdb_kern_info_module
 {};
@@ -27,7 +28,12 @@ Jdb_kern_info_memory::show()
   // Slab allocators
   for (Iter alloc = Kmem_slab::reap_list.begin();
        alloc != Kmem_slab::reap_list.end(); ++alloc)
-    alloc->debug_dump();
+    {
+      alloc->debug_dump();
+      alloc->debug_dump_magazines();
+    }
+
+  Zero_page_pool::debug_dump();
 }
 
 
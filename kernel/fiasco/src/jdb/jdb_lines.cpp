@@ -17,6 +17,36 @@ private:
   size_t   _size;
   Address  _beg_line;
   Address  _end_line;
+  unsigned _num_lines;
+
+  enum
+  {
+    Header_file = 0xfffd, ///< line of a header file name entry
+    Dir         = 0xfffe, ///< line of a directory entry
+    File        = 0xffff, ///< line of a file name entry
+    No_entry    = ~0U,
+  };
+
+  // a line with its directory and file, as Jdb_lines_line indexes
+  struct Index
+  {
+    Unsigned32 line, dir, file;
+  };
+
+  // all lines sorted by address, see set_index()
+  Index *_index;
+  unsigned _num_index;
+
+  struct Addr_less
+  {
+    Jdb_lines_line const *lin;
+    bool operator () (Index const &a, Index const &b) const
+    {
+      // ties in list order, like the list scan
+      return lin[a.line].addr < lin[b.line].addr
+             || (lin[a.line].addr == lin[b.line].addr && a.line < b.line);
+    }
+  };
 };
 
 class Jdb_lines
@@ -37,6 +67,7 @@ IMPLEMENTATION:
 
 #include <cstdio>
 #include <cstring>
+#include "jdb_util.h"
 #include "panic.h"
 #include "warn.h"
 
@@ -96,6 +127,9 @@ Jdb_lines_info::set (Address virt, size_t size)
 {
   _virt = virt;
   _size = size;
+  _index = 0;
+  _num_index = 0;
+  _num_lines = 0;
 
   Address min_addr = 0xffffffff, max_addr = 0;
   Jdb_lines_line *l;
@@ -103,8 +137,9 @@ Jdb_lines_info::set (Address virt, size_t size)
   // search lines with lowest / highest address
   for (l = lin(); l->addr || l->line; l++)
     {
-      if (l->line < 0xfffd)
+      if (l->line < Header_file)
 	{
+	  _num_lines++;
 	  Address addr = l->addr;
 	  if (addr < min_addr)
 	    min_addr = addr;
@@ -119,22 +154,183 @@ Jdb_lines_info::set (Address virt, size_t size)
   return true;
 }
 
+/// Bytes needed for the address index of the registered lines.
+PUBLIC inline
+size_t
+Jdb_lines_info::index_size () const
+{
+  return _num_lines * sizeof(Index);
+}
+
+PUBLIC inline
+void*
+Jdb_lines_info::index () const
+{
+  return _index;
+}
+
+PUBLIC inline
+void
+Jdb_lines_info::clear_index ()
+{
+  _index = 0;
+  _num_index = 0;
+}
+
+/**
+ * Build the address-sorted index of the registered lines in `mem`
+ * (index_size() bytes) to make address lookups O(log n).  Without an
+ * index, lookups scan the line list.
+ */
+PUBLIC
+void
+Jdb_lines_info::set_index (void *mem)
+{
+  Index *idx = (Index*)mem;
+  Unsigned32 dir = No_entry, file = No_entry, n = 0;
+  Jdb_lines_line *l = lin();
+
+  for (Unsigned32 i = 0; l[i].addr || l[i].line; i++)
+    switch (l[i].line)
+      {
+      case Dir:
+	dir = i;
+	break;
+      case File:
+      case Header_file:
+	file = i;
+	break;
+      default:
+	idx[n].line = i;
+	idx[n].dir  = dir;
+	idx[n].file = file;
+	n++;
+	break;
+      }
+
+  Addr_less less;
+  less.lin = l;
+  Jdb_util::sort(idx, n, less);
+
+  _index = idx;
+  _num_index = n;
+}
+
+PRIVATE inline NOEXPORT
+const char*
+Jdb_lines_info::name (Unsigned32 entry)
+{
+  return entry == No_entry ? "" : str() + lin()[entry].addr;
+}
+
+PRIVATE inline NOEXPORT
+bool
+Jdb_lines_info::shown (Unsigned32 file, int show_header_files)
+{
+  return show_header_files || file == No_entry
+         || lin()[file].line != Header_file;
+}
+
+// number of index entries with an address not above `addr`
+PRIVATE
+unsigned
+Jdb_lines_info::upper_bound (Address addr)
+{
+  unsigned l = 0, r = _num_index;
+
+  while (l < r)
+    {
+      unsigned m = (l + r) / 2;
+      if (lin()[_index[m].line].addr <= addr)
+	l = m + 1;
+      else
+	r = m;
+    }
+
+  return l;
+}
+
+/**
+ * Find the line at `*addr_ptr` or, if `fuzzy`, the last line below it
+ * and set `*addr_ptr` to the address of that line.  Lines of header
+ * files are skipped unless `show_header_files` is set.
+ */
+PUBLIC
+bool
+Jdb_lines_info::find (Address *addr_ptr, bool fuzzy, int show_header_files,
+		      const char **dir, const char **file, unsigned *line)
+{
+  Address addr = *addr_ptr;
+  Index const *best = 0;
+  Index cur;
+
+  if (!in_range(addr))
+    return false;
+
+  if (_index)
+    {
+      unsigned i = upper_bound(addr);
+
+      while (i && !shown(_index[i-1].file, show_header_files))
+	i--;
+      if (!i)
+	return false;
+
+      // the first line in list order at this address
+      Address a = lin()[_index[i-1].line].addr;
+      if (!fuzzy && a != addr)
+	return false;
+      for (unsigned j = i; j && lin()[_index[j-1].line].addr == a; j--)
+	if (shown(_index[j-1].file, show_header_files))
+	  best = &_index[j-1];
+    }
+  else
+    {
+      Unsigned32 d = No_entry, f = No_entry;
+      Jdb_lines_line *l = lin();
+
+      for (Unsigned32 i = 0; l[i].addr || l[i].line; i++)
+	{
+	  if (l[i].line == Dir)
+	    d = i;
+	  else if (l[i].line == File || l[i].line == Header_file)
+	    f = i;
+	  else if (l[i].addr <= addr && (fuzzy || l[i].addr == addr)
+		   && shown(f, show_header_files)
+		   && (!best || l[i].addr > l[best->line].addr))
+	    {
+	      cur.line = i;
+	      cur.dir  = d;
+	      cur.file = f;
+	      best = &cur;
+	      if (!fuzzy)
+		break;
+	    }
+	}
+
+      if (!best)
+	return false;
+    }
+
+  *dir  = name(best->dir);
+  *file = name(best->file);
+  *line = lin()[best->line].line;
+  *addr_ptr = lin()[best->line].addr;
+  return true;
+}
+
+/**
+ * Lines of `task`.  Like for symbols, only the kernel (task 0) has a
+ * slot for registered lines.
+ */
 PUBLIC static
 Jdb_lines_info*
 Jdb_lines::lookup (Space * task)
 {
-  (void)task;
-#if 0
-  if (task >= Max_tasks)
-    {
-      WARN ("register_lines: task value #%x out of range (0-%x)\n",
-	    task, Max_tasks-1);
-      return 0;
-    }
+  if (task)
+    return 0;
 
-  return _task_lines + task;
-#endif
-  return 0;
+  return _task_lines;
 }
 
 IMPLEMENTATION[!arm]:
@@ -146,46 +342,15 @@ Jdb_lines::match_addr_to_line(Address addr, Space * task,
 			      char *line, unsigned line_size,
 			      int show_header_files)
 {
-  (void)addr; (void)task; (void)line; (void)line_size; (void)show_header_files;
-#if 0
-  if (task >= Max_tasks)
-    return false;
+  Jdb_lines_info *info = lookup(task);
+  const char *dir, *file;
+  unsigned l;
 
-  if (! _task_lines[task].in_range (addr))
+  if (!info || !info->find(&addr, false, show_header_files, &dir, &file, &l))
     return false;
 
-  int show_file = 1;
-  Jdb_lines_line *lin = _task_lines[task].lin();
-  const char *dir="", *file="", *str = _task_lines[task].str();
-      
-  for (; lin->addr || lin->line; lin++)
-    {
-      if (lin->line == 0xfffe)
-	{
-	  // this is a directory entry
-	  dir = str + lin->addr;
-	}
-      else if (lin->line == 0xffff)
-	{
-	  // this is a file name entry
-	  file = str + lin->addr;
-	  show_file = 1;
-	}
-      else if (lin->line == 0xfffd)
-	{
-	  // this is a header file name entry
-	  file = str + lin->addr;
-	  show_file = show_header_files;
-	}
-      else if ((lin->addr == addr) && show_file)
-	{
-	  // this is a line
-	  sprint_line(dir, file, lin->line, line, line_size);
-	  return true;
-	}
-    }
-#endif
-  return false;
+  sprint_line(dir, file, l, line, line_size);
+  return true;
 }
 
 // search line name that matches for a specific address
@@ -195,58 +360,15 @@ Jdb_lines::match_addr_to_line_fuzzy(Address *addr_ptr, Space * task,
 				    char *line, unsigned line_size,
 				    int show_header_files)
 {
-  (void)addr_ptr; (void)task; (void)line; (void)line_size; (void)show_header_files;
-#if 0
-  if (task >= Max_tasks)
-    return false;
+  Jdb_lines_info *info = lookup(task);
+  const char *dir, *file;
+  unsigned l;
 
-  if (! _task_lines[task].in_range (*addr_ptr))
+  if (!info || !info->find(addr_ptr, true, show_header_files, &dir, &file, &l))
     return false;
 
-  int show_file = 1;
-  Address best_addr = (Address)-1, best_line = 0;
-  Jdb_lines_line *lin = _task_lines[task].lin();
-  const char *dir="", *file="", *best_dir=0, *best_file=0;
-  const char *str=_task_lines[task].str();
-
-  for (; lin->addr || lin->line; lin++)
-    {
-      if (lin->line == 0xfffe)
-	{
-	  // this is a directory entry
-	  dir = str + lin->addr;
-	}
-      else if (lin->line == 0xffff)
-	{
-	  // this is a file name entry
-	  file = str + lin->addr;
-	  show_file = 1;
-	}
-      else if (lin->line == 0xfffd)
-	{
-	  // this is a header file name entry
-	  file = str + lin->addr;
-	  show_file = show_header_files;
-	}
-      else if ((lin->addr <= *addr_ptr)
-	       && (*addr_ptr-lin->addr < best_addr)
-	       && show_file)
-	{
-     	  best_addr = *addr_ptr-lin->addr;
-	  best_dir  = dir;
-	  best_file = file;
-	  best_line = lin->line;
-	}
-    }
-
-  if (best_addr < (Address)-1)
-    {
-      sprint_line(best_dir, best_file, best_line, line, line_size);
-      *addr_ptr -= best_addr;
-      return true;
-    }
-#endif
-  return false;
+  sprint_line(dir, file, l, line, line_size);
+  return true;
 }
 
 // truncate string if its length exceeds strsize and create line
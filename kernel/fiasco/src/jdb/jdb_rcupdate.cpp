@@ -33,6 +33,38 @@ Jdb_rcupdate::print_batch(Rcu_batch const &b)
   printf("#%ld", b._b);
 }
 
+//--------------------------------------------------------------------------
+IMPLEMENTATION [!rcu_tree]:
+
+PRIVATE static inline
+void
+Jdb_rcupdate::print_tree()
+{}
+
+//--------------------------------------------------------------------------
+IMPLEMENTATION [rcu_tree]:
+
+PRIVATE static
+void
+Jdb_rcupdate::print_tree()
+{
+  printf("  root mask=%lx\n", Rcu::_rcu._root_mask);
+  for (unsigned i = 0; i < Rcu_glbl::Num_leaves; ++i)
+    {
+      Rcu_node const *n = &Rcu::_rcu._leaves[i];
+      if (!n->_active && !n->_qsmask)
+        continue;
+
+      printf("  node[%2u]: cpus %u-%u batch=", i, i * Rcu_glbl::Leaf_cpus,
+             (i + 1) * Rcu_glbl::Leaf_cpus - 1);
+      print_batch(n->_batch);
+      printf(" wait=%04lx active=%04lx\n", n->_qsmask, n->_active);
+    }
+}
+
+//--------------------------------------------------------------------------
+IMPLEMENTATION:
+
 PUBLIC
 Jdb_module::Action_code
 Jdb_rcupdate::action(int cmd, void *&, char const *&, int &)
@@ -46,9 +78,15 @@ Jdb_rcupdate::action(int cmd, void *&, char const *&, int &)
       printf("  next_pending=%s\n"
              "  cpus=", Rcu::_rcu._next_pending?"yes":"no");
       for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
-	printf("%s%s", Rcu::_rcu._cpus.get(i)?"1":"0", cxx::int_value<Cpu_number>(i) % 4 == 3?" ":"");
+	printf("%s%s", Rcu::_rcu.waits_for(i)?"1":"0", cxx::int_value<Cpu_number>(i) % 4 == 3?" ":"");
 
       puts("");
+      print_tree();
+
+      Rcu_glbl const *g = &Rcu::_rcu;
+      printf("  grace periods=%lu length: last=%llu avg=%llu max=%llu us\n",
+             g->_gp_count, g->_gp_last,
+             g->_gp_count ? g->_gp_sum / g->_gp_count : 0ULL, g->_gp_max);
 
       for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
 	{
@@ -66,6 +104,8 @@ Jdb_rcupdate::action(int cmd, void *&, char const *&, int &)
 	  printf("    next list:    h=%p len=%ld\n", d->_n.front(), d->_len);
 	  printf("    current list: h=%p \n", d->_c.front());
 	  printf("    done list:    h=%p\n", d->_d.front());
+	  printf("    callbacks: backlog=%ld max=%ld invoked=%lu\n",
+	         d->_len, d->_max_len, d->_invoked);
 	}
 
       return NOTHING;
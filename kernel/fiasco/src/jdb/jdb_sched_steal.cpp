@@ -0,0 +1,53 @@
+IMPLEMENTATION [sched_steal]:
+
+#include <cstdio>
+
+#include "cpu.h"
+#include "jdb_module.h"
+#include "static_init.h"
+#include "thread.h"
+
+
+class Jdb_sched_steal : public Jdb_module
+{
+public:
+  Jdb_sched_steal() FIASCO_INIT;
+};
+
+IMPLEMENT
+Jdb_sched_steal::Jdb_sched_steal() : Jdb_module("INFO") {}
+
+PUBLIC
+Jdb_module::Action_code
+Jdb_sched_steal::action(int, void *&, char const *&, int &)
+{
+  printf("\nWORK STEALING -----------------------------\n");
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    {
+      if (!Cpu::online(i))
+        continue;
+
+      Thread::Steal_stats const &s = Thread::steal_stats(i);
+      printf("CPU[%2u]: %lu requests, %lu threads given, %lu refused\n",
+             cxx::int_value<Cpu_number>(i), s.requests, s.given, s.refused);
+    }
+  return NOTHING;
+}
+
+PUBLIC
+Jdb_module::Cmd const *
+Jdb_sched_steal::cmds() const
+{
+  static Cmd cs[] =
+    {
+	{ 0, 0, "steal", "", "steal\tshow work-stealing statistics", 0},
+    };
+  return cs;
+}
+
+PUBLIC
+int
+Jdb_sched_steal::num_cmds() const
+{ return 1; }
+
+static Jdb_sched_steal jdb_sched_steal INIT_PRIORITY(JDB_MODULE_INIT_PRIO);
@@ -12,6 +12,23 @@ private:
   size_t   _size;
   Address  _beg_sym;
   Address  _end_sym;
+  unsigned _num_syms;
+
+  // offsets of the symbols from _virt, sorted by address, see set_index()
+  Unsigned32 *_index;
+  unsigned _num_index;
+
+  struct Addr_less
+  {
+    char const *base;
+    bool operator () (Unsigned32 a, Unsigned32 b) const
+    {
+      Address x = *(Address const *)(base + a);
+      Address y = *(Address const *)(base + b);
+      // ties in list order, so the first of several aliases wins
+      return x < y || (x == y && a < b);
+    }
+  };
 };
 
 class Jdb_symbol
@@ -44,6 +61,7 @@ IMPLEMENTATION:
 #include "panic.h"
 #include "warn.h"
 #include "kdb_ke.h"
+#include "jdb_util.h"
 
 Jdb_symbol_info *Jdb_symbol::_task_symbols;
 
@@ -87,6 +105,29 @@ Jdb_symbol_info::in_range (Address addr)
   return _virt != 0 && _beg_sym <= addr && _end_sym >= addr;
 }
 
+PRIVATE static inline NOEXPORT
+Address
+Jdb_symbol_info::sym_addr (const char *sym)
+{
+  return *(Address const *)sym;
+}
+
+PRIVATE static inline NOEXPORT
+const char*
+Jdb_symbol_info::sym_next (const char *sym)
+{
+  return *((const char**)sym+1);
+}
+
+// symbols never shown for an address
+PRIVATE static inline NOEXPORT
+bool
+Jdb_symbol_info::ignored (const char *sym)
+{
+  return !memcmp(sym+Jdb_symbol::Start, "Letext", 6)
+         || !memcmp(sym+Jdb_symbol::Start, "patch_log_", 10);
+}
+
 // read address from current position and return its value
 PRIVATE static inline NOEXPORT
 Address
@@ -184,10 +225,16 @@ Jdb_symbol_info::set (Address virt, size_t size)
 {
   _virt = virt;
   _size = size;
+  _index = 0;
+  _num_index = 0;
 
   if (! transform())
     return false;
 
+  _num_syms = 0;
+  for (const char *sym = str(); sym; sym = sym_next(sym))
+    _num_syms++;
+
   if (this == Jdb_symbol::lookup(0))
     {
       // kernel symbols are special
@@ -216,9 +263,9 @@ Jdb_symbol_info::set (Address virt, size_t size)
       Address min_addr = ~0UL, max_addr = 0;
       const char *sym;
 
-      for (sym = str(); sym; sym = *((const char**)sym+1))
+      for (sym = str(); sym; sym = sym_next(sym))
 	{
-	  Address addr = *(Address*)sym;
+	  Address addr = sym_addr(sym);
 	  if (addr < min_addr)
 	    min_addr = addr;
 	  if (addr > max_addr)
@@ -232,21 +279,175 @@ Jdb_symbol_info::set (Address virt, size_t size)
   return true;
 }
 
+/// Bytes needed for the address index of the registered symbols.
+PUBLIC inline
+size_t
+Jdb_symbol_info::index_size () const
+{
+  return _num_syms * sizeof(Unsigned32);
+}
+
+PUBLIC inline
+void*
+Jdb_symbol_info::index () const
+{
+  return _index;
+}
+
+PUBLIC inline
+void
+Jdb_symbol_info::clear_index ()
+{
+  _index = 0;
+  _num_index = 0;
+}
+
+/**
+ * Build the address-sorted index of the registered symbols in `mem`
+ * (index_size() bytes) to make address lookups O(log n).  Without an
+ * index, lookups scan the symbol list.
+ */
+PUBLIC
+void
+Jdb_symbol_info::set_index (void *mem)
+{
+  Unsigned32 *idx = (Unsigned32*)mem;
+  unsigned n = 0;
+
+  for (const char *sym = str(); sym; sym = sym_next(sym))
+    if (!ignored(sym))
+      idx[n++] = sym - str();
+
+  Addr_less less;
+  less.base = str();
+  Jdb_util::sort(idx, n, less);
+
+  _index = idx;
+  _num_index = n;
+}
+
+// number of index entries with a symbol address not above `addr`
+PRIVATE
+unsigned
+Jdb_symbol_info::upper_bound (Address addr)
+{
+  unsigned l = 0, r = _num_index;
+
+  while (l < r)
+    {
+      unsigned m = (l + r) / 2;
+      if (sym_addr(str() + _index[m]) <= addr)
+	l = m + 1;
+      else
+	r = m;
+    }
+
+  return l;
+}
+
+/**
+ * Find the symbol at `addr` or, if `fuzzy`, the last symbol below `addr`.
+ * @param end  if not 0, gets the end of the address range that
+ *             resolves to the same symbol
+ * @return the symbol entry, or 0 if there is none
+ */
+PUBLIC
+const char*
+Jdb_symbol_info::find (Address addr, bool fuzzy, Address *end = 0)
+{
+  const char *best = 0;
+
+  if (!in_range(addr))
+    return 0;
+
+  if (_index)
+    {
+      unsigned i = upper_bound(addr);
+      if (!i)
+	return 0;
+
+      if (end)
+	*end = i < _num_index ? sym_addr(str() + _index[i]) : _end_sym + 1;
+
+      // step back to the first of several symbols at the same address
+      Address a = sym_addr(str() + _index[i-1]);
+      while (i > 1 && sym_addr(str() + _index[i-2]) == a)
+	i--;
+
+      best = str() + _index[i-1];
+      return (fuzzy || a == addr) ? best : 0;
+    }
+
+  for (const char *sym = str(); sym; sym = sym_next(sym))
+    {
+      Address a = sym_addr(sym);
+      if (a > addr || (!fuzzy && a != addr) || ignored(sym))
+	continue;
+      if (!fuzzy)
+	{
+	  best = sym;
+	  break;
+	}
+      if (!best || a > sym_addr(best))
+	best = sym;
+    }
+
+  if (best && end)
+    *end = sym_addr(best) + 1;
+  return best;
+}
+
+/**
+ * Symbolize `n` addresses at once, e.g., all instruction pointers of a
+ * trace buffer dump.  `syms[i]` gets the name of the last symbol not
+ * above `addrs[i]` (or 0) and `addrs[i]` is replaced by the offset into
+ * that symbol.  An address in the same symbol as its predecessor does
+ * not need another search.
+ * @return the number of resolved addresses
+ */
+PUBLIC
+unsigned
+Jdb_symbol_info::find_all (Address *addrs, const char **syms, unsigned n)
+{
+  const char *sym = 0;
+  Address beg = 1, end = 0;
+  unsigned found = 0;
+
+  for (unsigned i = 0; i < n; i++)
+    {
+      if (addrs[i] < beg || addrs[i] >= end)
+	{
+	  sym = find(addrs[i], true, &end);
+	  beg = sym ? sym_addr(sym) : 1;
+	  if (!sym)
+	    end = 0;
+	}
+
+      if (sym)
+	{
+	  syms[i] = sym + Jdb_symbol::Start;
+	  addrs[i] -= beg;
+	  found++;
+	}
+      else
+	syms[i] = 0;
+    }
+
+  return found;
+}
+
+/**
+ * Symbols of `task`.  Tasks are no longer numbered, so only the kernel
+ * (task 0) has a slot for registered symbols.
+ */
 PUBLIC static
 Jdb_symbol_info*
 Jdb_symbol::lookup (Space *task)
 {
-  (void)task;
-#if 0
-  if (task >= Max_tasks)
-    {
-      WARN ("register_symbols: task value #%x out of range (0-%x).\n",
-	    task, Max_tasks-1);
-      return 0;
-    }
-  return _task_symbols + task;
-#endif
-  return 0;
+  if (task)
+    return 0;
+
+  return _task_symbols;
 }
 
 // search symbol in task's symbols, return pointer to symbol name
@@ -254,15 +455,14 @@ static
 const char*
 Jdb_symbol::match_symbol (const char *symbol, bool search_instr, Space *task)
 {
-  (void)symbol; (void)search_instr; (void)task;
-#if 0
+  Jdb_symbol_info *info = lookup(task);
   const char *sym, *symnext;
 
-  if (task >= Max_tasks)
+  if (!info)
     return 0;
 
   // walk through list of symbols
-  for (sym=_task_symbols[task].str(); sym; sym=symnext)
+  for (sym=info->str(); sym; sym=symnext)
     {
       symnext = *((const char**)sym+1);
       
@@ -272,7 +472,6 @@ Jdb_symbol::match_symbol (const char *symbol, bool search_instr, Space *task)
 	  ||(!search_instr && (!strcmp(sym+Jdb_symbol::Start, symbol))))
 	return sym;
     }
-#endif
   return 0;
 }
 
@@ -283,17 +482,11 @@ Address
 Jdb_symbol::match_symbol_to_addr (const char *symbol, bool search_instr,
 				  Space *task)
 {
-  (void)symbol; (void)search_instr; (void)task;
-#if 0
   const char *sym;
 
-  if (task >= Max_tasks)
-    return 0;
-
   for (;;)
     {
-      if (   !_task_symbols[task].str()
-	  || !(sym = match_symbol(symbol, search_instr, task)))
+      if (!(sym = match_symbol(symbol, search_instr, task)))
 	{
 	  // no symbols for task or symbol not found in symbols
 	  if (task != 0)
@@ -306,8 +499,6 @@ Jdb_symbol::match_symbol_to_addr (const char *symbol, bool search_instr,
 
       return *(Address*)sym;
     }
-#endif
-  return 0;
 }
 
 // try to search a possible symbol completion
@@ -396,26 +587,13 @@ PUBLIC static
 const char*
 Jdb_symbol::match_addr_to_symbol (Address addr, Space *task)
 {
-  (void)addr; (void)task;
-#if 0
-  if (task >= Max_tasks)
-    return 0;
+  Jdb_symbol_info *info = lookup(task);
+  const char *sym;
 
-  if (!_task_symbols || !_task_symbols[task].in_range (addr))
+  if (!info || !(sym = info->find(addr, false)))
     return 0;
 
-  const char *sym;
-
-  for (sym = _task_symbols[task].str(); sym; sym = *((const char**)sym+1))
-    {
-      if (   (*(Address*)sym == addr)
-	  && (memcmp((void*)(sym+Start), "Letext", 6))		// ignore
-	  && (memcmp((void*)(sym+Start), "patch_log_", 10))	// ignore
-	 )
-	return sym+Start;
-    }
-#endif
-  return 0;
+  return sym+Start;
 }
 
 IMPLEMENTATION:
@@ -426,31 +604,10 @@ bool
 Jdb_symbol::match_addr_to_symbol_fuzzy (Address *addr_ptr, Space *task,
 				        char *t_symbol, int s_symbol)
 {
-  (void)addr_ptr; (void)task; (void)t_symbol; (void)s_symbol;
-#if 0
-  if (task >= Max_tasks)
-    return false;
-
-  if (!_task_symbols || !_task_symbols[task].in_range (*addr_ptr))
-    return false;
+  Jdb_symbol_info *info = lookup(task);
+  const char *max_sym;
 
-  const char *sym, *max_sym = 0;
-  Address max_addr = 0;
-
-  for (sym = _task_symbols[task].str(); sym; sym = *((const char**)sym+1))
-    {
-      Address addr = *(Address*)sym;
-      if (   addr > max_addr && addr <= *addr_ptr
-	  && (memcmp((void*)(sym+Start), "Letext", 6))		// ignore
-	  && (memcmp((void*)(sym+Start), "patch_log_", 10))	// ignore
-	 )
-	{
-	  max_addr = addr;
-	  max_sym  = sym;
-	}
-    }
-      
-  if (max_sym)
+  if (info && (max_sym = info->find(*addr_ptr, true)))
     {
       const char *t = max_sym + Start;
 
@@ -467,13 +624,33 @@ Jdb_symbol::match_addr_to_symbol_fuzzy (Address *addr_ptr, Space *task,
       // terminate string
       *t_symbol = '\0';
 
-      *addr_ptr = max_addr;
+      *addr_ptr = *(Address const*)max_sym;
       return true;
     }
-#endif
+
   return false;
 }
 
+/**
+ * Symbolize `n` addresses of `task` at once, see
+ * Jdb_symbol_info::find_all().
+ * @return the number of resolved addresses
+ */
+PUBLIC static
+unsigned
+Jdb_symbol::match_addrs_to_symbols (Address *addrs, const char **syms,
+				    unsigned n, Space *task)
+{
+  Jdb_symbol_info *info = lookup(task);
+
+  if (info)
+    return info->find_all(addrs, syms, n);
+
+  for (unsigned i = 0; i < n; i++)
+    syms[i] = 0;
+  return 0;
+}
+
 IMPLEMENTATION[arm]:
 
 PUBLIC static
@@ -3,8 +3,8 @@ INTERFACE:
 #include "jdb_ktrace.h"
 #include "l4_types.h"
 #include "std_macros.h"
+#include "per_cpu_data.h"
 #include "tb_entry.h"
-#include "spin_lock.h"
 
 class Context;
 class Log_event;
@@ -22,16 +22,49 @@ public:
   };
 
 protected:
-  static Tb_entry_union *_tbuf_act;	// current entry
-  static Tb_entry_union *_tbuf_max;
-  static Mword		_entries;	// number of occupied entries
+  enum { Max_rings = Tbuf_max_rings };
+
+  /**
+   * Trace ring of one CPU.  A ring is written only by its own CPU, so
+   * reserving an entry needs neither a lock nor an atomic operation
+   * visible to other CPUs.  Aligned to avoid false sharing.
+   */
+  struct Ring
+  {
+    Tb_entry_union *base;		// first entry
+    Tb_entry_union *max;		// end of ring
+    Tb_entry_union *act;		// next entry to be used
+    Mword	    entries;		// number of occupied entries
+    Mword	    number;		// number of events logged on this ring
+    bool	    export_above;	// export fill level >= watermark
+    bool	    export_kick;	// raise the export IRQ on the next tick
+  } __attribute__((aligned(64)));
+
+  static Per_cpu_array<Ring> _rings;
+  static Mword		_num_rings;	// number of rings in use
+  static Mword		_ring_entries;	// maximum number of entries per ring
   static Mword		_max_entries;	// maximum number of entries
   static Mword          _filter_enabled;// !=0 if filter is active
-  static Mword		_number;	// current event number
   static Mword		_count_mask1;
   static Mword		_count_mask2;
   static Address        _size;		// size of memory area for tbuffer
-  static Spin_lock<>    _lock;
+
+  // Streaming export to a user-level collector (Jdb_tbuf_export): the
+  // collector's per-ring consumer state, the fill level that triggers
+  // the collector, and how to trigger it
+  static Tracebuffer_export_ring *_export;
+  static Mword		_export_watermark;
+  static void		(*_export_notify)(Cpu_number);
+
+  // Merge cursor for the time-ordered view over all rings (JDB only):
+  // the index of the event it points to, the number of visible events
+  // before it, its position in each ring, and the ring of every event
+  // it passed, so that it can step back without a restart
+  static Mword		_cursor_idx;
+  static Mword		_cursor_visible;
+  static Per_cpu_array<Mword> _cursor_pos;
+  static Per_cpu_array<Tb_entry_union *> _cursor_act;
+  static Unsigned8	*_cursor_ring;
 };
 
 #ifdef CONFIG_JDB_LOGGING
@@ -151,22 +184,31 @@ protected:
 IMPLEMENTATION:
 
 #include "config.h"
+#include "context_base.h"
 #include "cpu_lock.h"
 #include "initcalls.h"
 #include "lock_guard.h"
+#include "mem.h"
 #include "mem_layout.h"
 #include "std_macros.h"
 
-Tb_entry_union *Jdb_tbuf::_tbuf_act;
-Tb_entry_union *Jdb_tbuf::_tbuf_max;
-Mword Jdb_tbuf::_entries;
+Per_cpu_array<Jdb_tbuf::Ring> Jdb_tbuf::_rings;
+Mword Jdb_tbuf::_num_rings = 1;
+Mword Jdb_tbuf::_ring_entries;
 Mword Jdb_tbuf::_max_entries;
 Mword Jdb_tbuf::_filter_enabled;
-Mword Jdb_tbuf::_number;
 Mword Jdb_tbuf::_count_mask1;
 Mword Jdb_tbuf::_count_mask2;
 Address Jdb_tbuf::_size;
-Spin_lock<> Jdb_tbuf::_lock;
+Tracebuffer_export_ring *Jdb_tbuf::_export;
+Mword Jdb_tbuf::_export_watermark;
+void (*Jdb_tbuf::_export_notify)(Cpu_number);
+Mword Jdb_tbuf::_cursor_idx;
+Mword Jdb_tbuf::_cursor_visible;
+Per_cpu_array<Mword> Jdb_tbuf::_cursor_pos;
+Per_cpu_array<Tb_entry_union *> Jdb_tbuf::_cursor_act;
+Unsigned8 *Jdb_tbuf::_cursor_ring;
+DEFINE_PER_CPU static Per_cpu<Tb_entry_union> _spare_entry;
 
 static void direct_log_dummy(Tb_entry*, const char*)
 {}
@@ -204,10 +246,21 @@ Jdb_tbuf::clear_tbuf()
   for (i = 0; i < _max_entries; i++)
     buffer()[i].clear();
 
-  _tbuf_act = buffer();
-  _entries = 0;
+  // act stays where it is: the slot of each entry follows from its
+  // number, which the streaming export relies on
+  for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+    _rings[cpu].entries = 0;
+
+  cursor_invalidate();
 }
 
+/** Return the number of rings, one per CPU the tracebuffer was sized for.
+ * CPUs with a higher number are not traced. */
+PUBLIC static inline
+Cpu_number
+Jdb_tbuf::num_rings()
+{ return Cpu_number(_num_rings); }
+
 /** Return pointer to new tracebuffer entry. */
 PUBLIC static
 Tb_entry*
@@ -215,19 +268,33 @@ Jdb_tbuf::new_entry()
 {
   Tb_entry *tb;
   {
-    auto guard = lock_guard(_lock);
+    // reserve: the ring belongs to this CPU, keeping interrupts off
+    // is enough
+    auto guard = lock_guard(cpu_lock);
+    Cpu_number cpu = current_cpu();
 
-    tb = _tbuf_act;
+    if (EXPECT_FALSE(cpu >= num_rings()))
+      return &_spare_entry.current();
 
-    status()->current = (Address)tb;
+    Ring *r = &_rings[cpu];
 
-    if (++_tbuf_act >= _tbuf_max)
-      _tbuf_act = buffer();
+    tb = r->act;
 
-    if (_entries < _max_entries)
-      _entries++;
+    if (cpu == Cpu_number::boot_cpu())
+      status()->current = (Address)tb;
 
-    tb->number(++_number);
+    if (++r->act >= r->max)
+      r->act = r->base;
+
+    if (r->entries < _ring_entries)
+      r->entries++;
+
+    if (EXPECT_FALSE(_export != 0))
+      export_reserve(cpu, r);
+
+    // event numbers are unique over all rings: the lower digits
+    // (modulo the number of rings) encode the ring
+    tb->number(++r->number * _num_rings + cxx::int_value<Cpu_number>(cpu));
   }
 
   tb->rdtsc();
@@ -250,12 +317,19 @@ PUBLIC static
 void
 Jdb_tbuf::commit_entry()
 {
-  if (EXPECT_FALSE((_number & _count_mask2) == 0))
+  Cpu_number cpu = current_cpu();
+  if (EXPECT_FALSE(cpu >= num_rings()))
+    return;
+
+  Mword number = _rings[cpu].number;
+
+  if (EXPECT_FALSE((number & _count_mask2) == 0))
     {
-      if (_number & _count_mask1)
-	status()->window[0].version++; // 64-bit value!
-      else
-	status()->window[1].version++; // 64-bit value!
+      unsigned half = (number & _count_mask1) ? 0 : 1;
+      status()->rings[cxx::int_value<Cpu_number>(cpu)].version[half]++;
+
+      if (cpu == Cpu_number::boot_cpu())
+	status()->window[half].version++; // 64-bit value!
 
 #if 0 // disbale Tbuf vIRQ for the time beeing (see bug #357)
       // fire the virtual 'buffer full' irq
@@ -266,15 +340,287 @@ Jdb_tbuf::commit_entry()
 	}
 #endif
     }
+
+  if (EXPECT_FALSE(_export != 0))
+    export_commit();
+}
+
+/** Count a drop if the entry that ring r is about to overwrite has not
+ * been consumed by the collector yet.  Called with the CPU lock held. */
+PRIVATE static inline
+void
+Jdb_tbuf::export_reserve(Cpu_number cpu, Ring const *r)
+{
+  Tracebuffer_export_ring *e = access_once(&_export);
+  if (!e)
+    return;
+
+  e += cxx::int_value<Cpu_number>(cpu);
+  if (r->number - access_once(&e->tail) >= _ring_entries)
+    ++e->dropped;
+}
+
+/** Publish the entries committed on the current CPU to the collector and
+ * arm the export IRQ if the ring has filled up to the watermark.  The
+ * IRQ is raised from the next timer tick (export_tick()) because
+ * commit_entry() may run in the middle of a context switch, where
+ * sending an IRQ message is not safe (see bug #357). */
+PRIVATE static
+void
+Jdb_tbuf::export_commit()
+{
+  auto guard = lock_guard(cpu_lock);
+  Tracebuffer_export_ring *e = access_once(&_export);
+  if (!e)
+    return;
+
+  Cpu_number cpu = current_cpu();
+  Ring *r = &_rings[cpu];
+  e += cxx::int_value<Cpu_number>(cpu);
+
+  // An entry reserved by an interrupted context on this CPU may be
+  // published before it is complete; its header is already valid.
+  Mem::mp_wmb();
+  write_now(&e->head, r->number);
+
+  bool above = r->number - access_once(&e->tail) >= _export_watermark;
+  if (above && !r->export_above)
+    r->export_kick = true;
+  r->export_above = above;
+}
+
+/** Raise the export IRQ if the ring of the current CPU reached the
+ * watermark since the last tick.  Called from the timer interrupt with
+ * the CPU lock held. */
+PUBLIC static inline NEEDS["context_base.h"]
+void
+Jdb_tbuf::export_tick()
+{
+  Cpu_number cpu = current_cpu();
+  Ring *r = &_rings[cpu];
+  if (EXPECT_TRUE(!r->export_kick))
+    return;
+
+  r->export_kick = false;
+  void (*notify)(Cpu_number) = access_once(&_export_notify);
+  if (notify)
+    notify(cpu);
+}
+
+/** Return the number of entries currently allocated in the ring of
+ * CPU cpu. */
+PUBLIC static inline
+Mword
+Jdb_tbuf::ring_entries(Cpu_number cpu)
+{
+  return _rings[cpu].entries;
+}
+
+/** Return the maximum number of entries of one ring. */
+PUBLIC static inline
+Mword
+Jdb_tbuf::max_ring_entries()
+{
+  return _ring_entries;
+}
+
+/** Return pointer to an event of a single ring.
+ * @param pos 0 is the last event logged on this ring, 1 the event
+ *            before and so on */
+PROTECTED static inline
+Tb_entry_union *
+Jdb_tbuf::ring_lookup(Cpu_number cpu, Mword pos)
+{
+  Ring const *r = &_rings[cpu];
+  Tb_entry_union *e = r->act - pos - 1;
+
+  if (e < r->base)
+    e += _ring_entries;
+
+  return e;
+}
+
+/** Select the ring holding the next-older event of the merge cursor.
+ * Events of different rings are ordered by their time stamp.
+ * @return the ring, or Cpu_number::nil() if all rings are exhausted */
+PRIVATE static
+Cpu_number
+Jdb_tbuf::cursor_pick()
+{
+  Cpu_number best = Cpu_number::nil();
+  Unsigned64 best_tsc = 0;
+
+  for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+    {
+      if (_cursor_pos[cpu] >= _rings[cpu].entries)
+	continue;
+
+      Unsigned64 tsc = ring_lookup(cpu, _cursor_pos[cpu])->tsc();
+      if (best == Cpu_number::nil() || tsc > best_tsc)
+	{
+	  best = cpu;
+	  best_tsc = tsc;
+	}
+    }
+
+  return best;
+}
+
+/** Make the next cursor_seek() start over, for example after entries
+ * were cleared or their hidden flags changed. */
+PRIVATE static inline
+void
+Jdb_tbuf::cursor_invalidate()
+{
+  _cursor_act[Cpu_number::first()] = 0;
+}
+
+/** Restart the merge cursor from the last event if a ring has been
+ * written since the cursor was positioned. */
+PRIVATE static
+void
+Jdb_tbuf::cursor_check()
+{
+  bool valid = true;
+
+  for (Cpu_number cpu = Cpu_number::first(); valid && cpu < num_rings(); ++cpu)
+    valid = _cursor_act[cpu] == _rings[cpu].act;
+
+  if (valid)
+    return;
+
+  _cursor_idx = 0;
+  _cursor_visible = 0;
+  for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+    {
+      _cursor_pos[cpu] = 0;
+      _cursor_act[cpu] = _rings[cpu].act;
+    }
+}
+
+/** Move the merge cursor to the next-older event.
+ * @return false if all rings are exhausted */
+PRIVATE static
+bool
+Jdb_tbuf::cursor_next()
+{
+  Cpu_number cpu = cursor_pick();
+  if (cpu == Cpu_number::nil())
+    return false;
+
+  if (!ring_lookup(cpu, _cursor_pos[cpu])->hidden())
+    ++_cursor_visible;
+
+  _cursor_ring[_cursor_idx++] = cxx::int_value<Cpu_number>(cpu);
+  ++_cursor_pos[cpu];
+  return true;
+}
+
+/** Move the merge cursor back to the next-newer event, which is taken
+ * from the recorded picks rather than from the time stamps: those are
+ * not strictly ordered within a ring if a reservation was interrupted.
+ * The cursor must not point to the last event. */
+PRIVATE static
+void
+Jdb_tbuf::cursor_prev()
+{
+  Cpu_number cpu = Cpu_number(_cursor_ring[--_cursor_idx]);
+  --_cursor_pos[cpu];
+
+  if (!ring_lookup(cpu, _cursor_pos[cpu])->hidden())
+    --_cursor_visible;
+}
+
+/** Move the merge cursor to event idx.
+ * Costs O(rings) per event stepped forward and O(1) per event stepped
+ * back, so scrolling through the buffer in either direction is cheap.
+ * @return the ring holding event idx, or Cpu_number::nil() */
+PRIVATE static
+Cpu_number
+Jdb_tbuf::cursor_seek(Mword idx)
+{
+  cursor_check();
+
+  while (_cursor_idx > idx)
+    cursor_prev();
+
+  while (_cursor_idx < idx)
+    if (!cursor_next())
+      return Cpu_number::nil();
+
+  return cursor_pick();
+}
+
+/** Move the merge cursor to the visible event vis_idx, ignoring hidden
+ * events.
+ * @return the ring holding the event, or Cpu_number::nil() */
+PRIVATE static
+Cpu_number
+Jdb_tbuf::cursor_seek_visible(Mword vis_idx)
+{
+  cursor_check();
+
+  while (_cursor_visible > vis_idx)
+    cursor_prev();
+
+  for (;;)
+    {
+      Cpu_number cpu = cursor_pick();
+      if (cpu == Cpu_number::nil())
+	return cpu;
+
+      if (_cursor_visible == vis_idx
+	  && !ring_lookup(cpu, _cursor_pos[cpu])->hidden())
+	return cpu;
+
+      cursor_next();
+    }
+}
+
+/** Move the merge cursor to event e.
+ * @return false if e is not a current event */
+PRIVATE static
+bool
+Jdb_tbuf::cursor_seek_entry(Tb_entry const *e)
+{
+  Tb_entry_union const *ef = static_cast<Tb_entry_union const *>(e);
+  Mword slot = ef - buffer();
+
+  if (slot >= _num_rings * _ring_entries)
+    return false;
+
+  Cpu_number cpu = Cpu_number(slot / _ring_entries);
+  Mword pos = _rings[cpu].act - ef - 1;
+
+  if (pos >= _ring_entries)
+    pos += _ring_entries;
+
+  if (pos >= _rings[cpu].entries)
+    return false;
+
+  cursor_check();
+
+  while (_cursor_pos[cpu] > pos)
+    cursor_prev();
+
+  while (_cursor_pos[cpu] < pos || cursor_pick() != cpu)
+    cursor_next();
+
+  return true;
 }
 
 /** Return number of entries currently allocated in tracebuffer.
  * @return number of entries */
-PUBLIC static inline
+PUBLIC static
 Mword
 Jdb_tbuf::unfiltered_entries()
 {
-  return _entries;
+  Mword cnt = 0;
+
+  for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+    cnt += _rings[cpu].entries;
+
+  return cnt;
 }
 
 PUBLIC static
@@ -286,9 +632,10 @@ Jdb_tbuf::entries()
 
   Mword cnt = 0;
 
-  for (Mword idx = 0; idx<unfiltered_entries(); idx++)
-    if (!buffer()[idx].hidden())
-      cnt++;
+  for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+    for (Mword pos = 0; pos < _rings[cpu].entries; pos++)
+      if (!ring_lookup(cpu, pos)->hidden())
+	cnt++;
 
   return cnt;
 }
@@ -308,6 +655,7 @@ void
 Jdb_tbuf::max_entries (Mword num)
 {
   _max_entries = num;
+  _ring_entries = num / _num_rings;
 }
 
 /** Check if event is valid.
@@ -317,7 +665,7 @@ PUBLIC static inline
 int
 Jdb_tbuf::event_valid(Mword idx)
 {
-  return idx < _entries;
+  return idx < unfiltered_entries();
 }
 
 /** Return pointer to tracebuffer event.
@@ -331,15 +679,19 @@ PUBLIC static
 Tb_entry*
 Jdb_tbuf::unfiltered_lookup(Mword idx)
 {
-  if (!event_valid(idx))
-    return 0;
+  if (_num_rings == 1)
+    {
+      if (!event_valid(idx))
+	return 0;
 
-  Tb_entry_union *e = _tbuf_act - idx - 1;
+      return ring_lookup(Cpu_number::first(), idx);
+    }
 
-  if (e < buffer())
-    e += _max_entries;
+  Cpu_number cpu = cursor_seek(idx);
+  if (cpu == Cpu_number::nil())
+    return 0;
 
-  return e;
+  return ring_lookup(cpu, _cursor_pos[cpu]);
 }
 
 /** Return pointer to tracebuffer event.
@@ -357,30 +709,32 @@ Jdb_tbuf::lookup(Mword look_idx)
   if (!_filter_enabled)
     return unfiltered_lookup(look_idx);
 
-  for (Mword idx = 0;; idx++)
-    {
-      Tb_entry *e = unfiltered_lookup(idx);
+  Cpu_number cpu = cursor_seek_visible(look_idx);
+  if (cpu == Cpu_number::nil())
+    return 0;
 
-      if (!e)
-	return 0;
-      if (e->hidden())
-	continue;
-      if (!look_idx--)
-	return e;
-    }
+  return ring_lookup(cpu, _cursor_pos[cpu]);
 }
 
 PUBLIC static
 Mword
 Jdb_tbuf::unfiltered_idx(Tb_entry const *e)
 {
-  Tb_entry_union const *ef = static_cast<Tb_entry_union const *>(e);
-  Mword idx = _tbuf_act - ef - 1;
+  if (_num_rings == 1)
+    {
+      Tb_entry_union const *ef = static_cast<Tb_entry_union const *>(e);
+      Mword idx = _rings[Cpu_number::first()].act - ef - 1;
+
+      if (idx >= _max_entries)
+	idx += _max_entries;
 
-  if (idx > _max_entries)
-    idx += _max_entries;
+      return idx;
+    }
+
+  if (!cursor_seek_entry(e))
+    return unfiltered_entries();
 
-  return idx;
+  return _cursor_idx;
 }
 
 /** Tb_entry => tracebuffer index. */
@@ -391,21 +745,10 @@ Jdb_tbuf::idx(Tb_entry const *e)
   if (!_filter_enabled)
     return unfiltered_idx(e);
 
-  Tb_entry_union const *ef = static_cast<Tb_entry_union const*>(e);
-  Mword idx = (Mword) - 1;
-
-  for (;;)
-    {
-      if (!ef->hidden())
-	idx++;
-      ef++;
-      if (ef >= buffer() + _max_entries)
-	ef -= _max_entries;
-      if (ef == _tbuf_act)
-	break;
-    }
+  if (!cursor_seek_entry(e))
+    return entries();
 
-  return idx;
+  return _cursor_visible;
 }
 
 /** Event number => Tb_entry. */
@@ -413,13 +756,16 @@ PUBLIC static inline
 Tb_entry*
 Jdb_tbuf::search(Mword nr)
 {
-  Tb_entry *e;
+  // the event number determines the ring and the position within
+  Cpu_number cpu = Cpu_number(nr % _num_rings);
+  Mword seq = nr / _num_rings;
+  Ring const *r = &_rings[cpu];
 
-  for (Mword idx = 0; (e = unfiltered_lookup(idx)); idx++)
-    if (e->number() == nr)
-      return e;
+  if (seq > r->number || r->number - seq >= r->entries)
+    return 0;
 
-  return 0;
+  Tb_entry *e = ring_lookup(cpu, r->number - seq);
+  return e->number() == nr ? e : 0;
 }
 
 /** Event number => tracebuffer index.
@@ -434,26 +780,14 @@ Jdb_tbuf::search_to_idx(Mword nr)
   if (nr == (Mword) - 1)
     return (Mword) - 1;
 
-  Tb_entry *e;
-
-  if (!_filter_enabled)
-    {
-      e = search(nr);
-      if (!e)
-	return (Mword) - 1;
-      return unfiltered_idx(e);
-    }
-
-  for (Mword idx_u = 0, idx_f = 0; (e = unfiltered_lookup(idx_u)); idx_u++)
-    {
-      if (e->number() == nr)
-	return e->hidden() ? (Mword) - 2 : idx_f;
+  Tb_entry *e = search(nr);
+  if (!e)
+    return (Mword) - 1;
 
-      if (!e->hidden())
-	idx_f++;
-    }
+  if (_filter_enabled && e->hidden())
+    return (Mword) - 2;
 
-  return (Mword)-1;
+  return idx(e);
 }
 
 /** Return some information about log event.
@@ -526,16 +860,18 @@ Jdb_tbuf::diff_pmc(Mword idx, Mword nr, Signed32 *delta)
   return true;
 }
 
-PUBLIC static inline
+PUBLIC static inline NEEDS[Jdb_tbuf::cursor_invalidate]
 void
 Jdb_tbuf::enable_filter()
 {
   _filter_enabled = 1;
+  cursor_invalidate();
 }
 
-PUBLIC static inline
+PUBLIC static inline NEEDS[Jdb_tbuf::cursor_invalidate]
 void
 Jdb_tbuf::disable_filter()
 {
   _filter_enabled = 0;
+  cursor_invalidate();
 }
@@ -0,0 +1,228 @@
+INTERFACE:
+
+#include "irq_chip.h"
+#include "jdb_kobject.h"
+#include "jdb_tbuf.h"
+#include "l4_types.h"
+#include "spin_lock.h"
+
+class Syscall_frame;
+class Task;
+class Utcb;
+
+/**
+ * Streaming export of the trace rings to a user-level collector.
+ *
+ * The collector attaches by invoking the debugger protocol on an IRQ
+ * capability (Op_tbuf_export), passing an array of
+ * Tracebuffer_export_ring in its kernel-user memory, one per ring, and a
+ * watermark.  Each CPU then publishes the committed entries of its ring
+ * in `head` and counts the entries it overwrites before the collector
+ * moved `tail` past them in `dropped`.  When a ring fills up to the
+ * watermark, the IRQ is triggered on the next timer tick.  The collector
+ * copies the raw entries out of the user-visible trace buffer
+ * (Tracebuffer_status::rings) and advances `tail`.
+ *
+ * The exporter holds a reference to the collector's task, which keeps
+ * the kernel-user memory alive until the collector detaches or another
+ * collector attaches.  Only the attached task can detach.  The location
+ * of the rings can be queried without attaching (Op_tbuf_export_info).
+ */
+class Jdb_tbuf_export : public Jdb_tbuf, public Irq_chip_soft
+{
+public:
+  static Jdb_tbuf_export exporter;
+
+private:
+  Spin_lock<> _lock;
+  Task *_task;
+  Irq_base *_irq;
+};
+
+class Jdb_tbuf_export_hdl : public Jdb_kobject_handler
+{
+public:
+  Jdb_tbuf_export_hdl() : Jdb_kobject_handler(0) {}
+  virtual bool show_kobject(Kobject_common *, int) { return false; }
+  virtual ~Jdb_tbuf_export_hdl() {}
+};
+
+
+IMPLEMENTATION:
+
+#include "entry_frame.h"
+#include "irq.h"
+#include "kobject.h"
+#include "lock_guard.h"
+#include "mem.h"
+#include "static_init.h"
+#include "task.h"
+#include "thread.h"
+
+Jdb_tbuf_export Jdb_tbuf_export::exporter;
+
+PUBLIC
+Jdb_tbuf_export::Jdb_tbuf_export() : _task(0), _irq(0)
+{ _lock.init(); }
+
+PUBLIC
+void
+Jdb_tbuf_export::unbind(Irq_base *irq)
+{
+  if (_irq == irq)
+    write_now(&_irq, (Irq_base *)0);
+
+  Irq_chip::unbind(irq);
+}
+
+/** Trigger the collector for the ring of `cpu`, called from
+ * Jdb_tbuf::export_tick(). */
+PRIVATE static
+void
+Jdb_tbuf_export::notify(Cpu_number cpu)
+{
+  Tracebuffer_export_ring *e = access_once(&_export);
+  Irq_base *irq = access_once(&exporter._irq);
+  if (!e || !irq)
+    return;
+
+  ++e[cxx::int_value<Cpu_number>(cpu)].notified;
+  irq->hit(0);
+}
+
+/**
+ * Return the location of the rings as published in Tracebuffer_status:
+ * the user address of the first ring in values[0], the distance between
+ * rings in bytes in values[1], the size of an entry in values[2], and
+ * the number of rings in values[3].
+ */
+PUBLIC static
+L4_msg_tag
+Jdb_tbuf_export::info(Utcb *u)
+{
+  Tracebuffer_status const *s = status();
+
+  u->values[0] = s->rings[0].tracebuffer;
+  u->values[1] = s->rings[0].size;
+  u->values[2] = sizeof(Tb_entry_union);
+  u->values[3] = s->num_rings;
+  return Kobject_iface::commit_result(0, 4);
+}
+
+/**
+ * Attach a collector, replacing the current one, or detach the current
+ * collector if the address of the consumer state is 0.
+ * values[1] is the user address of the Tracebuffer_export_ring array,
+ * one per ring within one ku_mem area, values[2] the watermark in
+ * entries per ring (0 for half a ring).
+ * `o` is the IRQ to trigger.  Returns the location of the rings like
+ * info().  Detaching fails with EPerm unless the calling task is the
+ * attached collector.
+ *
+ * The consumer state starts with the entries still held in each ring.
+ */
+PUBLIC
+L4_msg_tag
+Jdb_tbuf_export::set(Kobject_common *o, Syscall_frame *f, Utcb *u)
+{
+  if (EXPECT_FALSE(f->tag().words() < 3))
+    return Kobject_iface::commit_result(-L4_err::EInval);
+
+  Task *caller = static_cast<Task *>(current()->space());
+  Task *t = 0;
+  Irq *irq = 0;
+  Tracebuffer_export_ring *e = 0;
+  Mword watermark = u->values[2];
+
+  if (u->values[1])
+    {
+      if (!watermark)
+        watermark = max_ring_entries() / 2;
+
+      irq = Kobject::dcast<Irq*>(o);
+      if (!irq || watermark > max_ring_entries())
+        return Kobject_iface::commit_result(-L4_err::EInval);
+
+      t = caller;
+      User<Tracebuffer_export_ring>::Ptr ue((Tracebuffer_export_ring *)u->values[1]);
+      Space::Ku_mem const *m
+        = t->find_ku_mem(ue, sizeof(Tracebuffer_export_ring)
+                             * cxx::int_value<Cpu_number>(num_rings()));
+      if (!m)
+        return Kobject_iface::commit_result(-L4_err::EInval);
+
+      e = m->kern_addr(ue);
+      for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+        {
+          Ring const *r = &_rings[cpu];
+          Tracebuffer_export_ring *x = &e[cxx::int_value<Cpu_number>(cpu)];
+          x->head     = access_once(&r->number);
+          x->tail     = x->head - access_once(&r->entries);
+          x->dropped  = 0;
+          x->notified = 0;
+        }
+
+      t->inc_ref();
+    }
+
+  Task *old;
+    {
+      auto guard = lock_guard(_lock);
+      if (!t && _task != caller)
+        return Kobject_iface::commit_result(-L4_err::EPerm);
+
+      old = _task;
+      _task = t;
+
+      if (_irq)
+        _irq->unbind();
+
+      write_now(&_export, (Tracebuffer_export_ring *)0);
+      if (irq)
+        {
+          irq->unbind();
+          Irq_chip_soft::bind(irq, 0);
+          _irq = irq;
+        }
+
+      _export_watermark = watermark;
+      _export_notify = &notify;
+      Mem::mp_wmb();
+      write_now(&_export, e);
+    }
+
+  if (old && old->dec_ref() == 0)
+    {
+      current()->rcu_wait();
+      delete old;
+    }
+
+  return info(u);
+}
+
+PUBLIC static FIASCO_INIT
+void
+Jdb_tbuf_export_hdl::init()
+{
+  static Jdb_tbuf_export_hdl hdl;
+  Jdb_kobject::module()->register_handler(&hdl);
+}
+
+PUBLIC
+bool
+Jdb_tbuf_export_hdl::invoke(Kobject_common *o, Syscall_frame *f, Utcb *utcb)
+{
+  switch (utcb->values[0])
+    {
+    case Op_tbuf_export:
+      f->tag(Jdb_tbuf_export::exporter.set(o, f, utcb));
+      return true;
+    case Op_tbuf_export_info:
+      f->tag(Jdb_tbuf_export::info(utcb));
+      return true;
+    default:
+      return false;
+    }
+}
+
+STATIC_INITIALIZE(Jdb_tbuf_export_hdl);
@@ -6,6 +6,9 @@ class Jdb_tbuf_init : public Jdb_tbuf
 {
 public:
   static void init();
+
+private:
+  static unsigned num_cpus();
 };
 
 
@@ -19,6 +22,8 @@ IMPLEMENTATION:
 #include "config.h"
 #include "cpu.h"
 #include "jdb_ktrace.h"
+#include "kern_cnt.h"
+#include "kmem_alloc.h"
 #include "koptions.h"
 #include "mem_layout.h"
 #include "vmem_alloc.h"
@@ -43,13 +48,27 @@ void Jdb_tbuf_init::init()
       if (Koptions::o()->opt(Koptions::F_tbuf_entries))
 	want_entries = Koptions::o()->tbuf_entries;
 
-      // minimum: 8KB (  2 pages), maximum: 2MB (512 pages)
-      // must be a power of 2 (for performance reasons)
-      for (n = Config::PAGE_SIZE / sizeof(Tb_entry_union);
-	   n < want_entries && n * sizeof(Tb_entry_union) < 0x200000;
-	   n <<= 1)
+      static_assert(sizeof(Tracebuffer_status) <= Config::PAGE_SIZE,
+                    "tracebuffer status exceeds status page");
+
+      // one ring per CPU that can come up, not per CPU the kernel
+      // supports: spare rings would only take entries from the others
+      _num_rings = num_cpus();
+      if (_num_rings < 1)
+	_num_rings = 1;
+      if (_num_rings > Max_rings)
+	_num_rings = Max_rings;
+
+      // minimum: one page per ring, maximum: 2MB (512 pages)
+      // each ring must be a power of 2 (for performance reasons)
+      unsigned ring_n;
+      for (ring_n = Config::PAGE_SIZE / sizeof(Tb_entry_union);
+	   ring_n * _num_rings < want_entries
+	   && 2 * ring_n * _num_rings * sizeof(Tb_entry_union) <= 0x200000;
+	   ring_n <<= 1)
 	;
 
+      n = ring_n * _num_rings;
       if (n < want_entries)
 	panic("Cannot allocate more than %d entries for tracebuffer\n", n);
 
@@ -69,10 +88,30 @@ void Jdb_tbuf_init::init()
 	  va += Config::PAGE_SIZE;
 	}
 
+      // the buffer is split into one ring per CPU
+      unsigned ring_size = size / _num_rings;
+      for (Cpu_number cpu = Cpu_number::first(); cpu < num_rings(); ++cpu)
+	{
+	  unsigned i = cxx::int_value<Cpu_number>(cpu);
+	  Ring *r = &_rings[cpu];
+	  r->base   = buffer() + i * max_ring_entries();
+	  r->max    = r->base + max_ring_entries();
+	  r->act    = r->base;
+	  r->number = 0;
+
+	  status()->rings[i].tracebuffer = (Address)Mem_layout::Tbuf_ubuffer_area
+	                                   + i * ring_size;
+	  status()->rings[i].size        = ring_size;
+	  status()->rings[i].version[0]  =
+	  status()->rings[i].version[1]  = 0;
+	}
+      status()->num_rings = _num_rings;
+
+      // the legacy window describes the two halves of the boot CPU ring
       status()->window[0].tracebuffer = (Address)Mem_layout::Tbuf_ubuffer_area;
-      status()->window[1].tracebuffer = (Address)Mem_layout::Tbuf_ubuffer_area + size/2;
+      status()->window[1].tracebuffer = (Address)Mem_layout::Tbuf_ubuffer_area + ring_size/2;
       status()->window[0].size        =
-      status()->window[1].size        = size / 2;
+      status()->window[1].size        = ring_size / 2;
       status()->window[0].version     =
       status()->window[1].version     = 0;
 
@@ -80,11 +119,60 @@ void Jdb_tbuf_init::init()
       status()->scaler_tsc_to_us = Cpu::boot_cpu()->get_scaler_tsc_to_us();
       status()->scaler_ns_to_tsc = Cpu::boot_cpu()->get_scaler_ns_to_tsc();
 
-      _tbuf_max    = buffer() + max_entries();
-      _count_mask1 =  max_entries()    - 1;
-      _count_mask2 = (max_entries())/2 - 1;
+      if (Config::Jdb_accounting)
+        Kern_cnt::init(status());
+
+      _count_mask1 =  max_ring_entries()    - 1;
+      _count_mask2 = (max_ring_entries())/2 - 1;
       _size        = size;
 
+      // the merge cursor records the ring of each event it passes
+      _cursor_ring = (Unsigned8 *)Kmem_alloc::allocator()->unaligned_alloc(n);
+      if (!_cursor_ring)
+	panic("jdb_tbuf: alloc merge cursor failed");
+
       clear_tbuf();
     }
 }
+
+
+//---------------------------------------------------------------------------
+IMPLEMENTATION [!mp]:
+
+IMPLEMENT inline
+unsigned
+Jdb_tbuf_init::num_cpus()
+{ return 1; }
+
+//---------------------------------------------------------------------------
+IMPLEMENTATION [mp && (ia32 || amd64)]:
+
+#include "acpi.h"
+
+/** Count the enabled local APICs in the ACPI MADT. */
+IMPLEMENT FIASCO_INIT
+unsigned
+Jdb_tbuf_init::num_cpus()
+{
+  Acpi_madt const *madt = Acpi::find<Acpi_madt const *>("APIC");
+  if (!madt)
+    return Config::Max_num_cpus;
+
+  unsigned n = 0;
+  for (unsigned i = 0;
+       Acpi_madt::Lapic const *l
+         = static_cast<Acpi_madt::Lapic const *>(madt->find(Acpi_madt::LAPIC, i));
+       ++i)
+    if (l->flags & Acpi_madt::Lapic::Enabled)
+      ++n;
+
+  return n;
+}
+
+//---------------------------------------------------------------------------
+IMPLEMENTATION [mp && !ia32 && !amd64]:
+
+IMPLEMENT inline
+unsigned
+Jdb_tbuf_init::num_cpus()
+{ return Config::Max_num_cpus; }
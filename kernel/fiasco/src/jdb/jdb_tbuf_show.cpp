@@ -90,6 +90,7 @@ private:
   enum
   {
     Tbuf_start_line   = 3,
+    Sym_batch         = 64, // entries symbolized at once when dumping
   };
 
   enum
@@ -103,6 +104,10 @@ private:
   {
     Nil               = (Mword)-1,
   };
+
+  // kernel symbols of the instruction pointers of the entries being dumped
+  static Address     _sym_offs[Sym_batch];
+  static char const *_syms[Sym_batch];
 };
 
 char  Jdb_tbuf_show::_search_str[40];
@@ -117,6 +122,25 @@ Mword Jdb_tbuf_show::_nr_pos[10] = { Nil, Nil, Nil, Nil, Nil,
 
 Mword Jdb_tbuf_show::y_offset = 0;
 
+Address     Jdb_tbuf_show::_sym_offs[Jdb_tbuf_show::Sym_batch];
+char const *Jdb_tbuf_show::_syms[Jdb_tbuf_show::Sym_batch];
+
+// look up the kernel symbols of the instruction pointers of `count`
+// entries starting at `n` in one go, see Jdb_symbol::match_addrs_to_symbols()
+static void
+Jdb_tbuf_show::symbolize(Mword n, Mword count)
+{
+  for (Mword i = 0; i < count; i++)
+    {
+      Thread const *t;
+      Mword ip;
+
+      _sym_offs[i] = Jdb_tbuf_output::thread_ip(n + i, &t, &ip) ? ip : 0;
+    }
+
+  Jdb_symbol::match_addrs_to_symbols(_sym_offs, _syms, count, 0);
+}
+
 static void
 Jdb_tbuf_show::error(const char * const msg)
 {
@@ -415,9 +439,18 @@ Jdb_tbuf_show::show_events(Mword n, Mword ref, Mword count, Unsigned8 mode,
 
       if (long_output)
 	{
-	  char s[3];
+	  char s[3], sym[64];
 	  Jdb_tbuf_output::print_entry(n, _buffer_str, sizeof(_buffer_str));
 
+	  if (i % Sym_batch == 0)
+	    symbolize(n, count - i < (Mword)Sym_batch ? count - i : (Mword)Sym_batch);
+
+	  if (_syms[i % Sym_batch])
+	    snprintf(sym, sizeof(sym), "  %s+%lx", _syms[i % Sym_batch],
+		     _sym_offs[i % Sym_batch]);
+	  else
+	    sym[0] = '\0';
+
 	  if (!Jdb_tbuf::diff_tsc(n, &dtsc))
 	    dtsc = 0;
 
@@ -444,8 +477,8 @@ Jdb_tbuf_show::show_events(Mword n, Mword ref, Mword count, Unsigned8 mode,
 	  Jdb::write_ll_dec(utsc, s_tsc_sc, sizeof(s_tsc_sc), false);
 	  Jdb::write_tsc_s (utsc, s_tsc_ss, sizeof(s_tsc_ss), false);
 
-	  printf("%-3s%10lu.  %120.120s %13.13s (%14.14s)  %13.13s (%14.14s) kclk=%d\n",
-		 s, number, _buffer_str+y_offset, s_tsc_dc, s_tsc_ds, s_tsc_sc, s_tsc_ss, kclock);
+	  printf("%-3s%10lu.  %120.120s %13.13s (%14.14s)  %13.13s (%14.14s) kclk=%d%s\n",
+		 s, number, _buffer_str+y_offset, s_tsc_dc, s_tsc_ds, s_tsc_sc, s_tsc_ss, kclock, sym);
 	}
       else
 	{
@@ -748,6 +781,20 @@ restart:
 	  printf("\033[31m%3lu%% filtered\033[m\n",
 	      entries*100/Jdb_tbuf::max_entries());
 	}
+      else if (Jdb_tbuf::num_rings() > Cpu_number(1))
+	{
+	  // one ring per CPU: show the fill level of the fullest ring
+	  Mword fill = 0;
+	  for (Cpu_number cpu = Cpu_number::first();
+	       cpu < Jdb_tbuf::num_rings(); ++cpu)
+	    if (Jdb_tbuf::ring_entries(cpu) > fill)
+	      fill = Jdb_tbuf::ring_entries(cpu);
+
+	  Jdb::cursor(2, 1);
+	  printf("%3u rings, max %3lu%%\n",
+	      cxx::int_value<Cpu_number>(Jdb_tbuf::num_rings()),
+	      fill*100/Jdb_tbuf::max_ring_entries());
+	}
       for (Mword i=3; i<Tbuf_start_line; i++)
 	puts("\033[K");
 
@@ -6,6 +6,50 @@ public:
   static bool is_mapped(void const *addr);
 };
 
+IMPLEMENTATION:
+
+/**
+ * Sort `n` elements of `a` in place (heap sort, no extra memory).
+ * @param less  strict weak order, `less(x, y)` iff x goes before y
+ */
+PUBLIC static
+template< typename T, typename LESS >
+void
+Jdb_util::sort(T *a, unsigned long n, LESS less)
+{
+  if (n < 2)
+    return;
+
+  for (unsigned long i = n; i--; )
+    sift_down(a, i, n, less);
+
+  for (unsigned long end = n - 1; end > 0; --end)
+    {
+      T t = a[0];
+      a[0] = a[end];
+      a[end] = t;
+      sift_down(a, 0, end, less);
+    }
+}
+
+PRIVATE static
+template< typename T, typename LESS >
+void
+Jdb_util::sift_down(T *a, unsigned long root, unsigned long n, LESS less)
+{
+  for (unsigned long child; (child = 2 * root + 1) < n; root = child)
+    {
+      if (child + 1 < n && less(a[child], a[child + 1]))
+        ++child;
+      if (!less(a[root], a[child]))
+        return;
+
+      T t = a[root];
+      a[root] = a[child];
+      a[child] = t;
+    }
+}
+
 IMPLEMENTATION[ia32|ux|amd64]:
 
 #include "kmem.h"
@@ -62,6 +62,14 @@ public:
     Unsigned8 len;
   } __attribute__((packed));
 
+  struct Lapic : public Apic_head
+  {
+    enum { Enabled = 1 };
+    Unsigned8  acpi_id;
+    Unsigned8  apic_id;
+    Unsigned32 flags;
+  } __attribute__((packed));
+
   struct Io_apic : public Apic_head
   {
     Unsigned8 id;
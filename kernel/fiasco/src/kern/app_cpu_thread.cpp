@@ -19,6 +19,7 @@ IMPLEMENTATION [mp]:
 #include "globals.h"
 #include "helping_lock.h"
 #include "kernel_task.h"
+#include "kmem_alloc.h"
 #include "processor.h"
 #include "scheduler.h"
 #include "task.h"
@@ -69,6 +70,7 @@ App_cpu_thread::bootstrap()
   _tramp_mp_spinlock.set(1);
 
   kernel_context(cpu(true), this);
+  Sched_context::reserve_ready_queue(cpu(true));
   Sched_context::rq.current().set_idle(this->sched());
   Rcu::leave_idle(cpu(true));
 
@@ -87,5 +89,9 @@ App_cpu_thread::bootstrap()
   printf("CPU[%u]: goes to idle loop\n", cxx::int_value<Cpu_number>(cpu(true)));
 
   for (;;)
-    idle_op();
+    {
+      steal_work();
+      Kmem_alloc::allocator()->refill_zeroed(cpu(true));
+      idle_op();
+    }
 }
@@ -7,7 +7,7 @@ class Space;
 class Mapping_entry
 {
 public:
-  enum { Alignment = 4 };
+  enum { Alignment = 4, Tree_offs_bits = 12 };
   union 
   {
     struct 
@@ -15,6 +15,7 @@ public:
       unsigned long _space:32;	///< Address-space number
 /*      unsigned long _pad:1; */
       unsigned long address:20;	///< Virtual address in address space
+      unsigned long tree_offs:Tree_offs_bits; ///< Hint: array offset to tree root
     } data;
     Treemap *_submap;
   };
@@ -102,6 +102,17 @@ Mem_space::tlb_flush_spaces(bool all, Mem_space *s1, Mem_space *s2)
     }
 }
 
+/**
+ * Flush the TLB entries of a range of a space on the current CPU.
+ * With ASIDs this is a flush of the space's ASID.
+ */
+PUBLIC static inline NEEDS[Mem_space::tlb_flush_spaces]
+void
+Mem_space::tlb_flush_range(Tlb_range const &r)
+{
+  tlb_flush_spaces(false, r.space, 0);
+}
+
 
 IMPLEMENT inline
 Mem_space *Mem_space::current_mem_space(Cpu_number cpu)
@@ -124,7 +135,7 @@ Mem_space::set_attributes(Virt_addr virt, Attr page_attribs,
   return true;
 }
 
-IMPLEMENT inline NEEDS ["kmem.h", Mem_space::c_asid]
+IMPLEMENT inline NEEDS ["kmem.h", Mem_space::c_asid, Mem_space::tlb_mark_active]
 void Mem_space::switchin_context(Mem_space *from)
 {
 #if 0
@@ -133,6 +144,10 @@ void Mem_space::switchin_context(Mem_space *from)
     return;
 #endif
 
+  // entries tagged with our ASID survive switches, so the CPU stays
+  // marked
+  tlb_mark_active(current_cpu());
+
   if (from != this)
     make_current();
   else
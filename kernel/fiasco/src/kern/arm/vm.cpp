@@ -118,7 +118,7 @@ Vm::map_max_address() const
 { return Page_number(1UL << (MWORD_BITS - Mem_space::Page_shift)); }
 
 PUBLIC static
-Slab_cache *
+Kmem_slab *
 Vm::allocator()
 { return &Vm_allocator::a; }
 
@@ -84,6 +84,8 @@ public:
     Have_frame_ptr = 1,
 #endif
     Mapdb_ram_only = 0,
+    // log2 size of the window a pager may map around a page fault
+    Pf_around_shift = 16,
 #ifdef CONFIG_DEBUG_KERNEL_PAGE_FAULTS
     Log_kernel_page_faults = 1,
 #else
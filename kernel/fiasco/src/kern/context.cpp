@@ -1309,6 +1309,7 @@ Context::Drq_q::execute_request(Drq *r, Drop_mode drop, bool local)
 	  l->wait = 0;
       );
       // r->state = Drq::Idle;
+      CNT_DRQ;
       unsigned answer = 0;
       //LOG_MSG_3VAL(current(), "hrq", current_cpu() | (drop ? 0x100: 0), (Mword)r->context(), (Mword)r->func);
       if (EXPECT_TRUE(drop == No_drop && r->func))
@@ -1416,6 +1417,15 @@ bool
 Context::drq_pending() const
 { return _drq_q.first(); }
 
+/**
+ * \brief Take a request that has not been handled yet out of the DRQ queue.
+ * \return true if `drq` was dequeued, false if it is not queued here.
+ */
+PUBLIC inline
+bool
+Context::dequeue_drq(Drq *drq)
+{ return _drq_q.dequeue(drq, Queue_item::Invalid); }
+
 PUBLIC inline
 void
 Context::try_finish_migration()
@@ -1748,6 +1758,11 @@ void
 Context::xcpu_tlb_flush(bool, Mem_space *, Mem_space *)
 {}
 
+PUBLIC static inline
+void
+Context::xcpu_tlb_flush_ranges(Mem_space::Tlb_range const *, unsigned)
+{}
+
 
 
 //----------------------------------------------------------------------------
@@ -2073,9 +2088,66 @@ Context::xcpu_tlb_flush(bool flush_all_spaces, Mem_space *s1, Mem_space *s2)
   auto g = lock_guard(cpu_lock);
   Mem_space *s[3] = { (Mem_space *)flush_all_spaces, s1, s2 };
   Cpu_number ccpu = current_cpu();
+
+  // page-table updates must be visible before we sample the CPU sets
+  Mem::mp_mb();
   for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
-    if (ccpu != i && _tlb_active.get(i))
-      current()->global_drq(i, Context::handle_remote_tlb_flush, s);
+    if (ccpu != i && _tlb_active.get(i)
+        && (flush_all_spaces
+            || (s1 && s1->tlb_cpus().get(i))
+            || (s2 && s2->tlb_cpus().get(i))))
+      {
+        CNT_XCPU_TLB_FLUSH;
+        current()->global_drq(i, Context::handle_remote_tlb_flush, s);
+      }
+}
+
+namespace {
+struct Tlb_range_rq
+{
+  Mem_space::Tlb_range const *r;
+  unsigned n;
+};
+}
+
+PRIVATE static
+unsigned
+Context::handle_remote_tlb_flush_ranges(Drq *, Context *, void *_rq)
+{
+  Tlb_range_rq const *rq = reinterpret_cast<Tlb_range_rq const *>(_rq);
+  for (unsigned i = 0; i < rq->n; ++i)
+    Mem_space::tlb_flush_range(rq->r[i]);
+
+  return 0;
+}
+
+/**
+ * Flush the given address ranges on all other CPUs that may hold TLB
+ * entries of the respective spaces.
+ */
+PUBLIC static
+void
+Context::xcpu_tlb_flush_ranges(Mem_space::Tlb_range const *r, unsigned n)
+{
+  auto g = lock_guard(cpu_lock);
+  Tlb_range_rq rq = { r, n };
+  Cpu_number ccpu = current_cpu();
+
+  Mem::mp_mb();
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    {
+      if (ccpu == i || !_tlb_active.get(i))
+        continue;
+
+      for (unsigned k = 0; k < n; ++k)
+        if (r[k].space->tlb_cpus().get(i))
+          {
+            CNT_XCPU_TLB_FLUSH;
+            current()->global_drq(i, Context::handle_remote_tlb_flush_ranges,
+                                  &rq);
+            break;
+          }
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -3,7 +3,7 @@ INTERFACE [debug]:
 #include "types.h"
 #include "lock_guard.h"
 #include "spin_lock.h"
-#include "slab_cache.h"
+#include "kmem_slab.h"
 #include <cxx/slist>
 
 class Dbg_page_info_table;
@@ -20,7 +20,7 @@ private:
   char *b() { return reinterpret_cast<char*>(_buf); }
   char const *b() const { return reinterpret_cast<char const*>(_buf); }
 
-  typedef Slab_cache Allocator;
+  typedef Kmem_slab Allocator;
 
 public:
   void *operator new (size_t) throw() { return alloc()->alloc(); }
@@ -64,7 +64,6 @@ private:
 
 IMPLEMENTATION [debug]:
 
-#include "kmem_slab.h"
 
 
 static Dbg_page_info_table _t;
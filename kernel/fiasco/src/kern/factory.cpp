@@ -2,7 +2,7 @@ INTERFACE:
 
 #include "fiasco_defs.h"
 #include "ram_quota.h"
-#include "slab_cache.h"
+#include "kmem_slab.h"
 #include "kobject_helper.h"
 
 class Factory : public Ram_quota, public Kobject_h<Factory>
@@ -10,14 +10,13 @@ class Factory : public Ram_quota, public Kobject_h<Factory>
   FIASCO_DECLARE_KOBJ();
 
 private:
-  typedef Slab_cache Self_alloc;
+  typedef Kmem_slab Self_alloc;
 };
 
 //---------------------------------------------------------------------------
 IMPLEMENTATION:
 
 #include "ipc_gate.h"
-#include "kmem_slab.h"
 #include "task.h"
 #include "thread_object.h"
 #include "static_init.h"
@@ -132,7 +131,7 @@ Factory::new_task(Utcb const *u, int *)
 PRIVATE inline NOEXPORT
 Kobject_iface *
 Factory::new_thread(Utcb const *, int *)
-{ return new (this) Thread_object(); }
+{ return Thread_object::create(this); }
 
 PRIVATE inline NOEXPORT
 Kobject_iface *
@@ -7,7 +7,9 @@ class Treemap;
 class Mapping_entry
 {
 public:
-  enum { Alignment = 1 };
+  // _space and address leave 4 bits of the 7 bytes of data for the
+  // tree-root hint, more would make each mapping a byte larger
+  enum { Alignment = 1, Tree_offs_bits = 4 };
 
   union 
     {
@@ -15,6 +17,7 @@ public:
 	{
 	  unsigned long _space:32;	///< Address-space number
 	  unsigned long address:20;	///< Virtual address in address space
+	  unsigned long tree_offs:Tree_offs_bits; ///< Hint: offset to tree root
         } __attribute__((packed)) data;
       Treemap *_submap;
     } __attribute__((packed));
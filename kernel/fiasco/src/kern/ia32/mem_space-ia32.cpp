@@ -131,6 +131,36 @@ Mem_space::tlb_flush_spaces(bool, Mem_space *, Mem_space *)
   tlb_flush();
 }
 
+/**
+ * Flush the TLB entries of a range of a space on the current CPU.
+ * Small ranges are invalidated page by page.  A CPU that does not run
+ * the space holds no entries of it, because switching the page table
+ * flushes all non-global entries, and drops out of the space's TLB CPU
+ * set.
+ */
+PUBLIC static inline NEEDS["mem_unit.h", "logdefs.h"]
+void
+Mem_space::tlb_flush_range(Tlb_range const &r)
+{
+  Cpu_number cpu = current_cpu();
+
+  if (r.space != _current.cpu(cpu))
+    {
+      r.space->tlb_mark_inactive(cpu);
+      return;
+    }
+
+  if (r.end - r.start > (Address)Tlb_range_max_pages << Config::PAGE_SHIFT)
+    {
+      Mem_unit::tlb_flush();
+      return;
+    }
+
+  CNT_TLB_FLUSH_RANGE;
+  for (Address a = r.start; a < r.end; a += Config::PAGE_SIZE)
+    Mem_unit::tlb_flush(a);
+}
+
 
 IMPLEMENT inline
 Mem_space *
@@ -372,12 +402,16 @@ IMPLEMENTATION [ia32 || amd64]:
 #include "config.h"
 #include "kmem.h"
 
-IMPLEMENT inline NEEDS ["cpu.h", "kmem.h"]
+IMPLEMENT inline NEEDS ["cpu.h", "kmem.h", Mem_space::tlb_mark_active]
 void
 Mem_space::make_current()
 {
+  Cpu_number cpu = current_cpu();
+  // mark before switching, so that a remote unmap that does not see the
+  // mark has finished its page-table updates
+  tlb_mark_active(cpu);
   Cpu::set_pdbr((Mem_layout::pmem_to_phys(_dir)));
-  _current.cpu(current_cpu()) = this;
+  _current.cpu(cpu) = this;
 }
 
 PUBLIC inline NEEDS ["kmem.h"]
@@ -99,21 +99,9 @@
 #endif
 
 
-#if defined(CONFIG_JDB) && defined(CONFIG_JDB_ACCOUNTING)
-
-#define CNT_CONTEXT_SWITCH	incl (VAL__MEM_LAYOUT__TBUF_STATUS_PAGE+ \
-				    OFS__TBUF_STATUS__KERNCNTS)
-#define CNT_ADDR_SPACE_SWITCH	incl (VAL__MEM_LAYOUT__TBUF_STATUS_PAGE+ \
-				    OFS__TBUF_STATUS__KERNCNTS + 4)
-#define CNT_SHORTCUT_FAILED	incl (VAL__MEM_LAYOUT__TBUF_STATUS_PAGE+ \
-				    OFS__TBUF_STATUS__KERNCNTS + 8)
-#define CNT_SHORTCUT_SUCCESS	incl (VAL__MEM_LAYOUT__TBUF_STATUS_PAGE+ \
-				    OFS__TBUF_STATUS__KERNCNTS + 12)
-#define CNT_IOBMAP_TLB_FLUSH	incl (VAL__MEM_LAYOUT__TBUF_STATUS_PAGE+ \
-				    OFS__TBUF_STATUS__KERNCNTS + 40)
-
-#else
-
+// The kernel event counters are kept per CPU (see Kern_cnt) and the
+// assembler fast path has no cheap way to find the current CPU's block,
+// so it does not count.
 #define CNT_CONTEXT_SWITCH
 #define CNT_ADDR_SPACE_SWITCH
 #define CNT_SHORTCUT_FAILED
@@ -121,5 +109,3 @@
 #define CNT_IOBMAP_TLB_FLUSH
 
 #endif
-
-#endif
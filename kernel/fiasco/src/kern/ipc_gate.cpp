@@ -1,13 +1,16 @@
 INTERFACE:
 
+#include "ipc_sender.h"
 #include "kobject.h"
 #include "kobject_helper.h"
 #include "ref_ptr.h"
-#include "slab_cache.h"
+#include "kmem_slab.h"
+#include "spin_lock.h"
 #include "thread_object.h"
 
 class Ram_quota;
 
+class Ipc_gate;
 class Ipc_gate_obj;
 
 class Ipc_gate_ctl : public Kobject_h<Ipc_gate_ctl, Kobject_iface>
@@ -15,14 +18,79 @@ class Ipc_gate_ctl : public Kobject_h<Ipc_gate_ctl, Kobject_iface>
 private:
   enum Operation
   {
-    Op_bind     = 0x10,
-    Op_get_info = 0x11,
+    Op_bind        = 0x10,
+    Op_get_info    = 0x11,
+    Op_set_queue   = 0x12,
+    Op_queue_stats = 0x13,
+  };
+};
+
+/**
+ * Bounded queue for asynchronous sends through an IPC gate.
+ *
+ * Send-only invocations of a gate with a queue copy short messages into
+ * the queue instead of waiting for the bound thread.  While the queue
+ * holds messages it sits in the sender list of the bound thread, like an
+ * IRQ, and hands out one message per receive operation of that thread.
+ */
+class Ipc_gate_queue : public Ipc_sender<Ipc_gate_queue>
+{
+  friend class Ipc_gate;
+  friend class Ipc_gate_ctl;
+
+public:
+  enum Overflow_policy
+  {
+    Ov_reject      = 0, ///< fail the send with a timeout error
+    Ov_drop_oldest = 1, ///< overwrite the oldest queued message
+    Ov_sync        = 2, ///< fall back to a synchronous send
   };
+
+  enum
+  {
+    Msg_words = 6,
+    Max_slots = 1024,
+  };
+
+private:
+  struct Msg
+  {
+    Mword tag;
+    Mword label;
+    Mword words[Msg_words];
+  };
+
+  enum { Min_slots = 1024 / sizeof(Msg) };
+
+  Spin_lock<> _lock;
+  Ipc_gate *_gate;
+  Msg *_msgs;
+  unsigned _slots;
+  unsigned _policy;
+  // free-running indices, protected by _lock
+  unsigned _head;
+  unsigned _tail;
+  // messages left after the last transfer_msg()
+  unsigned _left;
+  // remote notification: 0 idle, 1 request posted to _drq_target,
+  // 2 posted and a send raced with it (see handle_remote_notify())
+  Mword _drq_pending;
+  Context *_drq_target;
+  Context::Drq _drq;
+  // previously bound thread while the gate is rebound or destroyed,
+  // see detach()
+  Ref_ptr<Thread> _detached_from;
+
+  Mword _sent;
+  Mword _delivered;
+  Mword _dropped;
+  unsigned _max_depth;
 };
 
 class Ipc_gate : public Kobject
 {
   friend class Ipc_gate_ctl;
+  friend class Ipc_gate_queue;
   friend class Jdb_sender_list;
 protected:
 
@@ -30,6 +98,7 @@ protected:
   Mword _id;
   Ram_quota *_quota;
   Locked_prio_list _wait_q;
+  Ipc_gate_queue *_queue;
 };
 
 class Ipc_gate_obj : public Ipc_gate, public Ipc_gate_ctl
@@ -38,7 +107,7 @@ class Ipc_gate_obj : public Ipc_gate, public Ipc_gate_ctl
 
 private:
   friend class Ipc_gate;
-  typedef Slab_cache Self_alloc;
+  typedef Kmem_slab Self_alloc;
 
 public:
   bool put() { return Ipc_gate::put(); }
@@ -47,6 +116,7 @@ public:
   Mword id() const { return _id; }
   Mword obj_id() const { return _id; }
   bool is_local(Space *s) const { return _thread && _thread->space() == s; }
+  Ipc_gate_queue const *queue() const { return _queue; }
 };
 
 //---------------------------------------------------------------------------
@@ -73,10 +143,13 @@ IMPLEMENTATION:
 #include <cstddef>
 
 #include "assert_opt.h"
+#include "cpu_lock.h"
 #include "entry_frame.h"
 #include "ipc_timeout.h"
-#include "kmem_slab.h"
+#include "kmem_alloc.h"
+#include "lock_guard.h"
 #include "logdefs.h"
+#include "processor.h"
 #include "ram_quota.h"
 #include "static_init.h"
 #include "thread.h"
@@ -102,7 +175,7 @@ Ipc_gate_obj::downgrade(unsigned long attr)
 
 PUBLIC inline
 Ipc_gate::Ipc_gate(Ram_quota *q, Thread *t, Mword id)
-  : _thread(t), _id(id), _quota(q), _wait_q()
+  : _thread(t), _id(id), _quota(q), _wait_q(), _queue(0)
 {}
 
 PUBLIC inline
@@ -145,6 +218,10 @@ void
 Ipc_gate_obj::destroy(Kobject ***r)
 {
   Kobject::destroy(r);
+  // the queue leaves the sender list of the thread when it is freed,
+  // after the grace period of the deletion
+  if (_queue)
+    _queue->detach();
   _thread = 0;
   unblock_all();
 }
@@ -153,6 +230,8 @@ PUBLIC
 Ipc_gate_obj::~Ipc_gate_obj()
 {
   unblock_all();
+  if (_queue)
+    _queue->free(_quota);
 }
 
 PUBLIC inline NEEDS[<cstddef>]
@@ -195,6 +274,341 @@ void Ipc_gate_obj::operator delete (void *_f)
     p->free(sizeof(Ipc_gate_obj));
 }
 
+// ------------------------------------------------------------------------
+// Asynchronous send queue
+
+static Kmem_slab_t<Ipc_gate_queue> _ipc_gate_queue_allocator("Ipc_gate_queue");
+
+PUBLIC inline
+Ipc_gate_queue::Ipc_gate_queue(Ipc_gate *g, void *msgs, unsigned slots,
+                               unsigned policy)
+: _gate(g), _msgs((Msg *)msgs), _slots(slots), _policy(policy),
+  _head(0), _tail(0), _left(0), _drq_pending(0), _drq_target(0),
+  _sent(0), _delivered(0), _dropped(0), _max_depth(0)
+{ _lock.init(); }
+
+PUBLIC inline NEEDS[<cstddef>]
+void *
+Ipc_gate_queue::operator new (size_t, void *b) throw()
+{ return b; }
+
+/**
+ * Allocate a queue of at least `slots` messages for gate `g`.
+ * The number of slots is rounded up to a power of two of at least
+ * Min_slots; the caller limits it to Max_slots.
+ */
+PUBLIC static
+Ipc_gate_queue *
+Ipc_gate_queue::create(Ram_quota *q, Ipc_gate *g, unsigned slots,
+                       unsigned policy)
+{
+  unsigned n = Min_slots;
+  while (n < slots)
+    n <<= 1;
+
+  void *msgs = Kmem_alloc::allocator()->q_unaligned_alloc(q, n * sizeof(Msg));
+  if (EXPECT_FALSE(!msgs))
+    return 0;
+
+  void *b = _ipc_gate_queue_allocator.q_alloc(q);
+  if (EXPECT_FALSE(!b))
+    {
+      Kmem_alloc::allocator()->q_unaligned_free(q, n * sizeof(Msg), msgs);
+      return 0;
+    }
+
+  return new (b) Ipc_gate_queue(g, msgs, n, policy);
+}
+
+PUBLIC
+void
+Ipc_gate_queue::free(Ram_quota *q)
+{
+  complete_detach();
+  Kmem_alloc::allocator()->q_unaligned_free(q, _slots * sizeof(Msg), _msgs);
+  this->~Ipc_gate_queue();
+  _ipc_gate_queue_allocator.q_free(q, this);
+}
+
+PUBLIC inline
+unsigned
+Ipc_gate_queue::depth() const
+{ return access_once(&_tail) - access_once(&_head); }
+
+PUBLIC inline
+unsigned
+Ipc_gate_queue::slots() const
+{ return _slots; }
+
+PRIVATE
+void
+Ipc_gate_queue::post_notify(Thread *t)
+{
+  write_now(&_drq_target, static_cast<Context *>(t));
+  t->drq(&_drq, handle_remote_notify, this, 0,
+         Context::Drq::Target_ctxt, Context::Drq::No_wait);
+}
+
+/**
+ * Notification on the CPU of the bound thread.  The handler owns the queue
+ * until it clears _drq_pending and must not touch it afterwards, see
+ * cancel_notify().
+ */
+PRIVATE static
+unsigned
+Ipc_gate_queue::handle_remote_notify(Context::Drq *, Context *, void *arg)
+{
+  Ipc_gate_queue *q = (Ipc_gate_queue *)arg;
+
+  do
+    {
+      // sends from now on set _drq_pending to 2 to make us look again
+      write_now(&q->_drq_pending, Mword(1));
+
+      // a local send or a transfer may have raced with the request
+      Thread *t = q->_gate->_thread.ptr();
+      if (!t || q->_detached_from.ptr() || q->in_sender_list() || !q->depth())
+        continue;
+
+      if (EXPECT_FALSE(t->cpu() != current_cpu()))
+        {
+          // the thread migrated, follow it with the same request
+          q->post_notify(t);
+          return Context::Drq::No_answer;
+        }
+
+      q->send_msg(t);
+    }
+  while (!mp_cas(&q->_drq_pending, Mword(1), Mword(0)));
+
+  return Context::Drq::No_answer;
+}
+
+/**
+ * Withdraw a pending remote notification before the queue is freed: take
+ * the request out of the DRQ queue of its target, or wait until its
+ * handler is done on the other CPU.
+ */
+PRIVATE
+void
+Ipc_gate_queue::cancel_notify()
+{
+  auto guard = lock_guard(cpu_lock);
+  while (access_once(&_drq_pending))
+    {
+      // the request is not queued at a stale target, and not yet queued
+      // right after notify() set _drq_pending
+      Context *c = access_once(&_drq_target);
+      if (c && c->dequeue_drq(&_drq))
+        {
+          write_now(&_drq_pending, Mword(0));
+          return;
+        }
+
+      Proc::pause();
+    }
+}
+
+/**
+ * Queue became non-empty: enqueue into the sender list of the bound
+ * thread, or deliver directly if it is waiting.
+ */
+PRIVATE
+void
+Ipc_gate_queue::notify()
+{
+  Thread *t = _gate->_thread.ptr();
+  if (EXPECT_FALSE(!t))
+    return;
+
+  if (EXPECT_FALSE(t->cpu() != current_cpu()))
+    {
+      // a pending request looks at the queue again before it completes
+      Mword p;
+      do
+        p = access_once(&_drq_pending);
+      while (!mp_cas(&_drq_pending, p, p ? Mword(2) : Mword(1)));
+
+      if (!p)
+        post_notify(t);
+    }
+  else
+    send_msg(t);
+}
+
+/**
+ * Queue the message in `utcb` sent with `tag`.
+ * @return 0 if queued, 1 if the queue is full and the send shall fail,
+ *         -1 if the message shall be sent synchronously instead
+ */
+PUBLIC
+int
+Ipc_gate_queue::send(L4_msg_tag const &tag, Utcb const *utcb, Mword label)
+{
+  if (EXPECT_FALSE(tag.items() || tag.words() > Msg_words))
+    return -1;
+
+  bool was_empty;
+    {
+      auto g = lock_guard(_lock);
+      unsigned d = _tail - _head;
+      if (EXPECT_FALSE(d == _slots))
+        {
+          if (_policy == Ov_sync)
+            return -1;
+
+          ++_dropped;
+          if (_policy == Ov_reject)
+            return 1;
+
+          ++_head;
+          --d;
+        }
+
+      Msg *m = &_msgs[_tail & (_slots - 1)];
+      m->tag = L4_msg_tag(tag.words(), 0, 0, tag.proto()).raw();
+      m->label = label;
+      for (unsigned i = 0; i < tag.words(); ++i)
+        m->words[i] = utcb->values[i];
+
+      ++_tail;
+      ++_sent;
+      if (d + 1 > _max_depth)
+        _max_depth = d + 1;
+      // a detached queue leaves the threads alone
+      was_empty = d == 0 && !_detached_from.ptr();
+    }
+
+  if (was_empty)
+    notify();
+
+  return 0;
+}
+
+PUBLIC inline
+Syscall_frame *
+Ipc_gate_queue::transfer_msg(Receiver *recv)
+{
+  Syscall_frame *dst_regs = recv->rcv_regs();
+  Utcb *dst = recv->utcb().access();
+
+  auto g = lock_guard(_lock);
+  if (EXPECT_FALSE(_head == _tail))
+    {
+      // dropped by complete_detach() after we got the receiver
+      dst_regs->tag(L4_msg_tag(0, 0, 0, 0));
+      dst_regs->from(_gate->_id);
+      _left = 0;
+      return dst_regs;
+    }
+
+  Msg const *m = &_msgs[_head & (_slots - 1)];
+  L4_msg_tag tag(m->tag);
+  for (unsigned i = 0; i < tag.words(); ++i)
+    dst->values[i] = m->words[i];
+
+  dst_regs->tag(tag);
+  dst_regs->from(m->label);
+
+  ++_head;
+  ++_delivered;
+  _left = _tail - _head;
+  return dst_regs;
+}
+
+PUBLIC inline
+bool
+Ipc_gate_queue::dequeue_sender()
+{ return _left == 0; }
+
+PUBLIC inline
+bool
+Ipc_gate_queue::requeue_sender()
+{ return _left != 0; }
+
+PUBLIC
+void
+Ipc_gate_queue::modify_label(Mword const *todo, int cnt)
+{
+  auto g = lock_guard(_lock);
+  for (unsigned x = _head; x != _tail; ++x)
+    {
+      Msg *m = &_msgs[x & (_slots - 1)];
+      for (int i = 0; i < cnt*4; i += 4)
+        if ((m->label & todo[i]) == todo[i+1])
+          {
+            m->label = (m->label & ~todo[i+2]) | todo[i+3];
+            break;
+          }
+    }
+}
+
+/** Drop all queued messages. */
+PRIVATE
+void
+Ipc_gate_queue::drop_all()
+{
+  auto g = lock_guard(_lock);
+  _dropped += _tail - _head;
+  _head = _tail;
+}
+
+PUBLIC
+void
+Ipc_gate_queue::ipc_receiver_aborted()
+{
+  Ipc_sender<Ipc_gate_queue>::ipc_receiver_aborted();
+  drop_all();
+}
+
+/**
+ * Stop notifying the bound thread, before the gate is rebound or
+ * destroyed.  The queue stays in the sender list of that thread until
+ * complete_detach(), which the caller must call after switching the
+ * thread of the gate and waiting for a grace period: only then no send
+ * that may still enqueue the queue at the old thread is in flight.
+ */
+PUBLIC
+void
+Ipc_gate_queue::detach()
+{
+  _detached_from = _gate->_thread.ptr();
+  Mem::mp_mb();
+}
+
+/**
+ * Remove the queue from the sender list of the thread it was detached
+ * from and drop the queued messages.
+ */
+PRIVATE
+void
+Ipc_gate_queue::complete_detach()
+{
+  auto guard = lock_guard(cpu_lock);
+  cancel_notify();
+
+  Ref_ptr<Thread> old(_detached_from.ptr());
+  if (old)
+    old->Receiver::abort_send(this);
+
+  // sends from now on notify the new thread again
+  auto g = lock_guard(_lock);
+  _dropped += _tail - _head;
+  _head = _tail;
+  _detached_from = 0;
+}
+
+PUBLIC
+void
+Ipc_gate_queue::stats(Mword *v) const
+{
+  v[0] = depth();
+  v[1] = _max_depth;
+  v[2] = _sent;
+  v[3] = _delivered;
+  v[4] = _dropped;
+}
+
 PRIVATE inline NOEXPORT NEEDS["assert_opt.h"]
 L4_msg_tag
 Ipc_gate_ctl::bind_thread(L4_obj_ref, L4_fpage::Rights,
@@ -222,6 +636,9 @@ Ipc_gate_ctl::bind_thread(L4_obj_ref, L4_fpage::Rights,
 
 
   Ipc_gate_obj *g = static_cast<Ipc_gate_obj*>(this);
+  Ipc_gate_queue *q = access_once(&g->_queue);
+  if (q)
+    q->detach();
   g->_id = in->values[1];
   Mem::mp_wmb();
   g->_thread = t;
@@ -229,6 +646,8 @@ Ipc_gate_ctl::bind_thread(L4_obj_ref, L4_fpage::Rights,
   g->unblock_all();
   c_thread->rcu_wait();
   g->unblock_all();
+  if (q)
+    q->complete_detach();
 
   return commit_result(0);
 }
@@ -243,6 +662,60 @@ Ipc_gate_ctl::get_infos(L4_obj_ref, L4_fpage::Rights,
   return commit_result(0, 1);
 }
 
+/**
+ * Set up the asynchronous send queue of the gate: values[1] is the
+ * minimum number of slots, values[2] the overflow policy.  The queue
+ * cannot be resized once it exists, later calls only change the policy.
+ */
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Ipc_gate_ctl::set_queue(L4_obj_ref, L4_fpage::Rights,
+                        Syscall_frame *f, Utcb const *in, Utcb *)
+{
+  if (f->tag().words() < 3)
+    return commit_result(-L4_err::EInval);
+
+  Mword slots = in->values[1];
+  Mword policy = in->values[2];
+  if (policy > Ipc_gate_queue::Ov_sync || slots > Ipc_gate_queue::Max_slots)
+    return commit_result(-L4_err::EInval);
+
+  Ipc_gate_obj *g = static_cast<Ipc_gate_obj*>(this);
+  if (Ipc_gate_queue *q = access_once(&g->_queue))
+    {
+      write_now(&q->_policy, unsigned(policy));
+      return commit_result(0);
+    }
+
+  Ipc_gate_queue *q = Ipc_gate_queue::create(g->_quota, g, slots, policy);
+  if (!q)
+    return commit_result(-L4_err::ENomem);
+
+  Mem::mp_wmb();
+  if (!mp_cas(&g->_queue, (Ipc_gate_queue *)0, q))
+    {
+      // a concurrent set_queue installed its queue first
+      q->free(g->_quota);
+      write_now(&g->_queue->_policy, unsigned(policy));
+    }
+
+  return commit_result(0);
+}
+
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Ipc_gate_ctl::queue_stats(L4_obj_ref, L4_fpage::Rights,
+                          Syscall_frame *, Utcb const *, Utcb *out)
+{
+  Ipc_gate_obj *g = static_cast<Ipc_gate_obj*>(this);
+  if (!g->_queue)
+    return commit_result(-L4_err::ENoent);
+
+  out->values[0] = g->_queue->slots();
+  g->_queue->stats(&out->values[1]);
+  return commit_result(0, 6);
+}
+
 PUBLIC
 void
 Ipc_gate_ctl::invoke(L4_obj_ref self, L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
@@ -273,6 +746,10 @@ Ipc_gate_ctl::kinvoke(L4_obj_ref self, L4_fpage::Rights rights,
       return bind_thread(self, rights, f, in, out);
     case Op_get_info:
       return get_infos(self, rights, f, in, out);
+    case Op_set_queue:
+      return set_queue(self, rights, f, in, out);
+    case Op_queue_stats:
+      return queue_stats(self, rights, f, in, out);
     default:
       return static_cast<Ipc_gate_obj*>(this)->kobject_invoke(self, rights, f, in, out);
     }
@@ -350,6 +827,21 @@ Ipc_gate::invoke(L4_obj_ref /*self*/, L4_fpage::Rights rights, Syscall_frame *f,
 	}
     }
 
+  // send-only invocations of a gate with a queue do not wait for the thread
+  if (Ipc_gate_queue *q = access_once(&_queue))
+    if (f->ref().op() == L4_obj_ref::Ipc_send)
+      switch (q->send(f->tag(), utcb, _id | cxx::int_value<L4_fpage::Rights>(rights)))
+        {
+        case 0:
+          f->tag(L4_msg_tag(f->tag(), 0));
+          return;
+        case 1:
+          f->tag(commit_error(utcb, L4_error::Timeout));
+          return;
+        default:
+          break;
+        }
+
   bool ipc = _thread->check_sys_ipc(f->ref().op(), &partner, &sender, &have_rcv);
 
   LOG_TRACE("IPC Gate invoke", "gate", current(), Log_ipc_gate_invoke,
@@ -2,13 +2,16 @@ INTERFACE:
 
 #include "ipc_sender.h"
 #include "irq_chip.h"
+#include "kmem_slab.h"
 #include "kobject_helper.h"
 #include "member_offs.h"
 #include "sender.h"
 #include "context.h"
+#include "timeout.h"
 
 class Ram_quota;
 class Receiver;
+class Irq_sender;
 
 
 /** Hardware interrupts.  This class encapsulates handware IRQs.  Also,
@@ -21,7 +24,7 @@ class Irq : public Irq_base, public Kobject
   FIASCO_DECLARE_KOBJ();
 
 private:
-  typedef Slab_cache Allocator;
+  typedef Kmem_slab Allocator;
 
 public:
   enum Op
@@ -31,6 +34,7 @@ public:
     Op_trigger    = 2,
     Op_chain      = 3,
     Op_eoi_2      = 4,
+    Op_coalesce   = 5,
   };
 
 private:
@@ -42,8 +46,25 @@ protected:
 };
 
 
+/**
+ * Delivers the interrupts coalesced by an Irq_sender when its time
+ * threshold expires.
+ */
+class Irq_coalesce_timeout : public Timeout
+{
+  friend class Irq_sender;
+  Irq_sender *_irq;
+};
+
 /**
  * IRQ Kobject to send IPC messages to a receiving thread.
+ *
+ * In coalescing mode (see sys_coalesce()) an edge-triggered Irq_sender
+ * accumulates interrupts and sends one notification for a batch, carrying
+ * the number of interrupts in MR0.  A batch is delivered when it reaches
+ * the count threshold, or when the time threshold has passed since its
+ * first interrupt.  At most one notification is outstanding; interrupts
+ * arriving meanwhile go with it or with the next batch.
  */
 class Irq_sender
 : public Kobject_h<Irq_sender, Irq>,
@@ -52,7 +73,14 @@ class Irq_sender
 public:
   Mword kobject_size() const { return sizeof(*this); }
 
+  enum Coalesce_flags
+  {
+    Coalesce_mask  = 1, ///< keep the IRQ masked until the handler's EOI
+    Coalesce_query = 2, ///< only return the statistics
+  };
+
 private:
+  friend class Irq_coalesce_timeout;
   Irq_sender(Irq_sender &);
 
 protected:
@@ -60,7 +88,21 @@ protected:
   Receiver *_irq_thread;
 
 private:
+  enum { Co_no_cpu = ~0UL };
+
   Mword _irq_id;
+
+  Mword _co_max;        ///< count threshold, 0 for none
+  Unsigned32 _co_us;    ///< time threshold in us, 0 for none
+  bool _co_mask;
+  Smword _co_pending;   ///< interrupts not yet handed to a notification
+  Mword _co_cpu;        ///< CPU _co_timeout is armed on, or Co_no_cpu
+  Irq_coalesce_timeout _co_timeout;
+
+  // coalescing statistics
+  Mword _co_hits;
+  Mword _co_msgs;
+  Mword _co_max_batch;
 };
 
 
@@ -105,7 +147,6 @@ IMPLEMENTATION:
 #include "globals.h"
 #include "ipc_sender.h"
 #include "kdb_ke.h"
-#include "kmem_slab.h"
 #include "lock_guard.h"
 #include "minmax.h"
 #include "receiver.h"
@@ -113,6 +154,7 @@ IMPLEMENTATION:
 #include "thread_object.h"
 #include "thread_state.h"
 #include "l4_buf_iter.h"
+#include "timer.h"
 #include "vkey.h"
 
 FIASCO_DEFINE_KOBJ(Irq);
@@ -367,16 +409,27 @@ Irq_sender::free(Receiver *t)
 
 PUBLIC explicit
 Irq_sender::Irq_sender(Ram_quota *q = 0)
-: Kobject_h<Irq_sender, Irq>(q), _queued(0), _irq_thread(0), _irq_id(~0UL)
+: Kobject_h<Irq_sender, Irq>(q), _queued(0), _irq_thread(0), _irq_id(~0UL),
+  _co_max(0), _co_us(0), _co_mask(false), _co_pending(0), _co_cpu(Co_no_cpu),
+  _co_hits(0), _co_msgs(0), _co_max_batch(0)
 {
   hit_func = &hit_level_irq;
+  _co_timeout._irq = this;
 }
 
+PRIVATE inline
+bool
+Irq_sender::coalescing() const
+{ return _co_max > 1 || _co_us; }
+
 PUBLIC
 void
 Irq_sender::switch_mode(bool is_edge_triggered)
 {
-  hit_func = is_edge_triggered ? &hit_edge_irq : &hit_level_irq;
+  if (!is_edge_triggered)
+    hit_func = &hit_level_irq;
+  else
+    hit_func = coalescing() ? &hit_coalesced_irq : &hit_edge_irq;
 }
 
 PUBLIC
@@ -387,6 +440,10 @@ Irq_sender::destroy(Kobject ***rl)
   if (_irq_thread)
     free(_irq_thread);
 
+  _co_max = 0;
+  _co_us = 0;
+  co_stop_timeout();
+
   Irq::destroy(rl);
 }
 
@@ -409,6 +466,12 @@ Irq_sender::consume()
   if (old == 2 && hit_func == &hit_edge_irq)
     unmask();
 
+  // a full batch that missed the notification just sent
+  if (old == 1 && EXPECT_FALSE(hit_func == &hit_coalesced_irq)
+      && _co_max && access_once(&_co_pending) >= Smword(_co_max)
+      && mp_cas(&_queued, Smword(0), Smword(1)))
+    return 1;
+
   return old - 1;
 }
 
@@ -447,6 +510,21 @@ Irq_sender::transfer_msg(Receiver *recv)
   // set ipc return value: OK
   dst_regs->tag(L4_msg_tag(0));
 
+  if (EXPECT_FALSE(hit_func == &hit_coalesced_irq))
+    {
+      Smword n;
+      do
+        n = _co_pending;
+      while (!mp_cas(&_co_pending, n, Smword(0)));
+
+      recv->utcb().access()->values[0] = n;
+      dst_regs->tag(L4_msg_tag(1, 0, 0, 0));
+
+      ++_co_msgs;
+      if (Mword(n) > _co_max_batch)
+        _co_max_batch = n;
+    }
+
   // set ipc source thread id
   dst_regs->from(_irq_id);
 
@@ -566,6 +644,148 @@ void
 Irq_sender::hit_edge_irq(Irq_base *i, Upstream_irq const *ui)
 { nonull_static_cast<Irq_sender*>(i)->_hit_edge_irq(ui); }
 
+/**
+ * Send a notification for the coalesced interrupts, unless one is still
+ * outstanding; that one picks them up when it is delivered.
+ */
+PRIVATE
+void
+Irq_sender::co_deliver()
+{
+  assert (cpu_lock.test());
+
+  if (!access_once(&_co_pending) || !mp_cas(&_queued, Smword(0), Smword(1)))
+    return;
+
+  if (_co_mask)
+    mask();
+
+  count_and_send(0);
+}
+
+/**
+ * Arm the time threshold for a new batch, unless it is armed already,
+ * possibly on another CPU.
+ */
+PRIVATE
+void
+Irq_sender::co_arm()
+{
+  Mword cpu = cxx::int_value<Cpu_number>(current_cpu());
+  Mword owner = access_once(&_co_cpu);
+
+  if (owner != Co_no_cpu || !mp_cas(&_co_cpu, Mword(Co_no_cpu), cpu))
+    return;
+
+  _co_timeout.set(Timer::system_clock() + _co_us, current_cpu());
+}
+
+/** Runs on _co_cpu, the timeout is dequeued already. */
+PRIVATE
+bool
+Irq_sender::co_expired()
+{
+  if (access_once(&_co_pending) && access_once(&_queued))
+    {
+      // the handler has not picked up the last notification yet
+      _co_timeout.set(Timer::system_clock() + _co_us, current_cpu());
+      return false;
+    }
+
+  write_now(&_co_cpu, Mword(Co_no_cpu));
+  co_deliver();
+  return true;
+}
+
+PRIVATE
+bool
+Irq_coalesce_timeout::expired()
+{ return _irq->co_expired(); }
+
+/** Stop the time threshold if it is armed on the current CPU. */
+PRIVATE
+void
+Irq_sender::co_stop_local()
+{
+  if (access_once(&_co_cpu) != cxx::int_value<Cpu_number>(current_cpu()))
+    return;
+
+  if (_co_timeout.is_set())
+    _co_timeout.reset();
+
+  write_now(&_co_cpu, Mword(Co_no_cpu));
+}
+
+PUBLIC inline NEEDS[Irq_sender::co_deliver, Irq_sender::co_arm]
+void
+Irq_sender::_hit_coalesced_irq(Upstream_irq const *ui)
+{
+  assert (cpu_lock.test());
+  ack();
+  ui->ack();
+
+  Smword old;
+  do
+    old = _co_pending;
+  while (!mp_cas(&_co_pending, old, old + 1));
+
+  ++_co_hits;
+
+  if (_co_max && old + 1 >= Smword(_co_max))
+    co_deliver();
+  else if (_co_us)
+    co_arm();
+}
+
+PRIVATE static
+void
+Irq_sender::hit_coalesced_irq(Irq_base *i, Upstream_irq const *ui)
+{ nonull_static_cast<Irq_sender*>(i)->_hit_coalesced_irq(ui); }
+
+/**
+ * Configure interrupt coalescing.
+ *
+ * MR1 is the count threshold and MR2 the time threshold in microseconds;
+ * both zero (or a count of one without time) switch coalescing off.
+ * Coalescing is only available for edge-triggered IRQs.  The reply
+ * carries the number of interrupts, of notifications and the largest
+ * batch so far.
+ */
+PRIVATE
+L4_msg_tag
+Irq_sender::sys_coalesce(L4_msg_tag const &tag, Utcb const *utcb, Utcb *out)
+{
+  unsigned flags = utcb->values[0] >> 16;
+
+  if (!(flags & Coalesce_query))
+    {
+      if (tag.words() < 3)
+        return commit_result(-L4_err::EInval);
+
+      if (!_chip->is_edge_triggered(pin()))
+        return commit_result(-L4_err::EInval);
+
+      auto guard = lock_guard(cpu_lock);
+
+      // hand out what has been accumulated with the old parameters
+      if (hit_func == &hit_coalesced_irq)
+        co_deliver();
+
+      _co_max = utcb->values[1];
+      _co_us = utcb->values[2];
+      _co_mask = flags & Coalesce_mask;
+      if (!_co_us)
+        co_stop_timeout();
+
+      switch_mode(true);
+    }
+
+  out->values[0] = _co_hits;
+  out->values[1] = _co_msgs;
+  out->values[2] = _co_max_batch;
+  return commit_result(0, 3);
+}
+
 
 PRIVATE
 L4_msg_tag
@@ -610,7 +830,7 @@ Irq_sender::sys_attach(L4_msg_tag const &tag, Utcb const *utcb, Syscall_frame *
 PUBLIC
 L4_msg_tag
 Irq_sender::kinvoke(L4_obj_ref, L4_fpage::Rights /*rights*/, Syscall_frame *f,
-                    Utcb const *utcb, Utcb *)
+                    Utcb const *utcb, Utcb *out)
 {
   register Context *const c_thread = ::current();
   assert_opt (c_thread);
@@ -639,6 +859,8 @@ Irq_sender::kinvoke(L4_obj_ref, L4_fpage::Rights /*rights*/, Syscall_frame *f,
       log();
       hit(0);
       return no_reply();
+    case Op_coalesce:
+      return sys_coalesce(tag, utcb, out);
     default:
       return commit_result(-L4_err::EInval);
     }
@@ -649,6 +871,15 @@ Mword
 Irq_sender::obj_id() const
 { return _irq_id; }
 
+PUBLIC inline
+bool
+Irq_sender::coalesce_stats(Mword *hits, Mword *msgs) const
+{
+  *hits = _co_hits;
+  *msgs = _co_msgs;
+  return hit_func == &hit_coalesced_irq;
+}
+
 
 
  // Irq implementation
@@ -700,3 +931,40 @@ Irq::destroy(Kobject ***rl)
   Irq_base::destroy();
   Kobject::destroy(rl);
 }
+
+// ---------------------------------------------------------------------------
+IMPLEMENTATION [!mp]:
+
+PRIVATE inline NEEDS[Irq_sender::co_stop_local]
+void
+Irq_sender::co_stop_timeout()
+{ co_stop_local(); }
+
+// ---------------------------------------------------------------------------
+IMPLEMENTATION [mp]:
+
+PRIVATE static
+unsigned
+Irq_sender::handle_co_stop(Context::Drq *, Context *, void *arg)
+{
+  static_cast<Irq_sender*>(arg)->co_stop_local();
+  return 0;
+}
+
+/**
+ * Stop the time threshold on whatever CPU it is armed on.
+ * \pre new interrupts do not arm it anymore
+ */
+PRIVATE
+void
+Irq_sender::co_stop_timeout()
+{
+  Mword cpu;
+  while ((cpu = access_once(&_co_cpu)) != Co_no_cpu)
+    {
+      if (cpu == cxx::int_value<Cpu_number>(current_cpu()))
+        co_stop_local();
+      else
+        current()->global_drq(Cpu_number(cpu), handle_co_stop, this);
+    }
+}
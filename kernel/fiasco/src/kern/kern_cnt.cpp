@@ -1,7 +1,19 @@
 INTERFACE:
 
+#include "initcalls.h"
+#include "jdb_ktrace.h"
 #include "types.h"
 
+/**
+ * Kernel event counters.
+ *
+ * Each CPU counts into its own Tracebuffer_kern_cnt block, so counting
+ * needs neither a lock nor an atomic operation.  The blocks form one
+ * physically contiguous area whose physical address, order and per-CPU
+ * stride are published in the tracebuffer status page.  The two counter
+ * slots select the counters recorded in the two performance counter
+ * fields of tracebuffer entries.
+ */
 class Kern_cnt
 {
 private:
@@ -9,31 +21,103 @@ private:
     Max_slot = 2,
   };
 
-  static Mword *kcnt[Max_slot];
+  static Tracebuffer_kern_cnt *_cnt;
+  static int kcnt[Max_slot];
   static Mword (*read_kcnt_fn[Max_slot])();
 };
 
 
 IMPLEMENTATION:
 
-#include "jdb_ktrace.h"
-#include "mem_layout.h"
+#include <cstring>
+#include "config.h"
+#include "context_base.h"
+#include "kmem_alloc.h"
+#include "panic.h"
 #include "tb_entry.h"
 
-Mword *Kern_cnt::kcnt[Max_slot];
+Tracebuffer_kern_cnt *Kern_cnt::_cnt;
+int Kern_cnt::kcnt[Max_slot] = { -1, -1 };
 Mword (*Kern_cnt::read_kcnt_fn[Max_slot])() = { read_kcnt1, read_kcnt2 };
 
-static Mword Kern_cnt::read_kcnt1() { return *kcnt[0]; }
-static Mword Kern_cnt::read_kcnt2() { return *kcnt[1]; }
+/** Count event `num` on the current CPU. */
+PUBLIC static inline NEEDS["context_base.h"]
+void
+Kern_cnt::inc(unsigned num)
+{
+  if (EXPECT_TRUE(_cnt != 0))
+    ++_cnt[cxx::int_value<Cpu_number>(current_cpu())].cnt[num];
+}
+
+/** Add `n` to counter `num` on the current CPU. */
+PUBLIC static inline NEEDS["context_base.h"]
+void
+Kern_cnt::add(unsigned num, Mword n)
+{
+  if (EXPECT_TRUE(_cnt != 0))
+    _cnt[cxx::int_value<Cpu_number>(current_cpu())].cnt[num] += n;
+}
 
+PRIVATE static inline NEEDS["context_base.h"]
+Mword
+Kern_cnt::read_slot(int slot)
+{ return _cnt[cxx::int_value<Cpu_number>(current_cpu())].cnt[kcnt[slot]]; }
+
+static Mword Kern_cnt::read_kcnt1() { return read_slot(0); }
+static Mword Kern_cnt::read_kcnt2() { return read_slot(1); }
+
+/**
+ * Allocate the per-CPU counter blocks and publish them in the
+ * tracebuffer status page.
+ */
+PUBLIC static FIASCO_INIT
+void
+Kern_cnt::init(Tracebuffer_status *status)
+{
+  unsigned order = Config::PAGE_SHIFT;
+  while ((1UL << order) < sizeof(Tracebuffer_kern_cnt) * Tbuf_max_rings)
+    ++order;
+
+  void *a = Kmem_alloc::allocator()->alloc(order);
+  if (!a)
+    panic("Kern_cnt: cannot allocate counter area");
+
+  memset(a, 0, 1UL << order);
+
+  status->kerncnt_area   = Kmem_alloc::allocator()->to_phys(a);
+  status->kerncnt_order  = order;
+  status->kerncnt_stride = sizeof(Tracebuffer_kern_cnt);
+
+  _cnt = (Tracebuffer_kern_cnt *)a;
+}
+
+/** Value of counter `num` on `cpu`. */
+PUBLIC static inline
+Mword
+Kern_cnt::get(Cpu_number cpu, unsigned num)
+{ return _cnt ? _cnt[cxx::int_value<Cpu_number>(cpu)].cnt[num] : 0; }
+
+/** Sum of counter `num` over all CPUs. */
 PUBLIC static
-Mword*
-Kern_cnt::get_ctr(int num)
+Mword
+Kern_cnt::sum(unsigned num)
 {
-  Tracebuffer_status *status = 
-    (Tracebuffer_status*) Mem_layout::Tbuf_status_page;
+  if (!_cnt)
+    return 0;
+
+  Mword s = 0;
+  for (unsigned i = 0; i < Tbuf_max_rings; ++i)
+    s += access_once(&_cnt[i].cnt[num]);
+
+  return s;
+}
 
-  return (Mword*)(num < Kern_cnt_max ? status->kerncnts + num : 0);
+PUBLIC static
+void
+Kern_cnt::reset()
+{
+  if (_cnt)
+    memset(_cnt, 0, sizeof(Tracebuffer_kern_cnt) * Tbuf_max_rings);
 }
 
 PUBLIC static
@@ -44,16 +128,24 @@ Kern_cnt::get_str(Mword num)
     {
     case Kern_cnt_context_switch:    return "Context switches";
     case Kern_cnt_addr_space_switch: return "Address space switches";
-    case Kern_cnt_shortcut_failed:   return "IPC shortcut failed";
-    case Kern_cnt_shortcut_success:  return "IPC shortcut success";
-    case Kern_cnt_irq:               return "Long IPCs";
-    case Kern_cnt_ipc_long:          return "Hardware interrupts";
+    case Kern_cnt_shortcut_failed:   return "IPC slow path";
+    case Kern_cnt_shortcut_success:  return "IPC fast path";
+    case Kern_cnt_irq:               return "Hardware interrupts";
+    case Kern_cnt_ipc_long:          return "Long IPCs";
     case Kern_cnt_page_fault:        return "Page faults";
     case Kern_cnt_io_fault:          return "IO bitmap faults";
     case Kern_cnt_task_create:       return "Tasks created";
     case Kern_cnt_schedule:          return "Scheduler calls";
     case Kern_cnt_iobmap_tlb_flush:  return "IO bitmap TLB flushs";
     case Kern_cnt_exc_ipc:           return "Exception IPCs";
+    case Kern_cnt_xcpu_tlb_flush:    return "Remote TLB flushes";
+    case Kern_cnt_tlb_flush_range:   return "Ranged TLB flushes";
+    case Kern_cnt_drq:               return "DRQs handled";
+    case Kern_cnt_rcu_batch:         return "RCU batches";
+    case Kern_cnt_slab_alloc:        return "Slab allocations";
+    case Kern_cnt_timeout:           return "Timeouts fired";
+    case Kern_cnt_pf_around:         return "Fault-around replies";
+    case Kern_cnt_pf_around_pages:   return "Page faults avoided";
     default:                         return 0;
     }
 }
@@ -62,17 +154,9 @@ PUBLIC static
 int
 Kern_cnt::mode(Mword slot, const char **mode, const char **name, Mword *event)
 {
-  Mword *c = 0;
-
-  switch (slot)
-    {
-    case 0: c = kcnt[0]; break;
-    case 1: c = kcnt[1]; break;
-    }
-
-  if (c)
+  if (slot < Max_slot && kcnt[slot] >= 0)
     {
-      Mword num = c - get_ctr(0);
+      Mword num = kcnt[slot];
 
       *mode  = "on";
       *name  = get_str(num);
@@ -94,16 +178,16 @@ Kern_cnt::setup_pmc(Mword slot, Mword event)
 
   if (!(event & 0x80000000))
     {
-      kcnt[slot] = 0;
+      kcnt[slot] = -1;
       Tb_entry::set_rdcnt(slot, 0);
       return 0;
     }
 
   event &= 0xff;
-  if (event >= Kern_cnt_max)
+  if (event >= Kern_cnt_max || !_cnt)
     return 0;
 
-  kcnt[slot] = get_ctr(event);
+  kcnt[slot] = event;
   Tb_entry::set_rdcnt(slot, read_kcnt_fn[slot]);
   return 1;
 }
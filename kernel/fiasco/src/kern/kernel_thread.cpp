@@ -35,6 +35,7 @@ IMPLEMENTATION:
 #include "globals.h"
 #include "helping_lock.h"
 #include "kernel_task.h"
+#include "kmem_alloc.h"
 #include "per_cpu_data_alloc.h"
 #include "processor.h"
 #include "task.h"
@@ -42,6 +43,7 @@ IMPLEMENTATION:
 #include "thread_state.h"
 #include "timer.h"
 #include "timer_tick.h"
+#include "vlog.h"
 #include "watchdog.h"
 
 
@@ -72,6 +74,7 @@ Kernel_thread::bootstrap()
   state_change_dirty(0, Thread_ready);		// Set myself ready
 
   Timer::init_system_clock();
+  Sched_context::reserve_ready_queue(cpu(true));
   Sched_context::rq.current().set_idle(this->sched());
 
   Kernel_task::kernel_task()->make_current();
@@ -118,7 +121,36 @@ Kernel_thread::run()
   init_workload();
 
   for (;;)
-    idle_op();
+    {
+      steal_work();
+      Vlog::drain_idle();
+      Kmem_alloc::allocator()->refill_zeroed(cpu());
+      idle_op();
+    }
+}
+
+// ------------------------------------------------------------------------
+IMPLEMENTATION [!sched_steal]:
+
+PROTECTED inline
+void
+Kernel_thread::steal_work()
+{}
+
+// ------------------------------------------------------------------------
+IMPLEMENTATION [sched_steal]:
+
+#include "lock_guard.h"
+
+/**
+ * Ask a busy CPU for a ready thread before going to sleep.
+ */
+PROTECTED inline NEEDS["lock_guard.h", "thread.h"]
+void
+Kernel_thread::steal_work()
+{
+  auto guard = lock_guard(cpu_lock);
+  Thread::request_steal(cpu());
 }
 
 // ------------------------------------------------------------------------
@@ -57,6 +57,20 @@ public:
     return b;
   }
 
+  void *alloc_zeroed(unsigned long size) const
+  {
+    Auto_quota<Q> q(_q, size);
+    if (EXPECT_FALSE(!q))
+      return 0;
+
+    void *b;
+    if (EXPECT_FALSE(!(b=_a->unaligned_alloc_zeroed(size))))
+      return 0;
+
+    q.release();
+    return b;
+  }
+
   void free(void *block, unsigned long size) const
   {
     _a->unaligned_free(size, block);
@@ -76,14 +90,18 @@ private:
 IMPLEMENTATION:
 
 #include <cassert>
+#include <cstring>
 
 #include "config.h"
 #include "kdb_ke.h"
 #include "kip.h"
+#include "mem.h"
 #include "mem_layout.h"
 #include "mem_region.h"
 #include "buddy_alloc.h"
 #include "panic.h"
+#include "per_cpu_data.h"
+#include "zero_page_pool.h"
 
 static Kmem_alloc::Alloc _a;
 Kmem_alloc::Alloc *Kmem_alloc::a = &_a;
@@ -143,29 +161,108 @@ Kmem_alloc::free(size_t o, void *p)
   unaligned_free(1UL << o, p);
 }
 
-PUBLIC 
+/**
+ * Allocate a block without asking the memory reapers for more memory
+ * if none is free.
+ */
+PUBLIC
 void *
-Kmem_alloc::unaligned_alloc(unsigned long size)
+Kmem_alloc::try_unaligned_alloc(unsigned long size)
 {
   assert(size >=8 /*NEW INTERFACE PARANIOIA*/);
-  void* ret;
+  auto guard = lock_guard(lock);
+  return a->alloc(size);
+}
 
-  {
-    auto guard = lock_guard(lock);
-    ret = a->alloc(size);
-  }
+PUBLIC 
+void *
+Kmem_alloc::unaligned_alloc(unsigned long size)
+{
+  void* ret = try_unaligned_alloc(size);
 
   if (!ret)
     {
       Kmem_alloc_reaper::morecore (/* desperate= */ true);
-
-      auto guard = lock_guard(lock);
-      ret = a->alloc(size);
+      ret = try_unaligned_alloc(size);
     }
 
   return ret;
 }
 
+/**
+ * Allocate a cleared block.  Single pages come from the pre-zeroed page
+ * pool of the current CPU, which the idle loop refills, so they are not
+ * cleared on the caller's path.  Must not be used before the CPU-local
+ * data of the current CPU is set up.
+ */
+PUBLIC
+void *
+Kmem_alloc::unaligned_alloc_zeroed(unsigned long size)
+{
+  if (size == Config::PAGE_SIZE)
+    if (void *p = Zero_page_pool::pop())
+      return p;
+
+  void *b = unaligned_alloc(size);
+  if (b)
+    memset(b, 0, size);
+  return b;
+}
+
+/**
+ * Refill the pre-zeroed page pool of `cpu`.  Called from the idle loop of
+ * `cpu` with interrupts enabled, so that clearing pages never delays
+ * other work.  Stops when the allocator has no free page left without
+ * reaping.
+ */
+PUBLIC
+void
+Kmem_alloc::refill_zeroed(Cpu_number cpu)
+{
+  while (Zero_page_pool::low(cpu))
+    {
+      void *p = try_unaligned_alloc(Config::PAGE_SIZE);
+      if (!p)
+        return;
+
+      Mem::memset_mwords(p, 0, Config::PAGE_SIZE / sizeof(Mword));
+      Zero_page_pool::push(cpu, p);
+    }
+}
+
+/** Give the pages of all pre-zeroed page pools back to the allocator. */
+static
+size_t
+reap_zeroed_pages(bool desperate)
+{
+  if (!desperate)
+    return 0;
+
+  size_t freed = 0;
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    {
+      if (!Per_cpu_data::valid(i))
+        continue;
+
+      while (void *p = Zero_page_pool::reap(i))
+        {
+          Kmem_alloc::allocator()->unaligned_free(Config::PAGE_SIZE, p);
+          freed += Config::PAGE_SIZE;
+        }
+    }
+
+  return freed;
+}
+
+static Kmem_alloc_reaper zeroed_pages_reaper(reap_zeroed_pages);
+
+PUBLIC inline NEEDS [Kmem_alloc::unaligned_alloc_zeroed]
+void *
+Kmem_alloc::alloc_zeroed(size_t o)
+{
+  return unaligned_alloc_zeroed(1UL << o);
+}
+
 PUBLIC
 void
 Kmem_alloc::unaligned_free(unsigned long size, void *page)
@@ -265,6 +362,40 @@ Kmem_alloc::q_unaligned_alloc(Q *quota, size_t size)
 }
 
 
+PUBLIC template< typename Q >
+inline
+void *
+Kmem_alloc::q_alloc_zeroed(Q *quota, size_t order)
+{
+  Auto_quota<Q> q(quota, 1UL<<order);
+  if (EXPECT_FALSE(!q))
+    return 0;
+
+  void *b = alloc_zeroed(order);
+  if (EXPECT_FALSE(!b))
+    return 0;
+
+  q.release();
+  return b;
+}
+
+PUBLIC template< typename Q >
+inline
+void *
+Kmem_alloc::q_unaligned_alloc_zeroed(Q *quota, size_t size)
+{
+  Auto_quota<Q> q(quota, size);
+  if (EXPECT_FALSE(!q))
+    return 0;
+
+  void *b;
+  if (EXPECT_FALSE(!(b=unaligned_alloc_zeroed(size))))
+    return 0;
+
+  q.release();
+  return b;
+}
+
 PUBLIC inline NEEDS["mem_layout.h"]
 void Kmem_alloc::free_phys(size_t s, Address p)
 {
@@ -4,6 +4,7 @@ INTERFACE:
 #include "buddy_alloc.h"
 #include "config.h"
 #include "lock_guard.h"
+#include "per_cpu_data.h"
 #include "spin_lock.h"
 
 #include "slab_cache.h"		// Slab_cache
@@ -12,8 +13,64 @@ INTERFACE:
 class Kmem_slab : public Slab_cache, public cxx::S_list_item
 {
   friend class Jdb_kern_info_memory;
+  friend class Kmem_slab_magazines;
   typedef cxx::S_list_bss<Kmem_slab> Reap_list;
 
+public:
+  /// Per-CPU magazine statistics, shown by JDB.
+  struct Cpu_stats
+  {
+    Mword hits;        ///< alloc/free served by the CPU's magazines
+    Mword depot;       ///< magazine exchanges with the depot
+    Mword slab_allocs; ///< allocations that fell through to the slab layer
+    Mword slab_frees;  ///< frees that fell through to the slab layer
+  };
+
+private:
+  enum { Mag_size = 14 };
+
+  /**
+   * A magazine: a small stack of free objects owned by one CPU or
+   * parked in the depot.
+   */
+  struct Magazine : cxx::S_list_item
+  {
+    Mword n;
+    void *obj[Mag_size];
+  };
+
+  typedef cxx::S_list<Magazine> Mag_list;
+
+  /**
+   * The magazine layer of one CPU.  'loaded' and 'prev' are each either
+   * null, full or empty, except that 'loaded' may be partially filled.
+   * There is no initialization: per-CPU memory starts out zeroed, which
+   * is an unlocked lock and no magazines.
+   */
+  struct Cpu_cache
+  {
+    Spin_lock<> lock;
+    Magazine *loaded;
+    Magazine *prev;
+    Cpu_stats stats;
+
+    void swap() { Magazine *t = loaded; loaded = prev; prev = t; }
+  } __attribute__((aligned(64)));
+
+  /// Slab caches beyond this number have no magazine layer.
+  enum { Max_cpu_caches = 32 };
+  typedef Cpu_cache Cpu_caches[Max_cpu_caches];
+
+  unsigned _cpu_idx; ///< our slot in _cpu_caches, or Max_cpu_caches
+
+  static Per_cpu<Cpu_caches> _cpu_caches;
+  static Mword _num_cpu_caches;
+
+  Spin_lock<> _depot_lock;
+  Mag_list _full;
+  Mag_list _empty;
+  unsigned _num_full, _num_mags;
+
   // STATIC DATA
   static Reap_list reap_list;
 };
@@ -29,6 +86,8 @@ public:
 IMPLEMENTATION:
 
 Kmem_slab::Reap_list Kmem_slab::reap_list;
+DEFINE_PER_CPU Per_cpu<Kmem_slab::Cpu_caches> Kmem_slab::_cpu_caches;
+Mword Kmem_slab::_num_cpu_caches;
 
 // Kmem_slab -- A type-independent slab cache allocator for Fiasco,
 // derived from a generic slab cache allocator (Slab_cache in
@@ -39,10 +98,15 @@ Kmem_slab::Reap_list Kmem_slab::reap_list;
 //-
 
 #include <cassert>
+#include <cstdio>
 #include "config.h"
 #include "atomic.h"
+#include "context_base.h"
 #include "panic.h"
 #include "kmem_alloc.h"
+#include "logdefs.h"
+#include "static_init.h"
+#include "std_macros.h"
 
 // Specializations providing their own block_alloc()/block_free() can
 // also request slab sizes larger than one page.
@@ -53,6 +117,7 @@ Kmem_slab::Kmem_slab(unsigned long slab_size,
 				   char const *name)
   : Slab_cache(slab_size, elem_size, alignment, name)
 {
+  init_magazines();
   reap_list.add(this, mp_cas<cxx::S_list_item*>);
 }
 
@@ -66,15 +131,280 @@ Kmem_slab::Kmem_slab(unsigned elem_size,
                      unsigned long max_size = Buddy_alloc::Max_size)
   : Slab_cache(elem_size, alignment, name, min_size, max_size)
 {
+  init_magazines();
   reap_list.add(this, mp_cas<cxx::S_list_item*>);
 }
 
 PUBLIC
 Kmem_slab::~Kmem_slab()
 {
+  reap(true);
   destroy();
 }
 
+PRIVATE
+void
+Kmem_slab::init_magazines()
+{
+  Mword idx;
+  do
+    idx = access_once(&_num_cpu_caches);
+  while (idx < Max_cpu_caches && !mp_cas(&_num_cpu_caches, idx, idx + 1));
+
+  _cpu_idx = idx;
+
+  _depot_lock.init();
+  _num_full = _num_mags = 0;
+}
+
+// Magazines come from a slab of their own, which of course must not
+// run through the magazine layer itself.
+class Kmem_slab_magazines : public Kmem_slab
+{
+public:
+  Kmem_slab_magazines()
+  : Kmem_slab(sizeof(Magazine), sizeof(Mword), "Kmem_slab::Magazine") {}
+
+  void *alloc() { return Slab_cache::alloc(); }
+  void free(void *e) { Slab_cache::free(e); }
+};
+
+static Kmem_slab_magazines _magazine_alloc INIT_PRIORITY(EARLY_INIT_PRIO);
+
+/**
+ * The magazine layer of the current CPU, or null if this cache has none
+ * or the per-CPU data of the CPU is not yet set up (early boot).
+ */
+PRIVATE inline NEEDS["context_base.h"]
+Kmem_slab::Cpu_cache *
+Kmem_slab::cpu_cache()
+{
+  Cpu_number cpu = current_cpu();
+  if (EXPECT_FALSE(_cpu_idx >= Max_cpu_caches || !Per_cpu_data::valid(cpu)))
+    return 0;
+
+  return &_cpu_caches.cpu(cpu)[_cpu_idx];
+}
+
+/**
+ * Take a magazine from the depot list `from` and, if successful, park
+ * `give` (if any) on the list `to`.
+ */
+PRIVATE
+Kmem_slab::Magazine *
+Kmem_slab::depot_exchange(Mag_list *from, Mag_list *to, Magazine *give)
+{
+  auto guard = lock_guard(_depot_lock);
+
+  Magazine *m = from->pop_front();
+  if (!m)
+    return 0;
+
+  if (give)
+    to->push_front(give);
+
+  if (from == &_full)
+    --_num_full;
+  else if (give)
+    ++_num_full;
+
+  return m;
+}
+
+/**
+ * Allocate an object.  The CPU-local magazines are tried first, then a
+ * full magazine from the depot, and only then the slab layer.
+ */
+PUBLIC
+void *
+Kmem_slab::alloc()
+{
+  CNT_SLAB_ALLOC;
+
+  Cpu_cache *c = cpu_cache();
+  if (EXPECT_FALSE(!c))
+    return Slab_cache::alloc();
+
+    {
+      auto guard = lock_guard(c->lock);
+
+      Magazine *m = c->loaded;
+      if (EXPECT_TRUE(m && m->n))
+        ++c->stats.hits;
+      else if (c->prev && c->prev->n)
+        {
+          c->swap();
+          m = c->loaded;
+          ++c->stats.hits;
+        }
+      else if ((m = depot_exchange(&_full, &_empty, c->prev)))
+        {
+          c->prev = c->loaded;
+          c->loaded = m;
+          ++c->stats.depot;
+        }
+      else
+        ++c->stats.slab_allocs;
+
+      if (m)
+        return m->obj[--m->n];
+    }
+
+  return Slab_cache::alloc();
+}
+
+/**
+ * Free an object into the CPU-local magazines.  If both are full, a
+ * full one is exchanged for an empty one at the depot; new magazines
+ * are allocated as needed and the slab layer is only used if that fails.
+ */
+PUBLIC
+void
+Kmem_slab::free(void *e)
+{
+  Cpu_cache *c = cpu_cache();
+  if (EXPECT_FALSE(!c))
+    {
+      Slab_cache::free(e);
+      return;
+    }
+
+  for (;;)
+    {
+        {
+          auto guard = lock_guard(c->lock);
+
+          Magazine *m = c->loaded;
+          if (EXPECT_TRUE(m && m->n < Mag_size))
+            ++c->stats.hits;
+          else if (c->prev && c->prev->n < Mag_size)
+            {
+              c->swap();
+              m = c->loaded;
+              ++c->stats.hits;
+            }
+          else if ((m = depot_exchange(&_empty, &_full, c->prev)))
+            {
+              c->prev = c->loaded;
+              c->loaded = m;
+              ++c->stats.depot;
+            }
+
+          if (m)
+            {
+              m->obj[m->n++] = e;
+              return;
+            }
+        }
+
+      // Allocate a fresh magazine without holding any of our locks,
+      // the allocation may end up in reap_all().
+      Magazine *m = (Magazine *)_magazine_alloc.alloc();
+      if (EXPECT_FALSE(!m))
+        break;
+
+      m->n = 0;
+      auto guard = lock_guard(_depot_lock);
+      _empty.push_front(m);
+      ++_num_mags;
+    }
+
+  ++c->stats.slab_frees;
+  Slab_cache::free(e);
+}
+
+PUBLIC template< typename Q >
+inline
+void *
+Kmem_slab::q_alloc(Q *quota)
+{
+  Auto_quota<Ram_quota> q(quota, Slab_cache::entry_size());
+  if (EXPECT_FALSE(!q))
+    return 0;
+
+  void *r;
+  if (EXPECT_FALSE(!(r = alloc())))
+    return 0;
+
+  q.release();
+  return r;
+}
+
+PUBLIC template< typename Q >
+inline
+void
+Kmem_slab::q_free(Q *quota, void *obj)
+{
+  free(obj);
+  quota->free(Slab_cache::entry_size());
+}
+
+PRIVATE
+void
+Kmem_slab::drain_magazine(Magazine *m)
+{
+  for (Mword i = 0; i < m->n; ++i)
+    Slab_cache::free(m->obj[i]);
+
+  _magazine_alloc.free(m);
+}
+
+/**
+ * Return cached objects to the slab layer and empty slabs to the
+ * system.  The depot is always flushed; the CPU-local magazines only if
+ * `desperate` is set, as this takes the lock of every CPU.
+ */
+PUBLIC
+unsigned long
+Kmem_slab::reap(bool desperate = false)
+{
+  Mag_list drain;
+  unsigned drained = 0;
+
+  if (desperate && _cpu_idx < Max_cpu_caches)
+    for (Cpu_number cpu = Cpu_number::first(); cpu < Config::max_num_cpus();
+         ++cpu)
+      {
+        if (!Per_cpu_data::valid(cpu))
+          continue;
+
+        Cpu_cache *c = &_cpu_caches.cpu(cpu)[_cpu_idx];
+        auto guard = lock_guard(c->lock);
+        if (c->loaded)
+          {
+            drain.push_front(c->loaded);
+            ++drained;
+          }
+        if (c->prev)
+          {
+            drain.push_front(c->prev);
+            ++drained;
+          }
+        c->loaded = c->prev = 0;
+      }
+
+    {
+      auto guard = lock_guard(_depot_lock);
+      while (Magazine *m = _full.pop_front())
+        {
+          drain.push_front(m);
+          ++drained;
+        }
+      while (Magazine *m = _empty.pop_front())
+        {
+          drain.push_front(m);
+          ++drained;
+        }
+      _num_mags -= drained;
+      _num_full = 0;
+    }
+
+  while (Magazine *m = drain.pop_front())
+    drain_magazine(m);
+
+  return Slab_cache::reap();
+}
+
 
 // Callback functions called by our super class, Slab_cache, to
 // allocate or free blocks
@@ -110,7 +440,7 @@ Kmem_slab::reap_all (bool desperate)
       size_t got;
       do
 	{
-	  got = alloc->reap();
+	  got = alloc->reap(desperate);
 	  freed += got;
 	}
       while (desperate && got);
@@ -120,3 +450,29 @@ Kmem_slab::reap_all (bool desperate)
 }
 
 static Kmem_alloc_reaper kmem_slab_reaper(Kmem_slab::reap_all);
+
+// Debugging output
+
+PUBLIC
+void
+Kmem_slab::debug_dump_magazines()
+{
+  printf("  magazines: %u allocated, %u full in depot\n", _num_mags, _num_full);
+  if (_cpu_idx >= Max_cpu_caches)
+    return;
+
+  for (Cpu_number cpu = Cpu_number::first(); cpu < Config::max_num_cpus();
+       ++cpu)
+    {
+      if (!Per_cpu_data::valid(cpu))
+        continue;
+
+      Cpu_stats const &s = _cpu_caches.cpu(cpu)[_cpu_idx].stats;
+      if (!(s.hits | s.depot | s.slab_allocs | s.slab_frees))
+        continue;
+
+      printf("  CPU%u: hits=%lu depot=%lu slab allocs=%lu slab frees=%lu\n",
+             cxx::int_value<Cpu_number>(cpu), s.hits, s.depot,
+             s.slab_allocs, s.slab_frees);
+    }
+}
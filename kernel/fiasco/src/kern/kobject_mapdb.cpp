@@ -118,6 +118,17 @@ Kobject_mapdb::insert(const Frame&, Mapping*, Space *,
   return m;
 }
 
+/**
+ * Like insert(); an object has only one lock, so there is nothing to
+ * hand over.
+ */
+PUBLIC inline static
+Kobject_mapdb::Mapping *
+Kobject_mapdb::insert_child(Frame *f, Mapping *parent, Space *space,
+                            Vaddr va, Obj_space::Phys_addr o,
+                            Obj_space::V_pfc size)
+{ return insert(*f, parent, space, va, o, size); }
+
 PUBLIC inline static
 bool
 Kobject_mapdb::grant(const Frame &f, Mapping *sm, Space *,
@@ -120,20 +120,35 @@
 
 #if defined(CONFIG_JDB) && defined(CONFIG_JDB_ACCOUNTING)
 
-#define CNT_CONTEXT_SWITCH      Jdb_tbuf::status()->kerncnts[Kern_cnt_context_switch]++;
-#define CNT_ADDR_SPACE_SWITCH   Jdb_tbuf::status()->kerncnts[Kern_cnt_addr_space_switch]++;
-#define CNT_IRQ                 Jdb_tbuf::status()->kerncnts[Kern_cnt_irq]++;
-#define CNT_PAGE_FAULT          Jdb_tbuf::status()->kerncnts[Kern_cnt_page_fault]++;
-#define CNT_IO_FAULT            Jdb_tbuf::status()->kerncnts[Kern_cnt_io_fault]++;
-#define CNT_SCHEDULE            Jdb_tbuf::status()->kerncnts[Kern_cnt_schedule]++;
-#define CNT_EXC_IPC             Jdb_tbuf::status()->kerncnts[Kern_cnt_exc_ipc]++;
+#include "kern_cnt.h"
+
+#define CNT_CONTEXT_SWITCH      Kern_cnt::inc(Kern_cnt_context_switch);
+#define CNT_ADDR_SPACE_SWITCH   Kern_cnt::inc(Kern_cnt_addr_space_switch);
+#define CNT_IRQ                 Kern_cnt::inc(Kern_cnt_irq);
+#define CNT_PAGE_FAULT          Kern_cnt::inc(Kern_cnt_page_fault);
+#define CNT_IO_FAULT            Kern_cnt::inc(Kern_cnt_io_fault);
+#define CNT_SCHEDULE            Kern_cnt::inc(Kern_cnt_schedule);
+#define CNT_EXC_IPC             Kern_cnt::inc(Kern_cnt_exc_ipc);
+#define CNT_XCPU_TLB_FLUSH      Kern_cnt::inc(Kern_cnt_xcpu_tlb_flush);
+#define CNT_TLB_FLUSH_RANGE     Kern_cnt::inc(Kern_cnt_tlb_flush_range);
+#define CNT_SHORTCUT_FAILED     Kern_cnt::inc(Kern_cnt_shortcut_failed);
+#define CNT_SHORTCUT_SUCCESS    Kern_cnt::inc(Kern_cnt_shortcut_success);
+#define CNT_DRQ                 Kern_cnt::inc(Kern_cnt_drq);
+#define CNT_RCU_BATCH           Kern_cnt::inc(Kern_cnt_rcu_batch);
+#define CNT_SLAB_ALLOC          Kern_cnt::inc(Kern_cnt_slab_alloc);
+#define CNT_TIMEOUT             Kern_cnt::inc(Kern_cnt_timeout);
+#define CNT_PF_AROUND(pages)    do { Mword _p = (pages);                    \
+                                     if (_p)                                \
+                                       {                                    \
+                                         Kern_cnt::inc(Kern_cnt_pf_around); \
+                                         Kern_cnt::add(Kern_cnt_pf_around_pages, _p); \
+                                       }                                    \
+                                   } while (0)
 
 // FIXME: currently unused entries below
-#define CNT_SHORTCUT_FAILED     Jdb_tbuf::status()->kerncnts[Kern_cnt_shortcut_failed]++;
-#define CNT_SHORTCUT_SUCCESS    Jdb_tbuf::status()->kerncnts[Kern_cnt_shortcut_success]++;
-#define CNT_IPC_LONG            Jdb_tbuf::status()->kerncnts[Kern_cnt_ipc_long]++;
-#define CNT_TASK_CREATE         Jdb_tbuf::status()->kerncnts[Kern_cnt_task_create]++;
-#define CNT_IOBMAP_TLB_FLUSH    Jdb_tbuf::status()->kerncnts[Kern_cnt_iobmap_tlb_flush]++;
+#define CNT_IPC_LONG            Kern_cnt::inc(Kern_cnt_ipc_long);
+#define CNT_TASK_CREATE         Kern_cnt::inc(Kern_cnt_task_create);
+#define CNT_IOBMAP_TLB_FLUSH    Kern_cnt::inc(Kern_cnt_iobmap_tlb_flush);
 
 #else
 
@@ -144,10 +159,17 @@
 #define CNT_IO_FAULT		do { } while (0)
 #define CNT_SCHEDULE		do { } while (0)
 #define CNT_EXC_IPC             do { } while (0)
-
-// FIXME: currently unused entries below
+#define CNT_XCPU_TLB_FLUSH      do { } while (0)
+#define CNT_TLB_FLUSH_RANGE     do { } while (0)
 #define CNT_SHORTCUT_FAILED	do { } while (0)
 #define CNT_SHORTCUT_SUCCESS	do { } while (0)
+#define CNT_DRQ                 do { } while (0)
+#define CNT_RCU_BATCH           do { } while (0)
+#define CNT_SLAB_ALLOC          do { } while (0)
+#define CNT_TIMEOUT             do { } while (0)
+#define CNT_PF_AROUND(pages)    do { } while (0)
+
+// FIXME: currently unused entries below
 #define CNT_IPC_LONG		do { } while (0)
 #define CNT_TASK_CREATE		do { } while (0)
 #define CNT_IOBMAP_TLB_FLUSH	do { } while (0)
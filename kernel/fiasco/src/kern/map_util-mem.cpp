@@ -24,11 +24,13 @@ Static_object<Mapdb> mapdb_mem;
     @param fp_to_{page, size} flexpage descripton for virtual-address
 	space range in destination address space
     @param offs sender-specified offset into destination flexpage
+    @param batch if not 0, TLB flushes are deferred to it
     @return IPC error code that describes the status of the operation
  */
 L4_error __attribute__((nonnull(1, 3)))
 mem_map(Space *from, L4_fpage const &fp_from,
-        Space *to, L4_fpage const &fp_to, L4_msg_item control)
+        Space *to, L4_fpage const &fp_to, L4_msg_item control,
+        Tlb_flush_batch *batch = 0)
 {
   assert_opt (from);
   assert_opt (to);
@@ -60,7 +62,7 @@ mem_map(Space *from, L4_fpage const &fp_from,
                         from, from, snd_addr,
                         Pfc(1) << so, to, to,
                         rcv_addr, control.is_grant(), attribs,
-                        (Mem_space::Reap_list**)0);
+                        (Mem_space::Reap_list**)0, batch);
 }
 
 /** Unmap the mappings in the region described by "fp" from the address
@@ -73,10 +75,12 @@ mem_map(Space *from, L4_fpage const &fp_from,
                  additionally flush the region in the given address space.
     @param restriction Only flush specific task ID.
     @param flush_mode determines which access privileges to remove.
+    @param batch if not 0, TLB flushes are deferred to it
     @return combined (bit-ORed) access status of unmapped physical pages
 */
 L4_fpage::Rights __attribute__((nonnull(1)))
-mem_fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask)
+mem_fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask,
+                Tlb_flush_batch *batch = 0)
 {
   if (fp.order() < L4_fpage::Mem_addr::Shift)
     return L4_fpage::Rights(0);
@@ -89,7 +93,7 @@ mem_fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask)
 
   return unmap<Mem_space>(mapdb_mem.get(), space, space,
                start, size,
-               fp.rights(), mask, (Mem_space::Reap_list**)0);
+               fp.rights(), mask, (Mem_space::Reap_list**)0, batch);
 }
 
 
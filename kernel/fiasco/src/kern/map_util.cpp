@@ -88,6 +88,7 @@ public:
   static bool match(L4_fpage const &from, L4_fpage const &to);
   static bool free_object(typename SPACE::Phys_addr o,
                           typename SPACE::Reap_list **reap_list);
+  static bool insert_child_first();
 };
 
 
@@ -102,6 +103,102 @@ public:
   Kobject ***list() { return &_t; }
 };
 
+/**
+ * Deferred TLB flushes of a sequence of memory map and unmap operations.
+ *
+ * Operations given a batch record the address ranges that need a flush
+ * instead of flushing themselves; flush() then does a single local and a
+ * single cross-CPU flush for the whole sequence.  Remote CPUs are only
+ * bothered if they may hold entries of one of the recorded spaces.
+ */
+class Tlb_flush_batch
+{
+private:
+  enum { Max_ranges = 4 };
+
+  Mem_space::Tlb_range _r[Max_ranges];
+  unsigned _n;
+  bool _all;   ///< more spaces than fit into _r, flush all spaces
+
+public:
+  Tlb_flush_batch() : _n(0), _all(false) {}
+
+  unsigned ranges() const { return _n; }
+  Mem_space::Tlb_range const &range(unsigned i) const { return _r[i]; }
+  bool all() const { return _all; }
+};
+
+namespace Mu {
+
+/**
+ * Hand over the TLB flush of a page range to a batch.
+ * Only memory spaces are batched.
+ * @return true if the flush was deferred, false if the caller must flush.
+ */
+template<typename SPACE>
+inline
+bool
+defer_tlb_flush(Tlb_flush_batch *, SPACE *, typename SPACE::V_pfn,
+                typename SPACE::V_pfc)
+{ return false; }
+
+inline
+bool
+defer_tlb_flush(Tlb_flush_batch *batch, Mem_space *s, Mem_space::V_pfn start,
+                Mem_space::V_pfc size)
+{
+  if (!batch)
+    return false;
+
+  // start and size count pages, the recorded range is in bytes
+  batch->add(s, cxx::int_value<Virt_addr>(Virt_addr(start)),
+             cxx::int_value<Virt_addr>(Virt_addr(start + size)));
+  return true;
+}
+
+/**
+ * Hand over the TLB flush of the whole spaces s1 and s2 (may be 0) to a
+ * batch.
+ */
+template<typename SPACE>
+inline
+bool
+defer_tlb_flush(Tlb_flush_batch *, SPACE *, SPACE *)
+{ return false; }
+
+inline
+bool
+defer_tlb_flush(Tlb_flush_batch *batch, Mem_space *s1, Mem_space *s2)
+{
+  if (!batch)
+    return false;
+
+  batch->add(s1);
+  batch->add(s2);
+  return true;
+}
+
+/**
+ * Hand over the TLB flush of the child mapping m to a batch.
+ */
+template<typename SPACE, typename M>
+inline
+bool
+defer_child_tlb_flush(Tlb_flush_batch *, SPACE *, M &)
+{ return false; }
+
+template<typename M>
+inline
+bool
+defer_child_tlb_flush(Tlb_flush_batch *batch, Mem_space *, M &m)
+{
+  return defer_tlb_flush(batch, static_cast<Mem_space *>(m->space()),
+                         Mem_space::to_virt(m.page()),
+                         Mem_space::to_size(Mem_space::to_order(m.order())));
+}
+
+}
+
 //------------------------------------------------------------------------
 IMPLEMENTATION:
 
@@ -113,6 +210,94 @@ IMPLEMENTATION:
 #include "paging.h"
 #include "warn.h"
 
+PUBLIC inline
+Tlb_flush_batch::~Tlb_flush_batch()
+{
+  if (_n || _all)
+    flush();
+}
+
+/**
+ * Record a TLB flush of the addresses [start, end) of space s.
+ *
+ * Ranges of the same space are merged if they touch.  If all slots are
+ * taken the range is merged into the hull of a range of the same space,
+ * or, as last resort, all spaces are flushed.
+ */
+PUBLIC inline NEEDS[<minmax.h>]
+void
+Tlb_flush_batch::add(Mem_space *s, Address start, Address end)
+{
+  if (!s || _all)
+    return;
+
+  Mem_space::Tlb_range *same = 0;
+  for (unsigned i = 0; i < _n; ++i)
+    {
+      Mem_space::Tlb_range &r = _r[i];
+      if (r.space != s)
+        continue;
+
+      if (start <= r.end && r.start <= end)
+        {
+          r.start = min(r.start, start);
+          r.end = max(r.end, end);
+          return;
+        }
+
+      same = &r;
+    }
+
+  if (_n < Max_ranges)
+    {
+      _r[_n].space = s;
+      _r[_n].start = start;
+      _r[_n].end = end;
+      ++_n;
+    }
+  else if (same)
+    {
+      same->start = min(same->start, start);
+      same->end = max(same->end, end);
+    }
+  else
+    _all = true;
+}
+
+/**
+ * Record a TLB flush of the whole space s.
+ */
+PUBLIC inline NEEDS[Tlb_flush_batch::add]
+void
+Tlb_flush_batch::add(Mem_space *s)
+{ add(s, 0, ~0UL); }
+
+/**
+ * Do the recorded TLB flushes.
+ */
+PUBLIC
+void
+Tlb_flush_batch::flush()
+{
+  if (_all)
+    {
+      Mem_space::tlb_flush_spaces(true, 0, 0);
+      if (Mem_space::Need_xcpu_tlb_flush)
+        Context::xcpu_tlb_flush(true, 0, 0);
+    }
+  else if (_n)
+    {
+      for (unsigned i = 0; i < _n; ++i)
+        Mem_space::tlb_flush_range(_r[i]);
+
+      if (Mem_space::Need_xcpu_tlb_flush)
+        Context::xcpu_tlb_flush_ranges(_r, _n);
+    }
+
+  _n = 0;
+  _all = false;
+}
+
 
 IMPLEMENT template<typename SPACE>
 inline
@@ -128,6 +313,17 @@ Map_traits<SPACE>::free_object(typename SPACE::Phys_addr,
 { return false; }
 
 
+/**
+ * Enter a new mapping into the mapping database before its page-table
+ * entry, so that the database lock can be handed over to the tree of the
+ * new mapping (Mapdb::insert_child()) before the page table is touched.
+ */
+IMPLEMENT template<typename SPACE>
+inline
+bool
+Map_traits<SPACE>::insert_child_first()
+{ return false; }
+
 PUBLIC template< typename SPACE >
 static inline
 typename SPACE::Attr
@@ -159,6 +355,12 @@ Map_traits<Mem_space>::match(L4_fpage const &from, L4_fpage const &to)
 }
 
 
+IMPLEMENT template<>
+inline
+bool
+Map_traits<Mem_space>::insert_child_first()
+{ return true; }
+
 IMPLEMENT template<>
 inline
 bool
@@ -214,12 +416,13 @@ Map_traits<Obj_space>::apply_attribs(Obj_space::Attr attribs,
 // inline NEEDS ["config.h", io_map]
 L4_error
 fpage_map(Space *from, L4_fpage fp_from, Space *to,
-          L4_fpage fp_to, L4_msg_item control, Reap_list *r)
+          L4_fpage fp_to, L4_msg_item control, Reap_list *r,
+          Tlb_flush_batch *batch = 0)
 {
   Space::Caps caps = from->caps() & to->caps();
 
   if (Map_traits<Mem_space>::match(fp_from, fp_to) && (caps & Space::Caps::mem()))
-    return mem_map(from, fp_from, to, fp_to, control);
+    return mem_map(from, fp_from, to, fp_to, control, batch);
 
 #ifdef CONFIG_PF_PC
   if (Map_traits<Io_space>::match(fp_from, fp_to) && (caps & Space::Caps::io()))
@@ -241,12 +444,14 @@ fpage_map(Space *from, L4_fpage fp_from, Space *to,
     @param me_too If false, only flush recursive mappings.  If true,
                  additionally flush the region in the given address space.
     @param flush_mode determines which access privileges to remove.
+    @param batch if not 0, TLB flushes of memory pages are deferred to it
     @return combined (bit-ORed) access status of unmapped physical pages
 */
 // Don't inline -- it eats too much stack.
 // inline NEEDS ["config.h", io_fpage_unmap]
 L4_fpage::Rights
-fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask, Kobject ***rl)
+fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask, Kobject ***rl,
+            Tlb_flush_batch *batch = 0)
 {
   L4_fpage::Rights ret(0);
   Space::Caps caps = space->caps();
@@ -258,7 +463,7 @@ fpage_unmap(Space *space, L4_fpage fp, L4_map_mask mask, Kobject ***rl)
     ret |= obj_fpage_unmap(space, fp, mask, rl);
 
   if ((caps & Space::Caps::mem()) && (fp.is_mempage() || fp.is_all_spaces()))
-    ret |= mem_fpage_unmap(space, fp, mask);
+    ret |= mem_fpage_unmap(space, fp, mask, batch);
 
   return ret;
 }
@@ -306,7 +511,8 @@ map(MAPDB* mapdb,
     SPACE* to, Space *to_id,
     typename SPACE::V_pfn rcv_addr,
     bool grant, typename SPACE::Attr attribs,
-    typename SPACE::Reap_list **reap_list = 0)
+    typename SPACE::Reap_list **reap_list = 0,
+    Tlb_flush_batch *batch = 0)
 {
   using namespace Mu;
 
@@ -454,12 +660,15 @@ map(MAPDB* mapdb,
 
           if (! sender_mapping)	// Need flush
             unmap(mapdb, to, to_id, SPACE::page_address(rcv_addr, r_order), SPACE::to_size(r_order),
-                  L4_fpage::Rights::FULL(), L4_map_mask::full(), reap_list);
+                  L4_fpage::Rights::FULL(), L4_map_mask::full(), reap_list,
+                  batch);
         }
 
       // Loop increment is size of insertion
       size = i_size;
 
+      bool const doing_upgrade = sender_mapping;
+
       if (! sender_mapping && mapdb->valid_address(SPACE::to_pfn(s_phys))
           && EXPECT_FALSE(! mapdb->lookup(from_id,
                                           SPACE::to_pfn(SPACE::page_address(snd_addr, s_order)),
@@ -475,6 +684,27 @@ map(MAPDB* mapdb,
       // (r_phys), the sender_mapping, and whether a receiver mapping
       // already exists (doing_upgrade).
 
+      // Enter the new mapping first if possible.  For a subpage of a
+      // superpage mapping this keeps only the subframe locked while we
+      // update the page table, so that operations on other subpages of
+      // the same superpage are not serialized behind us.  Any unmap of
+      // the sender locks the subframe before it visits the new mapping.
+      Mapping *rcv_mapping = 0;
+      if (Mt::insert_child_first() && !grant && !doing_upgrade
+          && mapdb->valid_address(SPACE::to_pfn(s_phys)))
+        {
+          rcv_mapping = mapdb->insert_child(&mapdb_frame, sender_mapping,
+                                            to_id, SPACE::to_pfn(rcv_addr),
+                                            SPACE::to_pfn(i_phys),
+                                            SPACE::to_pcnt(i_order));
+          if (EXPECT_FALSE(!rcv_mapping))
+            {
+              mapdb->free(mapdb_frame);
+              condition = L4_error::Map_failed;
+              break;
+            }
+        }
+
       Attr i_attribs = Mt::apply_attribs(s_attribs, i_phys, attribs);
 
       // Do the actual insertion.
@@ -508,7 +738,7 @@ map(MAPDB* mapdb,
               from->v_delete(SPACE::page_address(snd_addr, s_order), s_order, L4_fpage::Rights::FULL());
               from_needs_tlb_flush = true;
             }
-          else if (status == SPACE::Insert_ok)
+          else if (status == SPACE::Insert_ok && !rcv_mapping)
             {
               if (mapdb->valid_address(SPACE::to_pfn(s_phys))
                   && !mapdb->insert(mapdb_frame, sender_mapping,
@@ -556,6 +786,12 @@ map(MAPDB* mapdb,
           break;
         }
 
+      // The page table did not take the mapping entered above.
+      if (EXPECT_FALSE(rcv_mapping && status != SPACE::Insert_ok))
+        mapdb->flush(mapdb_frame, rcv_mapping, L4_map_mask::full(),
+                     SPACE::to_pfn(rcv_addr),
+                     SPACE::to_pfn(rcv_addr + i_size));
+
       if (sender_mapping)
         mapdb->free(mapdb_frame);
 
@@ -567,15 +803,21 @@ map(MAPDB* mapdb,
     {
       SPACE *f = from_needs_tlb_flush ? from : 0;
       SPACE *t = to_needs_tlb_flush   ? to   : 0;
-      SPACE::tlb_flush_spaces(false, t, f);
-      if (SPACE::Need_xcpu_tlb_flush)
+      if (Mu::defer_tlb_flush(batch, t, f))
+        need_xcpu_tlb_flush = false;
+      else
         {
-          need_xcpu_tlb_flush = false;
-          Context::xcpu_tlb_flush(false, t, f);
+          SPACE::tlb_flush_spaces(false, t, f);
+          if (SPACE::Need_xcpu_tlb_flush)
+            {
+              need_xcpu_tlb_flush = false;
+              Context::xcpu_tlb_flush(false, t, f);
+            }
         }
     }
 
-  if (need_xcpu_tlb_flush)
+  if (need_xcpu_tlb_flush
+      && !Mu::defer_tlb_flush(batch, to, from))
     Context::xcpu_tlb_flush(false, to, from);
 
   // FIXME: make this debugging code optional
@@ -630,7 +872,8 @@ unmap(MAPDB* mapdb, SPACE* space, Space *space_id,
       typename SPACE::V_pfn start,
       typename SPACE::V_pfc size,
       L4_fpage::Rights rights,
-      L4_map_mask mask, typename SPACE::Reap_list **reap_list)
+      L4_map_mask mask, typename SPACE::Reap_list **reap_list,
+      Tlb_flush_batch *batch = 0)
 {
   using namespace Mu;
 
@@ -656,6 +899,10 @@ unmap(MAPDB* mapdb, SPACE* space, Space *space_id,
   bool need_tlb_flush = false;
   bool need_xcpu_tlb_flush = false;
 
+  // memory spaces record the flushed ranges, the others flush everything
+  Tlb_flush_batch own_batch;
+  Tlb_flush_batch *tlb = batch ? batch : &own_batch;
+
   // iterate over all pages in "space"'s page table that are mapped
   // into the specified region
   for (V_pfn address = start;
@@ -710,8 +957,11 @@ unmap(MAPDB* mapdb, SPACE* space, Space *space_id,
             space->v_delete(address, phys_order, rights);
 
           // assert_kdb (full_flush != space->v_lookup(address));
-          need_tlb_flush = true;
-          need_xcpu_tlb_flush = true;
+          if (!defer_tlb_flush(tlb, space, address, phys_size))
+            {
+              need_tlb_flush = true;
+              need_xcpu_tlb_flush = true;
+            }
         }
 
       // now delete from the other address spaces
@@ -720,7 +970,8 @@ unmap(MAPDB* mapdb, SPACE* space, Space *space_id,
            ++m)
         {
           page_rights |= v_delete<SPACE>(m, rights, full_flush);
-          need_xcpu_tlb_flush = true;
+          if (!defer_child_tlb_flush(tlb, space, m))
+            need_xcpu_tlb_flush = true;
         }
 
       flushed_rights |= page_rights;
@@ -1,6 +1,6 @@
 INTERFACE:
 
-#include "slab_cache.h"
+#include "kmem_slab.h"
 #include "l4_types.h"
 #include "types.h"
 #include "mapping.h"
@@ -145,24 +145,23 @@ IMPLEMENTATION:
  *                                     |             |
  *                                     ---------------
 
+ * Finding the tree header corresponding to a mapping: Each mapping
+ * carries a hint (tree_offs) with its array offset relative to the
+ * Sigma0 mapping, from whose address we can compute the address of
+ * the tree header.  The hint is updated whenever a mapping is moved
+ * within the array (allocate(), copy_compact_tree()).  If the hint
+ * value overflows, it is stored saturated and we just iterate using
+ * the hint value of the mapping we find with the first hint value.
+
  * IDEAS for enhancing this implementation: 
 
- * We often have to find a tree header corresponding to a mapping.
- * Currently, we do this by iterating backwards over the array
- * containing the mappings until we find the Sigma0 mapping, from
- * whose address we can compute the address of the tree header.  If
- * this becomes a problem, we could add one more byte to the mappings
- * with a hint (negative array offset) where to find the sigma0
- * mapping.  (If the hint value overflows, just iterate using the hint
- * value of the mapping we find with the first hint value.)  Another
- * idea (from Adam) would be to just look up the tree header by using
- * the physical address from the page-table lookup, but we would need
- * to change the interface of the mapping database for that (pass in
- * the physical address at all times), or we would have to include the
- * physical address (or just the address of the tree header) in the
- * Mapdb-user-visible Mapping (which could be different from the
- * internal tree representation).  (XXX: Implementing one of these
- * ideas is probably worthwile doing!)
+ * Another idea (from Adam) would be to just look up the tree header
+ * by using the physical address from the page-table lookup, but we
+ * would need to change the interface of the mapping database for
+ * that (pass in the physical address at all times), or we would have
+ * to include the physical address (or just the address of the tree
+ * header) in the Mapdb-user-visible Mapping (which could be different
+ * from the internal tree representation).
 
  * Instead of copying whole trees around when they grow or shrink a
  * lot, or copying parts of trees when inserting an element, we could
@@ -182,7 +181,6 @@ IMPLEMENTATION:
 #include "helping_lock.h"
 #include "kmem_alloc.h"
 #include "mapping_tree.h"
-#include "kmem_slab.h"
 #include "ram_quota.h"
 #include "std_macros.h"
 #include <new>
@@ -517,7 +515,7 @@ Treemap::~Treemap()
 static Kmem_slab_t<Treemap> _treemap_allocator("Treemap");
 
 static
-Slab_cache *
+Kmem_slab *
 Treemap::allocator()
 { return &_treemap_allocator; }
 
@@ -669,10 +667,21 @@ Treemap::lookup(Pcnt key, Space *search_space, Pfn search_va,
   return ret;
 }
 
+/**
+ * Insert a new mapping as child of `parent` into the locked tree `frame`.
+ *
+ * If `out_frame` is given, the tree that receives the new mapping is
+ * left locked and returned in `out_treemap` and `out_frame`.  For a
+ * mapping in a submap, that is the subframe, which is locked while
+ * `frame` is still held (trees are always locked from the superpage
+ * level downwards), so that the caller can release `frame` and continue
+ * with the subframe alone.  Otherwise all subframes are unlocked again.
+ */
 PUBLIC
 Mapping *
 Treemap::insert(Physframe* frame, Mapping* parent, Space *space,
-                Pfn va, Pcnt phys, Pcnt size)
+                Pfn va, Pcnt phys, Pcnt size,
+                Treemap **out_treemap = 0, Physframe **out_frame = 0)
 {
   Mapping_tree* t = frame->tree.get();
   Treemap* submap = 0;
@@ -703,6 +712,11 @@ Treemap::insert(Physframe* frame, Mapping* parent, Space *space,
 	  set_vaddr(free, va);
 
 	  t->check_integrity(_owner_id);
+	  if (out_frame)
+	    {
+	      *out_treemap = this;
+	      *out_frame = frame;
+	    }
 	  return free;
 	}
 
@@ -733,8 +747,10 @@ Treemap::insert(Physframe* frame, Mapping* parent, Space *space,
 
   // XXX recurse.
   Mapping* ret = submap->insert(subframe, subtree->mappings(), space, va,
-                                cxx::get_lsb(phys, psz), size);
-  submap->free(subframe);
+                                cxx::get_lsb(phys, psz), size,
+                                out_treemap, out_frame);
+  if (!ret || !out_frame || *out_frame != subframe)
+    submap->free(subframe);
 
   return ret;
 } // Treemap::insert()
@@ -978,6 +994,43 @@ Mapdb::insert(const Mapdb::Frame& frame, Mapping* parent, Space *space,
 } // insert()
 
 
+/**
+ * Insert a new mapping like insert(), but hand the lock of `frame` over
+ * to the mapping tree that receives the new mapping.
+ *
+ * A subpage mapping below a superpage mapping goes to a subframe of a
+ * submap.  Unlike insert(), which keeps the superpage tree locked until
+ * free(), this function releases the superpage tree as soon as the
+ * subframe is locked.  Operations on other subframes of the same
+ * superpage can then proceed while the caller updates the page table
+ * for the new mapping.
+ * @param frame  Locked mapping tree of `parent`.  On success, refers to
+ *               the locked tree of the new mapping; on failure, it is
+ *               unchanged and still locked.
+ * @return If successful, new mapping; otherwise 0.
+ */
+PUBLIC
+Mapping *
+Mapdb::insert_child(Mapdb::Frame *frame, Mapping* parent, Space *space,
+                    Pfn va, Pfn phys, Pcnt size)
+{
+  Treemap *treemap;
+  Physframe *f;
+  Mapping *m = frame->treemap->insert(frame->frame, parent, space, va,
+                                      phys - Pfn(0), size, &treemap, &f);
+  if (!m)
+    return 0;
+
+  if (f != frame->frame)
+    {
+      frame->treemap->free(frame->frame);
+      frame->treemap = treemap;
+      frame->frame = f;
+    }
+
+  return m;
+}
+
 /** 
  * Lookup a mapping and lock the corresponding mapping tree.  The returned
  * mapping pointer, and all other mapping pointers derived from it, remain
@@ -34,6 +34,9 @@ public:
 
   enum { Alignment = Mapping_entry::Alignment };
 
+  /// Largest array offset that fits into the tree-root hint.
+  enum { Tree_offs_max = (1UL << Mapping_entry::Tree_offs_bits) - 1 };
+
   // CREATORS
   Mapping(const Mapping&);	// this constructor is undefined.
 
@@ -120,6 +123,30 @@ Mapping::set_depth(unsigned depth)
   data()->_depth = depth;
 }
 
+/** Hint: array offset of this mapping relative to the root mapping
+    of its mapping tree.  Offsets larger than Tree_offs_max are stored
+    saturated; in that case the hint leads to another mapping of the
+    same tree whose hint has to be consulted again.
+ */
+PUBLIC inline NEEDS [Mapping::data]
+unsigned
+Mapping::tree_offs() const
+{
+  return data()->data.tree_offs;
+}
+
+/** Set the tree-root hint.
+    @param offs array offset of this mapping relative to the root
+           mapping of its tree.
+ */
+PUBLIC inline NEEDS [Mapping::data]
+void
+Mapping::set_tree_offs(unsigned long offs)
+{
+  data()->data.tree_offs = offs < (unsigned long)Tree_offs_max
+                         ? offs : (unsigned long)Tree_offs_max;
+}
+
 /** free entry?.
     @return true if this is unused.
  */
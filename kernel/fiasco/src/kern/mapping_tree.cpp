@@ -83,24 +83,23 @@ class Simple_tree_submap_ops
  *                                     |             |
  *                                     ---------------
 
+ * Finding the tree header corresponding to a mapping: Each mapping
+ * carries a hint (tree_offs) with its array offset relative to the
+ * Sigma0 mapping, from whose address we can compute the address of
+ * the tree header.  The hint is updated whenever a mapping is moved
+ * within the array (allocate(), copy_compact_tree()).  If the hint
+ * value overflows, it is stored saturated and we just iterate using
+ * the hint value of the mapping we find with the first hint value.
+
  * IDEAS for enhancing this implementation: 
 
- * We often have to find a tree header corresponding to a mapping.
- * Currently, we do this by iterating backwards over the array
- * containing the mappings until we find the Sigma0 mapping, from
- * whose address we can compute the address of the tree header.  If
- * this becomes a problem, we could add one more byte to the mappings
- * with a hint (negative array offset) where to find the sigma0
- * mapping.  (If the hint value overflows, just iterate using the hint
- * value of the mapping we find with the first hint value.)  Another
- * idea (from Adam) would be to just look up the tree header by using
- * the physical address from the page-table lookup, but we would need
- * to change the interface of the mapping database for that (pass in
- * the physical address at all times), or we would have to include the
- * physical address (or just the address of the tree header) in the
- * Mapdb-user-visible Mapping (which could be different from the
- * internal tree representation).  (XXX: Implementing one of these
- * ideas is probably worthwile doing!)
+ * Another idea (from Adam) would be to just look up the tree header
+ * by using the physical address from the page-table lookup, but we
+ * would need to change the interface of the mapping database for
+ * that (pass in the physical address at all times), or we would have
+ * to include the physical address (or just the address of the tree
+ * header) in the Mapdb-user-visible Mapping (which could be different
+ * from the internal tree representation).
 
  * Instead of copying whole trees around when they grow or shrink a
  * lot, or copying parts of trees when inserting an element, we could
@@ -347,6 +346,7 @@ Mapping_tree::Mapping_tree(Size_id size_id, Page page,
   _mappings[0].set_depth(Mapping::Depth_root);
   _mappings[0].set_page(page);
   _mappings[0].set_space(owner);
+  _mappings[0].set_tree_offs(0);
 
   _mappings[1].set_depth(Mapping::Depth_end);
 
@@ -414,6 +414,9 @@ Mapping_tree::last()
 // A utility function to find the tree header belonging to a mapping. 
 
 /** Our Mapping_tree.
+    Uses the tree-root hint stored in each mapping, so this takes
+    constant time unless the tree is larger than Mapping::Tree_offs_max
+    entries.
     @return the Mapping_tree we are in.
  */
 PUBLIC static
@@ -422,14 +425,8 @@ Mapping_tree::head_of(Mapping *m)
 {
   while (m->depth() > Mapping::Depth_root)
     {
-      // jump in bigger steps if this is not a free mapping
-      if (m->depth() <= Mapping::Depth_max)
-        {
-          m -= m->depth();
-          continue;
-        }
-
-      m--;
+      assert (m->tree_offs() > 0);
+      m -= m->tree_offs();
     }
 
   return reinterpret_cast<Mapping_tree *>
@@ -510,7 +507,9 @@ Mapping_tree::copy_compact_tree(Mapping_tree *dst, Mapping_tree *src)
        s && !s->is_end_tag();
        s = src->next(s))
     {
-      *d++ = *s;
+      *d = *s;
+      d->set_tree_offs(d - dst->mappings());
+      d++;
       dst->_count += 1;
     }
 
@@ -675,6 +674,7 @@ Mapping_tree::allocate(Ram_quota *payer, Mapping *parent,
       while (free + 1 != insert)
         {
           *free = *(free + 1);
+          free->set_tree_offs(free - mappings());
           free++;
         }
 
@@ -712,6 +712,7 @@ Mapping_tree::allocate(Ram_quota *payer, Mapping *parent,
       while (insert > free)
         {
           *insert = *(insert - 1);
+          insert->set_tree_offs(insert - mappings());
           --insert;
         }
     }
@@ -721,6 +722,7 @@ Mapping_tree::allocate(Ram_quota *payer, Mapping *parent,
   // found a place to insert new child (free).
   free->set_depth(insert_submap ? (unsigned)Mapping::Depth_submap 
                                 : parent->depth() + 1);
+  free->set_tree_offs(free - mappings());
 
   return free;
 }
@@ -42,6 +42,21 @@ public:
   typedef Page_count V_pfc;
   typedef Addr::Order<0> V_order;
 
+  /// Virtual-address range [start, end) of a space with possibly stale TLB
+  /// entries, in bytes.
+  struct Tlb_range
+  {
+    Mem_space *space;
+    Address start;
+    Address end;
+  };
+
+  enum
+  {
+    /// Ranges larger than this many pages are flushed as a whole.
+    Tlb_range_max_pages = 32,
+  };
+
   // Each architecture must provide these members:
   void switchin_context(Mem_space *from);
 
@@ -205,6 +220,10 @@ EXTENSION class Mem_space
 {
 public:
   enum { Need_xcpu_tlb_flush = true };
+
+private:
+  /// CPUs that may hold TLB entries of this space.
+  Cpu_mask _tlb_cpus;
 };
 
 
@@ -323,6 +342,46 @@ bool
 Mem_space::is_sigma0() const
 { return false; }
 
+//---------------------------------------------------------------------------
+IMPLEMENTATION [mp]:
+
+PUBLIC inline
+Cpu_mask const &
+Mem_space::tlb_cpus() const
+{ return _tlb_cpus; }
+
+/**
+ * Note that CPU cpu may cache translations of this space from now on.
+ */
+PROTECTED inline
+void
+Mem_space::tlb_mark_active(Cpu_number cpu)
+{
+  if (EXPECT_FALSE(!_tlb_cpus.get(cpu)))
+    _tlb_cpus.atomic_set(cpu);
+}
+
+/**
+ * Note that CPU cpu holds no translations of this space.
+ */
+PROTECTED inline
+void
+Mem_space::tlb_mark_inactive(Cpu_number cpu)
+{ _tlb_cpus.atomic_clear(cpu); }
+
+//---------------------------------------------------------------------------
+IMPLEMENTATION [!mp]:
+
+PROTECTED inline
+void
+Mem_space::tlb_mark_active(Cpu_number)
+{}
+
+PROTECTED inline
+void
+Mem_space::tlb_mark_inactive(Cpu_number)
+{}
+
 //---------------------------------------------------------------------------
 IMPLEMENTATION [!io]:
 
@@ -146,6 +146,11 @@ void __attribute__((__flatten__))
 Generic_obj_space<SPACE>::caps_free()
 { Base::caps_free(); }
 
+PUBLIC template< typename SPACE > inline
+bool
+Generic_obj_space<SPACE>::caps_prealloc(Cap_index first, Cap_index end)
+{ return Base::caps_prealloc(first, end); }
+
 PUBLIC template< typename SPACE >
 inline
 bool
@@ -99,19 +99,39 @@ Obj_space_phys<SPACE>::caps_alloc(Cap_index virt)
   if (EXPECT_FALSE(d_idx >= Slots_per_dir))
     return 0;
 
-  void *mem = Kmem_alloc::allocator()->q_unaligned_alloc(ram_quota(), Config::PAGE_SIZE);
+  void *mem = Kmem_alloc::allocator()->q_unaligned_alloc_zeroed(ram_quota(), Config::PAGE_SIZE);
 
   if (!mem)
     return 0;
 
   Obj::add_cap_page_dbg_info(mem, SPACE::get_space(this),  cxx::int_value<Cap_index>(virt));
 
-  Mem::memset_mwords(mem, 0, Config::PAGE_SIZE / sizeof(Mword));
-
   Cap_table *tab = _dir->d[d_idx] = (Cap_table*)mem;
   return &tab->e[ cxx::get_lsb(cxx::int_value<Cap_index>(virt), Obj::Caps_per_page_ld2)];
 }
 
+/**
+ * Back the capabilities [first, end) with cap tables in one go, so that
+ * later maps into this range need not allocate.
+ * @return false if out of memory
+ */
+PUBLIC template< typename SPACE >
+bool
+Obj_space_phys<SPACE>::caps_prealloc(Cap_index first, Cap_index end)
+{
+  if (EXPECT_FALSE(!_dir))
+    return false;
+
+  first = Cap_index(cxx::int_value<Cap_index>(first)
+                    & ~(Mword(Obj::Caps_per_page) - 1));
+
+  for (Cap_index i = first; i < end; i += Cap_diff(Obj::Caps_per_page))
+    if (!get_cap(i) && !caps_alloc(i))
+      return false;
+
+  return true;
+}
+
 PUBLIC template< typename SPACE >
 void
 Obj_space_phys<SPACE>::caps_free()
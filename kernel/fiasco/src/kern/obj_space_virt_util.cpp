@@ -39,7 +39,18 @@ private:
 
     Whole_space = 20,
     Map_max_address = 1UL << 20, /* 20bit obj index */
+
+    // number of cap pages, from index 0, whose kernel addresses are
+    // remembered in _cap_pages
+    Cap_page_cache = 16,
   };
+
+  /**
+   * Kernel addresses of the first cap pages.  get_cap() uses them instead
+   * of walking the page table of the cap area.  Cap pages are freed only
+   * in caps_free(), so an entry never becomes stale while the space lives.
+   */
+  Entry *_cap_pages[Cap_page_cache];
 };
 
 IMPLEMENTATION:
@@ -62,11 +73,28 @@ Obj_space_virt<SPACE>::cap_virt(Cap_index index)
 
 
 
+PUBLIC template< typename SPACE >
+Obj_space_virt<SPACE>::Obj_space_virt()
+{
+  for (unsigned i = 0; i < Cap_page_cache; ++i)
+    _cap_pages[i] = 0;
+}
+
 PRIVATE template< typename SPACE >
 inline NEEDS["mem_space.h", "mem_layout.h", Obj_space_virt::cap_virt]
 typename Obj_space_virt<SPACE>::Entry *
 Obj_space_virt<SPACE>::get_cap(Cap_index index)
 {
+  Mword const i = cxx::int_value<Cap_index>(index);
+  Mword const pg = i >> Obj::Caps_per_page_ld2;
+
+  if (EXPECT_TRUE(pg < Cap_page_cache))
+    {
+      Entry *p = access_once(&_cap_pages[pg]);
+      if (EXPECT_TRUE(p != 0))
+        return p + (i & (Obj::Caps_per_page - 1));
+    }
+
   Mem_space *ms = SPACE::mem_space(this);
 
   Address phys = Address(ms->virt_to_phys((Address)cap_virt(index)));
@@ -83,15 +111,13 @@ typename Obj_space_virt<SPACE>::Entry *
 Obj_space_virt<SPACE>::caps_alloc(Cap_index virt)
 {
   Address cv = (Address)cap_virt(virt);
-  void *mem = Kmem_alloc::allocator()->q_unaligned_alloc(SPACE::ram_quota(this), Config::PAGE_SIZE);
+  void *mem = Kmem_alloc::allocator()->q_unaligned_alloc_zeroed(SPACE::ram_quota(this), Config::PAGE_SIZE);
 
   if (!mem)
     return 0;
 
   Obj::add_cap_page_dbg_info(mem, SPACE::get_space(this), cxx::int_value<Cap_index>(virt));
 
-  Mem::memset_mwords(mem, 0, Config::PAGE_SIZE / sizeof(Mword));
-
   Mem_space::Status s;
   s = SPACE::mem_space(this)->v_insert(
       Mem_space::Phys_addr(Mem_space::kernel_space()->virt_to_phys((Address)mem)),
@@ -115,11 +141,38 @@ Obj_space_virt<SPACE>::caps_alloc(Cap_index virt)
       return 0;
     };
 
+  Mword pg = cxx::int_value<Cap_index>(virt) >> Obj::Caps_per_page_ld2;
+  if (pg < Cap_page_cache)
+    {
+      // the cleared page must be visible before its address
+      Mem::mp_wmb();
+      write_now(&_cap_pages[pg], reinterpret_cast<Entry*>(mem));
+    }
+
   unsigned long cap = cv & (Config::PAGE_SIZE - 1) | (unsigned long)mem;
 
   return reinterpret_cast<Entry*>(cap);
 }
 
+/**
+ * Back the capabilities [first, end) with cap pages in one go, so that
+ * later maps into this range need not allocate.
+ * @return false if out of memory
+ */
+PUBLIC template< typename SPACE >
+bool
+Obj_space_virt<SPACE>::caps_prealloc(Cap_index first, Cap_index end)
+{
+  first = Cap_index(cxx::int_value<Cap_index>(first)
+                    & ~(Mword(Obj::Caps_per_page) - 1));
+
+  for (Cap_index i = first; i < end; i += Cap_diff(Obj::Caps_per_page))
+    if (!get_cap(i) && !caps_alloc(i))
+      return false;
+
+  return true;
+}
+
 PROTECTED template< typename SPACE >
 void
 Obj_space_virt<SPACE>::caps_free()
@@ -143,6 +196,10 @@ Obj_space_virt<SPACE>::caps_free()
 
       a->q_unaligned_free(SPACE::ram_quota(this), Config::PAGE_SIZE, cv);
     }
+
+  for (unsigned i = 0; i < Cap_page_cache; ++i)
+    _cap_pages[i] = 0;
+
   ms->dir()->destroy(Virt_addr(Mem_layout::Caps_start),
                      Virt_addr(Mem_layout::Caps_end-1),
                      Pdir::Super_level,
@@ -1,5 +1,6 @@
 INTERFACE:
 
+#include <cstring>
 #include "types.h"
 #include "l4_msg_item.h"
 
@@ -76,6 +77,7 @@ class Pdir_alloc_null
 public:
   Pdir_alloc_null() {}
   void *alloc(unsigned long) const { return 0; }
+  void *alloc_zeroed(unsigned long) const { return 0; }
   void free(void *, unsigned long) const {}
   bool valid() const { return false; }
 };
@@ -89,6 +91,14 @@ public:
   void *alloc(unsigned long size) const
   { return _a->unaligned_alloc(size); }
 
+  void *alloc_zeroed(unsigned long size) const
+  {
+    void *b = _a->unaligned_alloc(size);
+    if (b)
+      memset(b, 0, size);
+    return b;
+  }
+
   void free(void *block, unsigned long size) const
   { return _a->unaligned_free(size, block); }
 
@@ -497,3 +497,8 @@ Mem_space::tlb_flush_spaces(bool all, Mem_space *s1, Mem_space *s2)
 {
   (void)all; (void)s1; (void)s2;
 }
+
+PUBLIC static inline
+void
+Mem_space::tlb_flush_range(Tlb_range const &)
+{}
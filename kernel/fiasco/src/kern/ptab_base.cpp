@@ -9,6 +9,7 @@ namespace Ptab
   struct Null_alloc
   {
     static void *alloc(unsigned long) { return 0; }
+    static void *alloc_zeroed(unsigned long) { return 0; }
     static void free(void *) {}
     static bool valid() { return false; }
     static unsigned to_phys(void *) { return 0; }
@@ -294,11 +295,14 @@ namespace Ptab
     template< typename _Alloc >
     Next *alloc_next(PTE_PTR e, _Alloc const &a, bool force_write_back)
     {
-      Next *n = (Next*)a.alloc(sizeof(Next));
+      Next *n = (Next*)a.alloc_zeroed(sizeof(Next));
       if (EXPECT_FALSE(!n))
         return 0;
 
-      n->clear(force_write_back);
+      // zeroed memory is a table of clear entries, it only needs to be
+      // written back
+      if (force_write_back)
+        n->clear(true);
       e.set_next_level(a.to_phys(n));
       e.write_back_if(force_write_back);
 
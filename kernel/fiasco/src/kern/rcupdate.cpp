@@ -101,9 +101,38 @@ public:
   Rcu_list _c;
   Rcu_list _d;
   Cpu_number _cpu;
+
+  long _max_len;        ///< highest callback backlog seen
+  Mword _invoked;       ///< callbacks invoked so far
 };
 
 
+// ------------------------------------------------------------------------
+INTERFACE [rcu_tree]:
+
+/**
+ * \brief Leaf of the RCU CPU tree.
+ *
+ * A node covers Rcu_glbl::Leaf_cpus CPUs, which report their quiescent
+ * states here under the node's lock.  Only the CPU that clears the last
+ * bit of a node reports to the root (Rcu_glbl::_lock).
+ */
+class Rcu_node
+{
+  friend class Rcu_glbl;
+  friend class Rcu;
+  friend class Jdb_rcupdate;
+
+private:
+  Spin_lock<> _lock;
+  Mword _qsmask;    ///< CPUs the grace period _batch still waits for
+  Mword _active;    ///< non-idle CPUs of this node
+  Rcu_batch _batch; ///< grace period _qsmask belongs to
+} __attribute__((aligned(64)));
+
+// ------------------------------------------------------------------------
+INTERFACE:
+
 /**
  * \brief Global RCU data structure.
  */
@@ -118,12 +147,48 @@ private:
   Rcu_batch _completed;    ///< last completed batch
   bool _next_pending;      ///< next batch already pending?
   Spin_lock<> _lock;
+
+  Unsigned64 _gp_start;    ///< start of the current grace period
+  Unsigned64 _gp_last;     ///< length of the last grace period
+  Unsigned64 _gp_max;      ///< longest grace period
+  Unsigned64 _gp_sum;      ///< sum of all grace-period lengths
+  Mword _gp_count;         ///< number of completed grace periods
+};
+
+// ------------------------------------------------------------------------
+INTERFACE [!rcu_tree]:
+
+EXTENSION class Rcu_glbl
+{
+private:
   Cpu_mask _cpus;
 
   Cpu_mask _active_cpus;
+};
 
+// ------------------------------------------------------------------------
+INTERFACE [rcu_tree]:
+
+EXTENSION class Rcu_glbl
+{
+public:
+  enum
+  {
+    Leaf_cpus = 16,
+    Num_leaves = (Config::Max_num_cpus + Leaf_cpus - 1) / Leaf_cpus,
+  };
+
+private:
+  static_assert(unsigned(Num_leaves) <= unsigned(MWORD_BITS),
+                "too many RCU leaf nodes");
+
+  Rcu_node _leaves[Num_leaves];
+  Mword _root_mask;        ///< leaves the grace period still waits for
 };
 
+// ------------------------------------------------------------------------
+INTERFACE:
+
 /**
  * \brief encapsulation of RCU implementation.
  *
@@ -196,6 +261,7 @@ IMPLEMENTATION:
 #include "mem.h"
 #include "static_init.h"
 #include "timeout.h"
+#include "timer.h"
 #include "logdefs.h"
 
 // XXX: includes for debugging
@@ -224,7 +290,9 @@ PUBLIC
 Rcu_glbl::Rcu_glbl()
 : _current(-300),
   _completed(-300)
-{}
+{
+  init_tree();
+}
 
 PUBLIC
 Rcu_data::Rcu_data(Cpu_number cpu)
@@ -247,7 +315,8 @@ void
 Rcu_data::enqueue(Rcu_item *i)
 {
   _n.enqueue(i);
-  ++_len;
+  if (++_len > _max_len)
+    _max_len = _len;
 }
 
 PRIVATE inline NOEXPORT NEEDS["cpu_lock.h", "lock_guard.h"]
@@ -256,6 +325,7 @@ Rcu_data::do_batch()
 {
   int count = 0;
   bool need_resched = false;
+  CNT_RCU_BATCH;
   for (Rcu_list::Const_iterator l = _d.begin(); l != _d.end();)
     {
       Rcu_item *i = *l;
@@ -275,6 +345,7 @@ Rcu_data::do_batch()
     {
       auto guard = lock_guard(cpu_lock);
       _len -= count;
+      _invoked += count;
     }
 #if 0
   if (_d.full())
@@ -286,7 +357,11 @@ Rcu_data::do_batch()
   return need_resched;
 }
 
-PRIVATE inline NOEXPORT
+/**
+ * Start the next grace period if one is pending.
+ * \pre must run under _lock
+ */
+PRIVATE
 void
 Rcu_glbl::start_batch()
 {
@@ -294,12 +369,52 @@ Rcu_glbl::start_batch()
     {
       _next_pending = 0;
       Mem::mp_wmb();
-      ++_current;
-      Mem::mp_mb();
-      _cpus = _active_cpus;
+      _gp_start = Timer::system_clock();
+      begin_batch();
     }
 }
 
+/**
+ * The current grace period has ended.
+ * \pre must run under _lock
+ */
+PRIVATE
+void
+Rcu_glbl::complete_batch()
+{
+  Unsigned64 d = Timer::system_clock() - _gp_start;
+  _gp_last = d;
+  if (d > _gp_max)
+    _gp_max = d;
+  _gp_sum += d;
+  ++_gp_count;
+
+  _completed = _current;
+  start_batch();
+}
+
+//--------------------------------------------------------------------------
+IMPLEMENTATION [!rcu_tree]:
+
+PRIVATE inline
+void
+Rcu_glbl::init_tree()
+{}
+
+PRIVATE
+void
+Rcu_glbl::begin_batch()
+{
+  ++_current;
+  Mem::mp_mb();
+  _cpus = _active_cpus;
+}
+
+PUBLIC inline
+bool
+Rcu_glbl::waits_for(Cpu_number cpu) const
+{ return _cpus.get(cpu); }
+
 PUBLIC
 void
 Rcu_data::enter_idle(Rcu_glbl *rgp)
@@ -321,14 +436,6 @@ Rcu_data::enter_idle(Rcu_glbl *rgp)
     }
 }
 
-PUBLIC static inline
-void
-Rcu::enter_idle(Cpu_number cpu)
-{
-  Rcu_data *rdp = &_rcu_data.cpu(cpu);
-  rdp->enter_idle(rcu());
-}
-
 PUBLIC static inline
 void
 Rcu::leave_idle(Cpu_number cpu)
@@ -350,12 +457,218 @@ Rcu_glbl::cpu_quiet(Cpu_number cpu)
 {
   _cpus.clear(cpu);
   if (_cpus.empty())
+    complete_batch();
+}
+
+/**
+ * Report a quiescent state of `cpu` for grace period `b`.
+ */
+PRIVATE inline NOEXPORT
+void
+Rcu_glbl::report_quiet(Cpu_number cpu, Rcu_batch b)
+{
+  auto guard = lock_guard(_lock);
+
+  if (EXPECT_TRUE(b == _current))
+    cpu_quiet(cpu);
+}
+
+/**
+ * `cpu` goes offline, stop waiting for it.
+ */
+PRIVATE inline NOEXPORT
+void
+Rcu_glbl::cpu_gone(Cpu_number cpu)
+{
+  auto guard = lock_guard(_lock);
+  if (_current != _completed)
+    cpu_quiet(cpu);
+}
+
+//--------------------------------------------------------------------------
+IMPLEMENTATION [rcu_tree]:
+
+PRIVATE
+void
+Rcu_glbl::init_tree()
+{
+  for (unsigned i = 0; i < Num_leaves; ++i)
+    {
+      _leaves[i]._lock.init();
+      _leaves[i]._qsmask = 0;
+      _leaves[i]._active = 0;
+      _leaves[i]._batch = _current;
+    }
+  _root_mask = 0;
+}
+
+PRIVATE inline
+Rcu_node *
+Rcu_glbl::leaf(Cpu_number cpu)
+{ return &_leaves[cxx::int_value<Cpu_number>(cpu) / Leaf_cpus]; }
+
+PRIVATE static inline
+Mword
+Rcu_glbl::leaf_bit(Cpu_number cpu)
+{ return 1UL << (cxx::int_value<Cpu_number>(cpu) % Leaf_cpus); }
+
+/**
+ * Set up the leaves for the next grace period and publish it.  The
+ * leaves are initialized before _current is incremented, so a CPU that
+ * sees the new batch number also finds its leaf prepared for it.
+ * \pre must run under _lock
+ */
+PRIVATE
+void
+Rcu_glbl::begin_batch()
+{
+  Rcu_batch next = _current + 1;
+  Mword root = 0;
+
+  for (unsigned i = 0; i < Num_leaves; ++i)
+    {
+      Rcu_node *l = &_leaves[i];
+      auto guard = lock_guard(l->_lock);
+      l->_qsmask = l->_active;
+      l->_batch = next;
+      if (l->_qsmask)
+        root |= 1UL << i;
+    }
+
+  _root_mask = root;
+  Mem::mp_wmb();
+  ++_current;
+  Mem::mp_mb();
+
+  // no active CPU at all, nobody to wait for
+  if (!root)
+    complete_batch();
+}
+
+/**
+ * The last CPU of leaf `l` has passed a quiescent state for grace
+ * period `b`, report the leaf to the root.
+ */
+PRIVATE
+void
+Rcu_glbl::leaf_quiet(Rcu_node *l, Rcu_batch b)
+{
+  auto guard = lock_guard(_lock);
+
+  if (EXPECT_FALSE(b != _current || _completed == _current))
+    return;
+
+  _root_mask &= ~(1UL << (l - _leaves));
+  if (!_root_mask)
+    complete_batch();
+}
+
+/**
+ * Report a quiescent state of `cpu` for grace period `b`.
+ */
+PRIVATE inline NOEXPORT
+void
+Rcu_glbl::report_quiet(Cpu_number cpu, Rcu_batch b)
+{
+  Rcu_node *l = leaf(cpu);
+  Mword bit = leaf_bit(cpu);
+
+    {
+      auto guard = lock_guard(l->_lock);
+      if (EXPECT_FALSE(l->_batch != b || !(l->_qsmask & bit)))
+        return;
+
+      l->_qsmask &= ~bit;
+      if (l->_qsmask)
+        return;
+    }
+
+  leaf_quiet(l, b);
+}
+
+/**
+ * Stop waiting for `cpu` in the current grace period, whether it
+ * passed a quiescent state or not.  With `idle` set the CPU is also
+ * removed from the set of active CPUs.
+ */
+PRIVATE
+void
+Rcu_glbl::force_quiet(Cpu_number cpu, bool idle)
+{
+  Rcu_node *l = leaf(cpu);
+  Mword bit = leaf_bit(cpu);
+  Rcu_batch b;
+
+    {
+      auto guard = lock_guard(l->_lock);
+      if (idle)
+        l->_active &= ~bit;
+
+      if (!(l->_qsmask & bit))
+        return;
+
+      l->_qsmask &= ~bit;
+      if (l->_qsmask)
+        return;
+
+      b = l->_batch;
+    }
+
+  leaf_quiet(l, b);
+}
+
+PRIVATE inline NOEXPORT
+void
+Rcu_glbl::cpu_gone(Cpu_number cpu)
+{ force_quiet(cpu, false); }
+
+PUBLIC inline NEEDS[Rcu_glbl::leaf_bit]
+bool
+Rcu_glbl::waits_for(Cpu_number cpu) const
+{ return _leaves[cxx::int_value<Cpu_number>(cpu) / Leaf_cpus]._qsmask
+         & leaf_bit(cpu); }
+
+PUBLIC
+void
+Rcu_data::enter_idle(Rcu_glbl *rgp)
+{
+  if (EXPECT_TRUE(!_idle))
     {
-      _completed = _current;
-      start_batch();
+      _idle = true;
+      _q_batch = rgp->_current;
+      _pending = 0;
+      rgp->force_quiet(_cpu, true);
     }
 }
 
+PUBLIC static inline NEEDS[Rcu_glbl::leaf, Rcu_glbl::leaf_bit]
+void
+Rcu::leave_idle(Cpu_number cpu)
+{
+  Rcu_data *rdp = &_rcu_data.cpu(cpu);
+  if (EXPECT_FALSE(rdp->_idle))
+    {
+      rdp->_idle = false;
+      Rcu_node *l = rcu()->leaf(cpu);
+        {
+          auto guard = lock_guard(l->_lock);
+          l->_active |= Rcu_glbl::leaf_bit(cpu);
+        }
+      rdp->_q_batch = Rcu::rcu()->_current;
+    }
+}
+
+//--------------------------------------------------------------------------
+IMPLEMENTATION:
+
+PUBLIC static inline
+void
+Rcu::enter_idle(Cpu_number cpu)
+{
+  Rcu_data *rdp = &_rcu_data.cpu(cpu);
+  rdp->enter_idle(rcu());
+}
+
 PRIVATE
 void
 Rcu_data::check_quiescent_state(Rcu_glbl *rgp)
@@ -379,11 +692,7 @@ Rcu_data::check_quiescent_state(Rcu_glbl *rgp)
     return;
 
   _pending = 0;
-
-  auto guard = lock_guard(rgp->_lock);
-
-  if (EXPECT_TRUE(_q_batch == rgp->_current))
-    rgp->cpu_quiet(_cpu);
+  rgp->report_quiet(_cpu, _q_batch);
 }
 
 
@@ -422,11 +731,7 @@ Rcu_data::~Rcu_data()
   Rcu_data *current_rdp = &Rcu::_rcu_data.current();
   Rcu_glbl *rgp = Rcu::rcu();
 
-    {
-      auto guard = lock_guard(rgp->_lock);
-      if (rgp->_current != rgp->_completed)
-	rgp->cpu_quiet(_cpu);
-    }
+  rgp->cpu_gone(_cpu);
 
   current_rdp->move_batch(_c);
   current_rdp->move_batch(_n);
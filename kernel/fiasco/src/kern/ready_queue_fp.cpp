@@ -23,13 +23,23 @@ class Ready_queue_fp
 
 private:
   typedef typename E::Fp_list List;
+  enum { Prio_words = 256 / MWORD_BITS };
+
   unsigned prio_highest;
+  unsigned _nr_ready;
+  /// Bit p set iff prio_next[p] is not empty.
+  Mword _prio_map[Prio_words];
+  /// Bit w set iff _prio_map[w] is not zero.
+  Mword _prio_words;
   List prio_next[256];
 
 public:
   void set_idle(E *sc)
   { sc->_prio = Config::Kernel_prio; }
 
+  /// Number of queued contexts, may be read from other CPUs as a hint.
+  unsigned nr_ready() const { return access_once(&_nr_ready); }
+
   void enqueue(E *, bool);
   void dequeue(E *);
   E *next_to_run() const;
@@ -52,6 +62,20 @@ E *
 Ready_queue_fp<E>::next_to_run() const
 { return prio_next[prio_highest].front(); }
 
+/**
+ * Highest priority with a non-empty list, 0 if all lists are empty.
+ */
+PRIVATE template<typename E> inline
+unsigned
+Ready_queue_fp<E>::find_highest() const
+{
+  if (!_prio_words)
+    return 0;
+
+  unsigned w = MWORD_BITS - 1 - __builtin_clzl(_prio_words);
+  return w * MWORD_BITS + MWORD_BITS - 1 - __builtin_clzl(_prio_map[w]);
+}
+
 /**
  * Enqueue context in ready-list.
  */
@@ -71,7 +95,11 @@ Ready_queue_fp<E>::enqueue(E *i, bool is_current_sched)
   if (prio > prio_highest)
     prio_highest = prio;
 
+  _prio_map[prio / MWORD_BITS] |= 1UL << (prio % MWORD_BITS);
+  _prio_words |= 1UL << (prio / MWORD_BITS);
+
   prio_next[prio].push(i, is_current_sched ? List::Front : List::Back);
+  ++_nr_ready;
 }
 
 /**
@@ -91,9 +119,17 @@ Ready_queue_fp<E>::dequeue(E *i)
   unsigned short prio = i->prio();
 
   prio_next[prio].remove(i);
+  --_nr_ready;
+
+  if (!prio_next[prio].empty())
+    return;
+
+  unsigned w = prio / MWORD_BITS;
+  if (!(_prio_map[w] &= ~(1UL << (prio % MWORD_BITS))))
+    _prio_words &= ~(1UL << w);
 
-  while (prio_next[prio_highest].empty() && prio_highest)
-    prio_highest--;
+  if (prio == prio_highest)
+    prio_highest = find_highest();
 }
 
 
@@ -114,3 +150,20 @@ void
 Ready_queue_fp<E>::deblock_refill(E *)
 {}
 
+/**
+ * Iterate the contexts queued at the highest priority.
+ * @param i  the previous context or 0 to start at the front
+ * @return the next context, 0 after the last one
+ */
+PUBLIC template<typename E> inline
+E *
+Ready_queue_fp<E>::next_highest(E *i) const
+{
+  E *f = prio_next[prio_highest].front();
+  if (!i)
+    return f;
+
+  E *n = *++List::iter(i);
+  return n != f ? n : 0;
+}
+
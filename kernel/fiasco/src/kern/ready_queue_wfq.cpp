@@ -1,5 +1,6 @@
 INTERFACE[sched_wfq || sched_fp_wfq]:
 
+#include "buddy_alloc.h"
 #include "member_offs.h"
 #include "types.h"
 #include "globals.h"
@@ -11,6 +12,19 @@ struct L4_sched_param_wfq : public L4_sched_param
   Mword weight;
 };
 
+/**
+ * WFQ ready queue: a binary min-heap of runnable contexts ordered by
+ * deadline.
+ *
+ * The heap starts in a small array inside the queue and moves to a larger
+ * block from Kmem_alloc when it fills up.  The contexts' _ready_link
+ * pointers into the heap are updated on each move.  The heap never
+ * shrinks; a CPU keeps the memory of its largest burst.
+ *
+ * enqueue() runs with the CPU lock held and must not fail, so it does not
+ * allocate: reserve() provides the larger block in advance, when a
+ * context that may become ready on this CPU is created.
+ */
 template< typename E >
 class Ready_queue_wfq
 {
@@ -33,15 +47,32 @@ public:
   void enqueue(E *, bool is_current);
   void dequeue(E *);
   E *next_to_run() const;
+  bool reserve(unsigned n);
+
+  enum
+  {
+    Inline_size = 32,
+    /// Capacity of the largest heap, in the largest Kmem_alloc block
+    Max_size = Buddy_alloc::Max_size / sizeof(E *),
+  };
 
 private:
+  enum { Spare_order_mask = 0x3f };
+
   void swap(unsigned a, unsigned b);
   void heap_up(unsigned a);
   void heap_down(unsigned a);
+  void grow();
 
   E *_current_sched;
+  E **_heap;
   unsigned _cnt;
-  E *_heap[1024];
+  unsigned _size;
+  unsigned char _order; ///< Kmem_alloc order of _heap, 0 for _inline
+  /// Block for the next grow(), from reserve(): its address, which is
+  /// page aligned, or'ed with its Kmem_alloc order
+  Mword _spare;
+  E *_inline[Inline_size];
 
   static typename E::Wfq_sc *_e(E *e) { return E::wfq_elem(e); }
 };
@@ -66,9 +97,12 @@ private:
 IMPLEMENTATION [sched_wfq || sched_fp_wfq]:
 
 #include <cassert>
+#include "atomic.h"
 #include "config.h"
 #include "cpu_lock.h"
 #include "kdb_ke.h"
+#include "kmem_alloc.h"
+#include "panic.h"
 #include "std_macros.h"
 
 
@@ -138,6 +172,91 @@ Ready_queue_wfq<E>::heap_down(unsigned a)
     }
 }
 
+/**
+ * Make room for more entries.  The queue is all zero initially, so the
+ * first call only switches to the inline array.  Later calls move the
+ * heap to the block left by reserve().
+ */
+IMPLEMENT
+template<typename E>
+void
+Ready_queue_wfq<E>::grow()
+{
+  if (!_heap)
+    {
+      _heap = _inline;
+      _size = Inline_size;
+      return;
+    }
+
+  Mword spare;
+  do
+    spare = access_once(&_spare);
+  while (!mp_cas(&_spare, spare, (Mword)0));
+
+  unsigned order = spare & Spare_order_mask;
+  E **h = (E **)(spare & ~(Mword)Spare_order_mask);
+  if (EXPECT_FALSE(!h || (1UL << order) / sizeof(E *) <= _size))
+    panic("WFQ: ready queue full (%u entries) without reservation", _size);
+
+  for (unsigned i = 0; i < _cnt; ++i)
+    {
+      h[i] = _heap[i];
+      _e(h[i])->_ready_link = &h[i];
+    }
+
+  if (_order)
+    Kmem_alloc::allocator()->free(_order, _heap);
+
+  _heap = h;
+  _order = order;
+  write_now(&_size, (unsigned)((1UL << order) / sizeof(E *)));
+}
+
+/**
+ * Make sure that the queue can hold `n` contexts without allocating in
+ * enqueue(), by providing a large enough block for the next grow().
+ * May be called for the queue of any CPU, without the CPU lock.
+ *
+ * \return false if `n` exceeds Max_size or there is not enough memory.
+ */
+IMPLEMENT
+template<typename E>
+bool
+Ready_queue_wfq<E>::reserve(unsigned n)
+{
+  if (n > Max_size)
+    return false;
+
+  unsigned order = Config::PAGE_SHIFT;
+  while ((1UL << order) / sizeof(E *) < n)
+    ++order;
+
+  for (;;)
+    {
+      // _size only grows, and grow() replaces the spare by a heap of its
+      // size, so a stale read errs on the safe side
+      Mword spare = access_once(&_spare);
+      if (n <= Inline_size || n <= access_once(&_size)
+          || (spare & Spare_order_mask) >= order)
+        return true;
+
+      void *b = Kmem_alloc::allocator()->alloc(order);
+      if (!b)
+        return false;
+
+      if (mp_cas(&_spare, spare, (Mword)b | order))
+        {
+          if (spare)
+            Kmem_alloc::allocator()->free(spare & Spare_order_mask,
+                                          (void *)(spare & ~(Mword)Spare_order_mask));
+          return true;
+        }
+
+      Kmem_alloc::allocator()->free(order, b);
+    }
+}
+
 /**
  * Enqueue context in ready-list.
  */
@@ -152,6 +271,9 @@ Ready_queue_wfq<E>::enqueue(E *i, bool /*is_current_sched**/)
   if (EXPECT_FALSE (i->in_ready_list()))
     return;
 
+  if (EXPECT_FALSE(_cnt == _size))
+    grow();
+
   unsigned n = _cnt++;
 
   E *&h = _heap[n];
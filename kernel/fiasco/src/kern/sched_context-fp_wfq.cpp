@@ -93,9 +93,16 @@ public:
     void set_idle(Sched_context *sc)
     { sc->_t = Wfq; sc->_sc.wfq._p = 0; wfq_rq.set_idle(sc); }
 
+    bool reserve(unsigned n) { return wfq_rq.reserve(n); }
+
     Sched_context *next_to_run() const;
     void deblock_refill(Sched_context *sc);
 
+    // only fixed-priority contexts take part in work stealing
+    unsigned nr_ready() const { return fp_rq.nr_ready(); }
+    Sched_context *next_highest(Sched_context *sc) const
+    { return fp_rq.next_highest(sc); }
+
   private:
     friend class Jdb_thread_list;
     Sched_context *_current_sched;
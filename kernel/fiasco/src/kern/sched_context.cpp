@@ -147,6 +147,90 @@ Sched_context::Ready_queue::deblock(Sched_context *sc, Sched_context *crs, bool
   return res;
 }
 
+// --------------------------------------------------------------------------
+INTERFACE [sched_wfq || sched_fp_wfq]:
+
+EXTENSION class Sched_context
+{
+  /// Number of contexts the ready queue of each CPU must be able to take
+  static Mword _reserved;
+};
+
+// --------------------------------------------------------------------------
+IMPLEMENTATION [sched_wfq || sched_fp_wfq]:
+
+#include "atomic.h"
+#include "panic.h"
+
+Mword Sched_context::_reserved;
+
+/**
+ * Account for a new context: make sure that the ready queue of every
+ * online CPU can take one more context without allocating memory in
+ * the enqueue path.
+ * \return false if a ready queue cannot grow that far.
+ */
+PUBLIC static
+bool
+Sched_context::reserve_ready_queues()
+{
+  Mword n;
+  do
+    n = access_once(&_reserved);
+  while (!mp_cas(&_reserved, n, n + 1));
+
+  for (Cpu_number cpu = Cpu_number::first(); cpu < Config::max_num_cpus(); ++cpu)
+    if (Per_cpu_data::valid(cpu) && !rq.cpu(cpu).reserve(n + 1))
+      {
+        release_ready_queues();
+        return false;
+      }
+
+  return true;
+}
+
+/** Undo reserve_ready_queues() for a deleted context. */
+PUBLIC static
+void
+Sched_context::release_ready_queues()
+{
+  Mword n;
+  do
+    n = access_once(&_reserved);
+  while (!mp_cas(&_reserved, n, n - 1));
+}
+
+/**
+ * Reserve room for all existing contexts in the ready queue of `cpu`,
+ * which is coming online.
+ */
+PUBLIC static
+void
+Sched_context::reserve_ready_queue(Cpu_number cpu)
+{
+  if (!rq.cpu(cpu).reserve(access_once(&_reserved)))
+    panic("CPU%u: cannot reserve ready queue for %lu contexts",
+          cxx::int_value<Cpu_number>(cpu), access_once(&_reserved));
+}
+
+// --------------------------------------------------------------------------
+IMPLEMENTATION [sched_fixed_prio]:
+
+PUBLIC static inline
+bool
+Sched_context::reserve_ready_queues()
+{ return true; }
+
+PUBLIC static inline
+void
+Sched_context::release_ready_queues()
+{}
+
+PUBLIC static inline
+void
+Sched_context::reserve_ready_queue(Cpu_number)
+{}
+
 INTERFACE [debug]:
 
 #include "tb_entry.h"
@@ -106,6 +106,7 @@ Scheduler::sys_run(L4_fpage::Rights, Syscall_frame *f, Utcb const *utcb)
     info.cpu = sched_param->cpus.first(Cpu::online_mask(), Config::max_num_cpus());
 
   info.sp = sched_param;
+  thread->set_affinity(sched_param->cpus);
   if (0)
     printf("CPU[%u]: run(thread=%lx, cpu=%u (%lx,%u,%u)\n",
            cxx::int_value<Cpu_number>(curr_cpu), thread->dbg_id(),
@@ -159,6 +159,13 @@ Mem_space::tlb_flush_spaces(bool all, Mem_space *s1, Mem_space *s2)
     }
 }
 
+PUBLIC static inline
+void
+Mem_space::tlb_flush_range(Tlb_range const &r)
+{
+  tlb_flush_spaces(false, r.space, 0);
+}
+
 /*
 PUBLIC inline
 bool 
@@ -34,6 +34,9 @@ public:
     Unmap       = 1,
     Cap_info    = 2,
     Add_ku_mem  = 3,
+    Map_batch   = 4,
+    Unmap_batch = 5,
+    Alloc_caps  = 6,
     Ldt_set_x86 = 0x11,
   };
 
@@ -66,7 +69,7 @@ IMPLEMENTATION:
 FIASCO_DEFINE_KOBJ(Task);
 
 static Kmem_slab_t<Task::Ku_mem> _k_u_mem_list_alloc("Ku_mem");
-Slab_cache *Space::Ku_mem::a = &_k_u_mem_list_alloc;
+Kmem_slab *Space::Ku_mem::a = &_k_u_mem_list_alloc;
 
 extern "C" void vcpu_resume(Trap_state *, Return_frame *sp)
    FIASCO_FASTCALL FIASCO_NORETURN;
@@ -108,14 +111,11 @@ Task::alloc_ku_mem_chunk(User<void>::Ptr u_addr, unsigned size, void **k_addr)
   assert_kdb ((size & (size - 1)) == 0);
 
   Kmem_alloc *const alloc = Kmem_alloc::allocator();
-  void *p = alloc->q_unaligned_alloc(ram_quota(), size);
+  void *p = alloc->q_unaligned_alloc_zeroed(ram_quota(), size);
 
   if (EXPECT_FALSE(!p))
     return -L4_err::ENomem;
 
-  // clean up utcbs
-  memset(p, 0, size);
-
   Virt_addr base((Address)p);
   Mem_space::Page_order page_size(Config::PAGE_SHIFT);
 
@@ -279,7 +279,7 @@ Task::Task(Ram_quota *q, Mem_space::Dir_type* pdir, Caps c)
 static Kmem_slab_t<Task> _task_allocator("Task");
 
 PROTECTED static
-Slab_cache*
+Kmem_slab*
 Task::allocator()
 { return &_task_allocator; }
 
@@ -352,14 +352,24 @@ Task::destroy(Kobject ***reap_list)
   fpage_unmap(this, L4_fpage::all_spaces(L4_fpage::Rights::FULL()), L4_map_mask::full(), reap_list);
 }
 
+/**
+ * Map a vector of fpages from the task named by the first send item
+ * into this task.  All fpages are mapped under a single acquisition of
+ * the existence locks, and the TLBs are flushed once at the end.
+ * Mapping stops at the first pair that fails; the error result then
+ * carries the number of pairs mapped before it in values[0].
+ * @param v  n pairs of send base (L4_msg_item) and send fpage, in the
+ *           UTCB or in kernel-user memory
+ */
 PRIVATE inline NOEXPORT
 L4_msg_tag
-Task::sys_map(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
+Task::map_fpages(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb,
+                 Mword const *v, unsigned n)
 {
   LOG_TRACE("Task map", "map", ::current(), Log_unmap,
       l->id = dbg_id();
-      l->mask  = utcb->values[1];
-      l->fpage = utcb->values[2]);
+      l->mask  = v[0];
+      l->fpage = v[1]);
 
   if (EXPECT_FALSE(!(rights & L4_fpage::Rights::CW())))
     return commit_result(-L4_err::EPerm);
@@ -385,11 +395,9 @@ Task::sys_map(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
   mask &= rights;
   mask |= L4_fpage::Rights::CD() | L4_fpage::Rights::CRW();
 
-  L4_fpage sfp(utcb->values[2]);
-  sfp.mask_rights(mask);
-
   ::Reap_list rl;
   L4_error ret;
+  unsigned done = 0;
 
     {
       // enforce lock order to prevent deadlocks.
@@ -402,8 +410,19 @@ Task::sys_map(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
 
       cpu_lock.clear();
 
-      ret = fpage_map(from, sfp, this,
-                      L4_fpage::all_spaces(), L4_msg_item(utcb->values[1]), &rl);
+      Tlb_flush_batch tlb;
+      for (; done < n; ++done)
+        {
+          L4_fpage sfp(access_once(&v[2 * done + 1]));
+          sfp.mask_rights(mask);
+
+          ret = fpage_map(from, sfp, this, L4_fpage::all_spaces(),
+                          L4_msg_item(access_once(&v[2 * done])), &rl, &tlb);
+          if (EXPECT_FALSE(!ret.ok()))
+            break;
+        }
+      tlb.flush();
+
       cpu_lock.lock();
     }
 
@@ -414,42 +433,48 @@ Task::sys_map(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
   // FIXME: treat reaped stuff
   if (ret.ok())
     return commit_result(0);
-  else
-    return commit_error(utcb, ret);
-}
 
+  utcb->values[0] = done;
+  return commit_error(utcb, ret, L4_msg_tag(1, 0, 0, 0));
+}
 
+/**
+ * Unmap a vector of fpages from this task, under a single acquisition of
+ * the existence lock and with a single TLB flush at the end.
+ * @param v  n fpages, in the UTCB or in kernel-user memory; the rights
+ *           bits of each fpage are replaced by the flushed access rights
+ */
 PRIVATE inline NOEXPORT
-L4_msg_tag
-Task::sys_unmap(Syscall_frame *f, Utcb *utcb)
+bool
+Task::unmap_fpages(L4_map_mask m, Mword *v, unsigned n)
 {
   ::Reap_list rl;
-  unsigned words = f->tag().words();
 
   LOG_TRACE("Task unmap", "unm", ::current(), Log_unmap,
             l->id = dbg_id();
-            l->mask  = utcb->values[1];
-            l->fpage = utcb->values[2]);
+            l->mask  = m.raw();
+            l->fpage = v[0]);
 
     {
       Lock_guard<Lock> guard;
 
       // FIXME: avoid locking the current task, it is not needed
       if (!guard.check_and_lock(&existence_lock))
-        return commit_error(utcb, L4_error::Not_existent);
+        return false;
 
       cpu_lock.clear();
 
-      L4_map_mask m(utcb->values[1]);
-
-      for (unsigned i = 2; i < words; ++i)
+      Tlb_flush_batch tlb;
+      for (unsigned i = 0; i < n; ++i)
         {
+          Mword fp = access_once(&v[i]);
           L4_fpage::Rights const flushed
-            = fpage_unmap(this, L4_fpage(utcb->values[i]), m, rl.list());
+            = fpage_unmap(this, L4_fpage(fp), m, rl.list(), &tlb);
 
-          utcb->values[i] = (utcb->values[i] & ~0xfUL)
-                          | cxx::int_value<L4_fpage::Rights>(flushed);
+          v[i] = (fp & ~0xfUL) | cxx::int_value<L4_fpage::Rights>(flushed);
         }
+      tlb.flush();
+
       cpu_lock.lock();
     }
 
@@ -457,9 +482,103 @@ Task::sys_unmap(Syscall_frame *f, Utcb *utcb)
   rl.del();
   cpu_lock.lock();
 
+  return true;
+}
+
+/**
+ * Find the descriptor array of a batched map or unmap in the
+ * kernel-user memory of this task.
+ * @return kernel address of the array, or 0 if it is not within
+ *         kernel-user memory
+ */
+PRIVATE inline NOEXPORT
+Mword *
+Task::ku_mem_vector(Mword uaddr, Mword words)
+{
+  if (EXPECT_FALSE(words > ~Mword(0) / sizeof(Mword)))
+    return 0;
+
+  Space::Ku_mem const *m
+    = find_ku_mem(User<void>::Ptr((void *)uaddr), words * sizeof(Mword));
+  if (EXPECT_FALSE(!m))
+    return 0;
+
+  return m->kern_addr(User<Mword>::Ptr((Mword *)uaddr));
+}
+
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Task::sys_map(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
+{
+  L4_msg_tag const tag = f->tag();
+  unsigned words = tag.words();
+
+  // the pairs and the send item of the source task must fit into the UTCB
+  if (EXPECT_FALSE(words + 2 * tag.items() > Utcb::Max_words))
+    return commit_result(-L4_err::EInval);
+
+  unsigned n = words > 3 ? (words - 1) / 2 : 1;
+
+  return map_fpages(rights, f, utcb, &utcb->values[1], n);
+}
+
+/**
+ * Map a vector of fpages given in kernel-user memory.
+ * values[1] is the address of the vector, values[2] the number of
+ * (send base, fpage) pairs.
+ */
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Task::sys_map_batch(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
+{
+  if (EXPECT_FALSE(f->tag().words() < 3 || !utcb->values[2]))
+    return commit_result(-L4_err::EInval);
+
+  Mword *v = ku_mem_vector(utcb->values[1], 2 * utcb->values[2]);
+  if (EXPECT_FALSE(!v))
+    return commit_result(-L4_err::EInval);
+
+  return map_fpages(rights, f, utcb, v, utcb->values[2]);
+}
+
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Task::sys_unmap(Syscall_frame *f, Utcb *utcb)
+{
+  unsigned words = f->tag().words();
+
+  if (EXPECT_FALSE(words > Utcb::Max_words))
+    return commit_result(-L4_err::EInval);
+
+  if (!unmap_fpages(L4_map_mask(utcb->values[1]), &utcb->values[2],
+                    words > 2 ? words - 2 : 0))
+    return commit_error(utcb, L4_error::Not_existent);
+
   return commit_result(0, words);
 }
 
+/**
+ * Unmap a vector of fpages given in kernel-user memory.
+ * values[1] is the address of the vector, values[2] the number of
+ * fpages, and values[3] the map mask.
+ */
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Task::sys_unmap_batch(Syscall_frame *f, Utcb *utcb)
+{
+  if (EXPECT_FALSE(f->tag().words() < 4 || !utcb->values[2]))
+    return commit_result(-L4_err::EInval);
+
+  Mword *v = ku_mem_vector(utcb->values[1], utcb->values[2]);
+  if (EXPECT_FALSE(!v))
+    return commit_result(-L4_err::EInval);
+
+  if (!unmap_fpages(L4_map_mask(utcb->values[3]), v, utcb->values[2]))
+    return commit_error(utcb, L4_error::Not_existent);
+
+  return commit_result(0);
+}
+
 PRIVATE inline NOEXPORT
 L4_msg_tag
 Task::sys_cap_valid(Syscall_frame *, Utcb *utcb)
@@ -519,6 +638,50 @@ Task::sys_add_ku_mem(Syscall_frame *f, Utcb *utcb)
   return commit_result(0);
 }
 
+/**
+ * Back the capability range of the object fpage in values[1] with cap
+ * pages in one go, so that later maps into the range need not allocate.
+ */
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Task::sys_alloc_caps(L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
+{
+  if (EXPECT_FALSE(!(rights & L4_fpage::Rights::CW())))
+    return commit_result(-L4_err::EPerm);
+
+  L4_fpage const fp(utcb->values[1]);
+  if (EXPECT_FALSE(f->tag().words() < 2 || !fp.is_objpage()))
+    return commit_result(-L4_err::EInval);
+
+  Mword const max = cxx::int_value<Cap_index>(obj_map_max_address());
+  Mword first = cxx::int_value<Cap_index>(fp.obj_index());
+  Mword end = max;
+  if (fp.order() < sizeof(Mword) * 8 - 1)
+    {
+      Mword const size = 1UL << fp.order();
+      first &= ~(size - 1);
+      if (first + size < max)
+        end = first + size;
+    }
+
+  if (EXPECT_FALSE(first >= max))
+    return commit_result(-L4_err::EInval);
+
+  bool ok;
+    {
+      Lock_guard<Lock> guard;
+
+      if (!guard.check_and_lock(&existence_lock))
+        return commit_error(utcb, L4_error::Not_existent);
+
+      cpu_lock.clear();
+      ok = caps_prealloc(Cap_index(first), Cap_index(end));
+      cpu_lock.lock();
+    }
+
+  return commit_result(ok ? 0 : -L4_err::ENomem);
+}
+
 PRIVATE inline NOEXPORT
 L4_msg_tag
 Task::sys_cap_info(Syscall_frame *f, Utcb *utcb)
@@ -552,12 +715,21 @@ Task::invoke(L4_obj_ref, L4_fpage::Rights rights, Syscall_frame *f, Utcb *utcb)
     case Unmap:
       f->tag(sys_unmap(f, utcb));
       return;
+    case Map_batch:
+      f->tag(sys_map_batch(rights, f, utcb));
+      return;
+    case Unmap_batch:
+      f->tag(sys_unmap_batch(f, utcb));
+      return;
     case Cap_info:
       f->tag(sys_cap_info(f, utcb));
       return;
     case Add_ku_mem:
       f->tag(sys_add_ku_mem(f, utcb));
       return;
+    case Alloc_caps:
+      f->tag(sys_alloc_caps(rights, f, utcb));
+      return;
     default:
       L4_msg_tag tag = f->tag();
       if (invoke_arch(tag, utcb))
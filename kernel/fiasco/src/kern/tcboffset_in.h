@@ -48,8 +48,6 @@
   DUMP_MEMBER1 (MEM_SPACE, Mem_space, _dir,                     PGTABLE)
 
 
-  DUMP_MEMBER1 (TBUF_STATUS, Tracebuffer_status, kerncnts,      KERNCNTS)
-
   DUMP_CAST_OFFSET (Thread, Receiver)
   DUMP_CAST_OFFSET (Thread, Sender)
 
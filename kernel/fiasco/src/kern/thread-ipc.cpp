@@ -40,6 +40,11 @@ protected:
 
   Syscall_frame *_snd_regs;
   L4_fpage::Rights _ipc_send_rights;
+
+private:
+  // finishes a cross-CPU IPC of this thread, see xcpu_ipc_done()
+  Drq _ipc_done_drq;
+  State_request _ipc_done_state;
 };
 
 class Buf_utcb_saver
@@ -61,7 +66,7 @@ public:
   Pf_msg_utcb_saver(Utcb const *u);
   void restore(Utcb *u);
 private:
-  Mword msg[2];
+  Mword msg[3];
 };
 
 struct Ipc_remote_request;
@@ -137,6 +142,7 @@ IMPLEMENTATION:
 #include "lock_guard.h"
 #include "logdefs.h"
 #include "map_util.h"
+#include "mem_space.h"
 #include "processor.h"
 #include "timer.h"
 #include "kdb_ke.h"
@@ -181,7 +187,7 @@ Thread::ipc_send_msg(Receiver *recv)
     }
   else
     {
-      drq_state_change(~state_del, state_add);
+      xcpu_ipc_done(~state_del, state_add);
       current()->schedule_if(current()->handle_drq());
     }
 }
@@ -214,6 +220,47 @@ Thread::snd_regs(Syscall_frame *r)
 { _snd_regs = r; }
 
 
+/**
+ * Fault-around window for a page fault at `pfa`, sent to the pager as
+ * third word of the page-fault message.  The pager may map any part of
+ * the window in its reply instead of just the faulting page.  If no page
+ * table covers `pfa` yet, the window is the whole superpage, which the
+ * pager can map with a single superpage mapping.
+ */
+PRIVATE inline NEEDS["config.h", "mem_space.h"]
+L4_fpage
+Thread::pf_around_window(Address pfa)
+{
+  Mem_space::Page_order o;
+  unsigned shift = Config::Pf_around_shift;
+
+  if (!mem_space()->v_lookup(Virt_addr(pfa), 0, &o, 0)
+      && o >= Mem_space::Page_order(Config::SUPERPAGE_SHIFT))
+    shift = Config::SUPERPAGE_SHIFT;
+
+  return L4_fpage::mem(pfa & ~((1UL << shift) - 1), shift);
+}
+
+/**
+ * Number of pages the pager mapped in reply to a page fault besides the
+ * faulting page, i.e., the number of page faults avoided.
+ */
+PRIVATE static inline
+Mword
+Thread::pf_around_pages(L4_msg_tag const &tag, Utcb const *utcb)
+{
+  Mword pages = 0;
+  unsigned const end = tag.words() + 2 * tag.items();
+  for (unsigned i = tag.words(); i < end && i < Utcb::Max_words; i += 2)
+    {
+      L4_fpage fp(utcb->values[i]);
+      if (fp.is_mempage() && fp.order() > Config::PAGE_SHIFT)
+        pages += (1UL << (fp.order() - Config::PAGE_SHIFT)) - 1;
+    }
+
+  return pages;
+}
+
 /** Page fault handler.
     This handler suspends any ongoing IPC, then sets up page-fault IPC.
     Finally, the ongoing IPC's state (if any) is restored.
@@ -279,9 +326,13 @@ Thread::handle_page_fault_pager(Thread_ptr const &_pager,
   utcb->values[0] = PF::addr_to_msgword0 (pfa, error_code);
   utcb->values[1] = regs()->ip(); //PF::pc_to_msgword1 (regs()->ip(), error_code));
 
+  unsigned words = 2;
+  if (protocol == L4_msg_tag::Label_page_fault)
+    utcb->values[words++] = pf_around_window(pfa).raw();
+
   L4_timeout_pair timeout(L4_timeout::Never, L4_timeout::Never);
 
-  L4_msg_tag tag(2, 0, 0, protocol);
+  L4_msg_tag tag(words, 0, 0, protocol);
 
   r.timeout(timeout);
   r.tag(tag);
@@ -307,6 +358,8 @@ Thread::handle_page_fault_pager(Thread_ptr const &_pager,
       // If the pager rejects the mapping, it replies -1 in msg.w0
       if (EXPECT_FALSE (utcb->values[0] == Mword(-1)))
         success = false;
+      else
+        CNT_PF_AROUND(pf_around_pages(r.tag(), utcb));
     }
 
   // restore previous IPC state
@@ -564,17 +617,28 @@ Thread::do_ipc(L4_msg_tag const &tag, bool have_send, Thread *partner,
             {
               if (handle_drq())
                 {
+                  CNT_SHORTCUT_FAILED;
                   rq.deblock(partner->sched(), cs, false);
                   schedule();
                 }
               else
-                schedule_if(switch_exec_locked(partner, Context::Not_Helping));
+                {
+                  CNT_SHORTCUT_SUCCESS;
+                  schedule_if(switch_exec_locked(partner, Context::Not_Helping));
+                }
             }
-	  else if (rq.deblock(partner->sched(), cs, true))
-	    switch_to_locked(partner);
+	  else
+	    {
+	      CNT_SHORTCUT_FAILED;
+	      if (rq.deblock(partner->sched(), cs, true))
+	        switch_to_locked(partner);
+	    }
 	}
       else
-	partner->drq_state_change(~Thread_ipc_transfer, Thread_ready);
+	{
+	  CNT_SHORTCUT_FAILED;
+	  partner->xcpu_ipc_done(~Thread_ipc_transfer, Thread_ready);
+	}
     }
 
   if (next)
@@ -659,6 +723,7 @@ Pf_msg_utcb_saver::Pf_msg_utcb_saver(Utcb const *u) : Buf_utcb_saver(u)
 {
   msg[0] = u->values[0];
   msg[1] = u->values[1];
+  msg[2] = u->values[2];
 }
 
 IMPLEMENT inline
@@ -668,6 +733,7 @@ Pf_msg_utcb_saver::restore(Utcb *u)
   Buf_utcb_saver::restore(u);
   u->values[0] = msg[0];
   u->values[1] = msg[1];
+  u->values[2] = msg[2];
 }
 
 
@@ -1133,9 +1199,10 @@ Thread::remote_ipc_send(Context *src, Ipc_remote_request *rq)
       break;
     }
 
-  // trigger remote_ipc_receiver_ready path, because we may need to grab locks
-  // and this is forbidden in a DRQ handler. So transfer the IPC in usual
-  // thread code. However, this induces a overhead of two extra IPIs.
+  // Items need the mapdb and existence locks, which must not be taken in a
+  // DRQ handler.  So only reserve the receiver here and let the sender do
+  // the transfer in usual thread code on its own CPU.  The receiver is
+  // released with xcpu_ipc_done(), which costs one extra IPI.
   if (rq->tag.items())
     {
       //LOG_MSG_3VAL(rq->partner, "pull", dbg_id(), 0, 0);
@@ -1151,6 +1218,39 @@ Thread::remote_ipc_send(Context *src, Ipc_remote_request *rq)
   return true;
 }
 
+PRIVATE static
+unsigned
+Thread::handle_xcpu_ipc_done(Drq *, Context *self, void *)
+{
+  Thread *t = nonull_static_cast<Thread*>(self);
+  t->state_change_dirty(t->_ipc_done_state.del, t->_ipc_done_state.add);
+  return Drq::Need_resched;
+}
+
+/**
+ * Finish the IPC this thread is blocked in on a remote CPU.
+ * \param mask  bits to keep in the thread state (state &= mask).
+ * \param add   bits to add to the thread state.
+ *
+ * Unlike drq_state_change() this does not wait for the target CPU, which
+ * saves the IPI for the reply.  The DRQ is embedded in this thread, so the
+ * DRQ code treats it as a reply: it makes the thread ready and runs
+ * handle_xcpu_ipc_done() on the thread's CPU.  A thread blocked in IPC
+ * has at most one such request pending, and any later DRQ to the thread
+ * (e.g. the next IPC handshake) is queued behind it.
+ *
+ * \pre runs on a different CPU than this thread.
+ */
+PRIVATE inline
+void
+Thread::xcpu_ipc_done(Mword mask, Mword add)
+{
+  _ipc_done_state.del = mask;
+  _ipc_done_state.add = add;
+  drq(&_ipc_done_drq, 0, 0, handle_xcpu_ipc_done, Drq::Target_ctxt,
+      Drq::No_wait);
+}
+
 PRIVATE static
 unsigned
 Thread::handle_remote_ipc_send(Drq *src, Context *, void *_rq)
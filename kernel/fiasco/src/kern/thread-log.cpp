@@ -14,6 +14,14 @@ Thread::log_page_fault()
   return Jdb_pf_trace::log();
 }
 
+/** Let the trace buffer raise its streaming-export IRQ. */
+PRIVATE static inline NEEDS["jdb_tbuf.h"]
+void
+Thread::tbuf_export_tick()
+{
+  Jdb_tbuf::export_tick();
+}
+
 
 /** Page-fault logging.
  */
@@ -426,7 +426,7 @@ Thread::thread_lock()
 { return &_thread_lock; }
 
 
-PUBLIC inline NEEDS ["config.h", "timeout.h"]
+PUBLIC inline NEEDS ["config.h", "timeout.h", Thread::tbuf_export_tick]
 void
 Thread::handle_timer_interrupt()
 {
@@ -436,6 +436,7 @@ Thread::handle_timer_interrupt()
     consume_time(Config::Scheduler_granularity);
 
   bool resched = Rcu::do_pending_work(_cpu);
+  tbuf_export_tick();
 
   // Check if we need to reschedule due to timeouts or wakeups
   if ((Timeout_q::timeout_queue.cpu(_cpu).do_timeouts() || resched)
@@ -761,7 +762,8 @@ Thread::start_migration()
 
   if (m->cpu == cpu())
     {
-      set_sched_params(m->sp);
+      if (m->sp)
+        set_sched_params(m->sp);
       Mem::mp_mb();
       write_now(&m->in_progress, true);
       return reinterpret_cast<Migration*>(0x1); // bit one == 1 --> need to reschedule
@@ -945,6 +947,10 @@ PUBLIC inline
 unsigned Thread::sys_fpage_unmap_log(Syscall_frame *)
 { return 0; }
 
+PRIVATE static inline
+void Thread::tbuf_export_tick()
+{}
+
 
 // ----------------------------------------------------------------------------
 IMPLEMENTATION [!mp]:
@@ -1103,6 +1109,7 @@ Thread::handle_remote_requests_irq()
   bool resched = _pending_rqq.current().handle_requests(&migration_q);
 
   resched |= Rcu::do_pending_work(c->cpu());
+  resched |= handle_steal_request();
 
   if (migration_q)
     resched |= static_cast<Thread*>(migration_q)->do_migration();
@@ -1171,7 +1178,9 @@ Thread::migrate_away(Migration *inf, bool remote)
         check_kdb (q.dequeue(&_pending_rq, Queue_item::Ok));
 
       Sched_context *sc = sched_context();
-      sc->set(inf->sp);
+      // a stolen thread keeps its parameters
+      if (inf->sp)
+        sc->set(inf->sp);
       sc->replenish();
       set_sched(sc);
 
@@ -1277,6 +1286,167 @@ Thread::migrate_xcpu(Cpu_number cpu)
   return false;
 }
 
+// ----------------------------------------------------------------------------
+IMPLEMENTATION [!sched_steal]:
+
+PUBLIC inline
+void
+Thread::set_affinity(L4_cpu_set const &)
+{}
+
+PRIVATE static inline
+bool
+Thread::handle_steal_request()
+{ return false; }
+
+// ----------------------------------------------------------------------------
+INTERFACE [sched_steal]:
+
+#include "cpu_mask.h"
+
+EXTENSION class Thread
+{
+public:
+  struct Steal_stats
+  {
+    Mword requests; ///< threads asked for while idle
+    Mword given;    ///< threads handed to idle CPUs
+    Mword refused;  ///< requests without a suitable thread
+  };
+
+private:
+  struct Steal_state
+  {
+    Mword thief;    ///< CPU waiting for a thread from us, ~0 if none
+    Migration mig;
+    Steal_stats stats;
+
+    explicit Steal_state(Cpu_number) : thief(~0UL), stats() {}
+  };
+
+  /// CPUs this thread may be pulled to by an idle CPU.
+  Cpu_mask _affinity;
+
+  static Per_cpu<Steal_state> _steal;
+};
+
+// ----------------------------------------------------------------------------
+IMPLEMENTATION [sched_steal]:
+
+#include "cpu.h"
+#include "ipi.h"
+
+DEFINE_PER_CPU Per_cpu<Thread::Steal_state> Thread::_steal(true);
+
+/**
+ * Set the CPUs an idle CPU may pull this thread to.
+ */
+PUBLIC
+void
+Thread::set_affinity(L4_cpu_set const &cpus)
+{
+  Cpu_mask m;
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    if (cpus.contains(i))
+      m.set(i);
+
+  _affinity = m;
+}
+
+PUBLIC static inline
+Thread::Steal_stats const &
+Thread::steal_stats(Cpu_number cpu)
+{ return _steal.cpu(cpu).stats; }
+
+/**
+ * Ask the CPU with the longest ready list to hand over a thread.
+ * \pre cpu_lock must be held, cpu is the current CPU and idle.
+ * \return true if a request was sent.
+ */
+PUBLIC static
+bool
+Thread::request_steal(Cpu_number cpu)
+{
+  assert_kdb (cpu_lock.test());
+
+  // a busy CPU has at least its idle thread and two threads queued
+  unsigned longest = 2;
+  Cpu_number victim = Cpu_number::nil();
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    {
+      if (i == cpu || !Cpu::online(i))
+        continue;
+
+      unsigned n = Sched_context::rq.cpu(i).nr_ready();
+      if (n > longest)
+        {
+          longest = n;
+          victim = i;
+        }
+    }
+
+  if (victim == Cpu_number::nil())
+    return false;
+
+  // one outstanding request per busy CPU
+  if (!mp_cas(&_steal.cpu(victim).thief, ~0UL,
+              (Mword)cxx::int_value<Cpu_number>(cpu)))
+    return false;
+
+  ++_steal.cpu(cpu).stats.requests;
+  Ipi::send(Ipi::Request, cpu, victim);
+  return true;
+}
+
+/**
+ * Hand a thread waiting at the highest priority to the idle CPU that asked
+ * for one.  The thread is moved by the normal migration path.
+ * \return true if rescheduling is needed.
+ */
+PRIVATE static
+bool
+Thread::handle_steal_request()
+{
+  Steal_state &s = _steal.current();
+  Mword t = access_once(&s.thief);
+  if (EXPECT_TRUE(t == ~0UL))
+    return false;
+
+  Cpu_number thief = Cpu_number(t);
+  Sched_context::Ready_queue &rq = Sched_context::rq.current();
+  Sched_context *running = rq.current_sched();
+  bool resched = false;
+  bool given = false;
+
+  for (Sched_context *sc = rq.next_highest(0); sc; sc = rq.next_highest(sc))
+    {
+      Thread *c = static_cast<Thread *>(sc->context());
+      if (sc == running || c == current() || sc != c->sched()
+          || !c->_affinity.get(thief) || !Cpu::online(thief)
+          || c->_migration)
+        continue;
+
+      s.mig.cpu = thief;
+      s.mig.sp = 0;
+      s.mig.in_progress = false;
+      if (!mp_cas(&c->_migration, (Migration *)0, &s.mig))
+        continue;
+
+      resched = c->initiate_migration();
+      given = true;
+      break;
+    }
+
+  if (given)
+    ++s.stats.given;
+  else
+    ++s.stats.refused;
+
+  Mem::mp_wmb();
+  write_now(&s.thief, ~0UL);
+  return resched;
+}
+
 //----------------------------------------------------------------------------
 IMPLEMENTATION [debug]:
 
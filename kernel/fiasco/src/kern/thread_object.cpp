@@ -26,6 +26,7 @@ IMPLEMENTATION:
 #include "irq_chip.h"
 #include "map_util.h"
 #include "processor.h"
+#include "sched_context.h"
 #include "task.h"
 #include "thread_state.h"
 #include "timer.h"
@@ -71,6 +72,25 @@ Obj_cap::revalidate(Kobject_iface *o)
 PUBLIC
 Thread_object::Thread_object() : Thread() {}
 
+/**
+ * Create a user thread, with room for it in the ready queue of every
+ * CPU.
+ * \return the thread, or 0 if there is not enough memory.
+ */
+PUBLIC static
+Thread_object *
+Thread_object::create(Ram_quota *q)
+{
+  if (!Sched_context::reserve_ready_queues())
+    return 0;
+
+  Thread_object *t = new (q) Thread_object();
+  if (!t)
+    Sched_context::release_ready_queues();
+
+  return t;
+}
+
 PUBLIC
 Thread_object::Thread_object(Context_mode_kernel k) : Thread(k) {}
 
@@ -88,6 +108,7 @@ Thread_object::operator delete(void *_t)
   Thread_object * const t = nonull_static_cast<Thread_object*>(_t);
   Ram_quota * const q = t->_quota;
   Kmem_alloc::allocator()->q_unaligned_free(q, Thread::Size, t);
+  Sched_context::release_ready_queues();
 
   LOG_TRACE("Kobject delete", "del", current(), Log_destroy,
       l->id = t->dbg_id();
@@ -44,16 +44,24 @@ private:
 };
 
 
+/**
+ * Per-CPU timeout queue, organized as a hierarchical timing wheel.
+ *
+ * Level 0 has Wheel_slots slots of 2^Wheel_granularity us each, a slot
+ * of level n covers all Wheel_slots slots of level n-1.  Enqueueing and
+ * removing a timeout is O(1); timeouts of higher levels are cascaded
+ * to the lower levels when the wheel time reaches their slot.
+ */
 class Timeout_q
 {
 private:
-  /**
-   * Timeout queue count (2^n) and  distance between two queues in 2^n.
-   */
   enum
   {
-    Wakeup_queue_count	  = 8,
-    Wakeup_queue_distance = 12 // i.e. (1<<12)us
+    Wheel_levels      = 4,
+    Wheel_slot_shift  = 6,
+    Wheel_slots       = 1 << Wheel_slot_shift,
+    Wheel_granularity = 10, // i.e. (1<<10)us
+    Wakeup_queue_count = Wheel_levels * Wheel_slots,
   };
 
   typedef Timeout::To_list To_list;
@@ -61,15 +69,26 @@ private:
   typedef To_list::Const_iterator Const_iterator;
 
   /**
-   * The timeout queues.
+   * The timeout queues, Wheel_slots per level.
    */
   To_list _q[Wakeup_queue_count];
 
+  /**
+   * Slots that may be non-empty, one bit per slot and a word per level.
+   * Bits of emptied slots are cleared lazily.
+   */
+  Unsigned64 _pending[Wheel_levels];
+
+  /**
+   * Wheel time in units of 2^Wheel_granularity us.  All slots before
+   * it are processed.
+   */
+  Unsigned64 _now;
+
   /**
    * The current programmed timeout.
    */
   Unsigned64 _current;
-  Unsigned64 _old_clock;
 
 public:
   static Per_cpu<Timeout_q> timeout_queue;
@@ -87,6 +106,7 @@ IMPLEMENTATION:
 #include <climits>
 #include "config.h"
 #include "kdb_ke.h"
+#include "logdefs.h"
 
 
 DEFINE_PER_CPU Per_cpu<Timeout_q> Timeout_q::timeout_queue;
@@ -107,22 +127,49 @@ unsigned
 Timeout_q::queues() const { return Wakeup_queue_count; }
 
 
+PRIVATE inline
+unsigned
+Timeout_q::slot(unsigned level, Unsigned64 tick) const
+{
+  return level * Wheel_slots
+         + ((tick >> (level * Wheel_slot_shift)) & (Wheel_slots - 1));
+}
+
+/**
+ * Put a timeout into the wheel slot matching its wakeup time.
+ */
+PRIVATE inline NEEDS[Timeout_q::slot]
+void
+Timeout_q::insert(Timeout *to)
+{
+  Unsigned64 t = to->_wakeup >> Wheel_granularity;
+  if (t < _now)
+    t = _now;
+
+  Unsigned64 delta = t - _now;
+  unsigned level = 0;
+  while (level < Wheel_levels - 1
+         && delta >= (1ULL << ((level + 1) * Wheel_slot_shift)))
+    ++level;
+
+  // beyond the range of the wheel: park in the farthest slot, the
+  // timeout is put to its final place when cascaded
+  if (delta >= (1ULL << (Wheel_levels * Wheel_slot_shift)))
+    t = _now + (1ULL << (Wheel_levels * Wheel_slot_shift)) - 1;
+
+  unsigned s = slot(level, t);
+  _q[s].push_front(to);
+  _pending[level] |= 1ULL << (s & (Wheel_slots - 1));
+}
+
 /**
  * Enqueue a new timeout.
  */
-PUBLIC inline NEEDS[Timeout_q::first, "timer.h", "config.h"]
+PUBLIC inline NEEDS[Timeout_q::insert, "timer.h", "config.h"]
 void
 Timeout_q::enqueue(Timeout *to)
 {
-  int queue = (to->_wakeup >> Wakeup_queue_distance) & (Wakeup_queue_count-1);
-
-  To_list &q = first(queue);
-  Iterator tmp = q.begin();
-
-  while (tmp != q.end() && tmp->_wakeup < to->_wakeup)
-    ++tmp;
-
-  q.insert_before(to, tmp);
+  insert(to);
 
   if (Config::Scheduler_one_shot && (to->_wakeup <= _current))
     {
@@ -239,10 +286,11 @@ Timeout::reset()
  * Dequeue an expired timeout.
  * @return true if a reschedule is necessary, false otherwise.
  */
-PRIVATE inline
+PRIVATE inline NEEDS["logdefs.h"]
 bool
 Timeout::expire()
 {
+  CNT_TIMEOUT;
   _flags.hit = 1;
   return expired();
 }
@@ -262,95 +310,187 @@ Timeout::dequeue(bool is_expired = true)
     return false;
 }
 
+/**
+ * Find the first non-empty slot of a level.
+ * @param level  the level of the wheel
+ * @param from   the slot index to start with
+ * @return the distance of the slot from `from`, or -1 if the level is
+ *         empty.
+ */
+PRIVATE
+int
+Timeout_q::first_pending(unsigned level, unsigned from)
+{
+  for (;;)
+    {
+      Unsigned64 p = _pending[level];
+      if (!p)
+        return -1;
+
+      // rotate, so that bit 0 is the slot `from`
+      if (from)
+        p = (p >> from) | (p << (Wheel_slots - from));
+
+      unsigned dist = __builtin_ctzll(p);
+      unsigned s = (from + dist) & (Wheel_slots - 1);
+      if (!_q[level * Wheel_slots + s].empty())
+        return dist;
+
+      _pending[level] &= ~(1ULL << s);
+    }
+}
+
+/**
+ * Re-insert all timeouts of the current slot of level `level`.
+ */
+PRIVATE
+void
+Timeout_q::cascade(unsigned level)
+{
+  unsigned s = slot(level, _now);
+  To_list &q = _q[s];
+
+  _pending[level] &= ~(1ULL << (s & (Wheel_slots - 1)));
+  while (!q.empty())
+    {
+      Timeout *to = q.front();
+      To_list::remove(to);
+      insert(to);
+    }
+}
+
+/**
+ * Advance the wheel time to the next slot of level 0 that may hold
+ * timeouts, but not beyond `target`.  Cascades the higher levels on the
+ * way.
+ */
+PRIVATE
+void
+Timeout_q::advance(Unsigned64 target)
+{
+  // next wrap-around of level 0
+  Unsigned64 next = (_now | (Wheel_slots - 1)) + 1;
+  unsigned idx = _now & (Wheel_slots - 1);
+
+  // pending slots in the rest of this round
+  Unsigned64 p = (_pending[0] >> idx) >> 1;
+  if (p)
+    next = _now + 1 + __builtin_ctzll(p);
+
+  if (next > target)
+    {
+      _now = target;
+      return;
+    }
+
+  _now = next;
+
+  for (unsigned level = 1;
+       level < Wheel_levels
+       && !(_now & ((1ULL << (level * Wheel_slot_shift)) - 1));
+       ++level)
+    cascade(level);
+}
+
+/**
+ * Compute the next point in time the timeout queue needs attention.
+ * This is the earliest timeout of level 0 or the earliest cascade of a
+ * higher level, whichever comes first.
+ * @param limit  the latest time to return
+ */
+PUBLIC
+Unsigned64
+Timeout_q::next_wakeup(Unsigned64 limit)
+{
+  Unsigned64 n = limit;
+
+  int dist = first_pending(0, _now & (Wheel_slots - 1));
+  if (dist >= 0)
+    {
+      To_list const &q = _q[slot(0, _now + dist)];
+      for (Const_iterator t = q.begin(); t != q.end(); ++t)
+        if (t->_wakeup < n)
+          n = t->_wakeup;
+    }
+
+  for (unsigned level = 1; level < Wheel_levels; ++level)
+    {
+      unsigned shift = level * Wheel_slot_shift;
+      unsigned idx = (_now >> shift) & (Wheel_slots - 1);
+      dist = first_pending(level, (idx + 1) & (Wheel_slots - 1));
+      if (dist < 0)
+        continue;
+
+      Unsigned64 c = (((_now >> shift) + dist + 1) << shift)
+                     << Wheel_granularity;
+      if (c < n)
+        n = c;
+    }
+
+  return n;
+}
+
 /**
  * Handles the timeouts, i.e. call expired() for the expired timeouts
  * and programs the "oneshot timer" to the next timeout.
  * @return true if a reschedule is necessary, false otherwise.
  */
 PUBLIC inline NEEDS [<cassert>, <climits>, "kip.h", "timer.h", "config.h",
-                     Timeout::expire]
+                     Timeout::expire, Timeout_q::slot]
 bool
 Timeout_q::do_timeouts()
 {
   bool reschedule = false;
+  Unsigned64 clock = Kip::k()->clock;
+  Unsigned64 target = clock >> Wheel_granularity;
 
-  // We test if the time between 2 activiations of this function is greater
-  // than the distance between two timeout queues.
-  // To avoid to lose timeouts, we calculating the missed queues and
-  // scan them too.
-  // This can only happen, if we dont enter the timer interrupt for a long
-  // time, usual with one shot timer.
-  // Because we initalize old_dequeue_time with zero,
-  // we can get an "miss" on the first timerinterrupt.
-  // But this is booting the system, which is uncritical.
-
-  // Calculate which timeout queues needs to be checked.
-  int start = (_old_clock >> Wakeup_queue_distance);
-  int diff  = (Kip::k()->clock >> Wakeup_queue_distance) - start;
-  int end   = (start + diff + 1) & (Wakeup_queue_count - 1);
-
-  // wrap around
-  start = start & (Wakeup_queue_count - 1);
-
-  // test if an complete miss
-  if (diff >= Wakeup_queue_count)
-    start = end = 0; // scan all queues
-
-  // update old_clock for the next run
-  _old_clock = Kip::k()->clock;
-
-  // ensure we always terminate
-  assert((end >= 0) && (end < Wakeup_queue_count));
-
+  // Walk the wheel from the last processed slot up to the current
+  // time.  Empty slots are skipped using the pending bitmaps, so a long
+  // time without timer interrupt (one-shot mode) is cheap.
   for (;;)
     {
-      To_list &q = first(start);
+      unsigned s = slot(0, _now);
+      To_list &q = _q[s];
       Iterator timeout = q.begin();
 
-      // now scan this queue for timeouts below current clock
-      while (timeout != q.end() && timeout->_wakeup <= (Kip::k()->clock))
+      while (timeout != q.end())
         {
-          reschedule |= timeout->expire();
+          if (timeout->_wakeup > clock)
+            {
+              ++timeout;
+              continue;
+            }
+
+          Timeout *to = *timeout;
           timeout = q.erase(timeout);
+          reschedule |= to->expire();
         }
 
-      // next queue
-      start = (start + 1) & (Wakeup_queue_count - 1);
+      if (q.empty())
+        _pending[0] &= ~(1ULL << s);
+
+      if (_now >= target)
+        break;
 
-      if (start == end)
-	break;
+      advance(target);
     }
 
   if (Config::Scheduler_one_shot)
     {
-      // scan all queues for the next minimum
-      //_current = (Unsigned64) ULONG_LONG_MAX;
-      _current = Kip::k()->clock + 10000; //ms
-      bool update_timer = true;
-
-      for (int i = 0; i < Wakeup_queue_count; i++)
-	{
-	  // make sure that something enqueued other than the dummy element
-	  if (first(i).empty())
-	    continue;
-
-	  update_timer = true;
-
-	  if (first(i).front()->_wakeup < _current)
-	    _current =  first(i).front()->_wakeup;
-	}
-
-      if (update_timer)
-	Timer::update_timer(_current);
-
+      _current = next_wakeup(clock + 10000); //ms
+      Timer::update_timer(_current);
     }
+
   return reschedule;
 }
 
 PUBLIC inline
 Timeout_q::Timeout_q()
-: _current(ULONG_LONG_MAX), _old_clock(0)
-{}
+: _now(0), _current(ULONG_LONG_MAX)
+{
+  for (unsigned i = 0; i < Wheel_levels; ++i)
+    _pending[i] = 0;
+}
 
 PUBLIC inline
 bool
@@ -358,6 +498,9 @@ Timeout_q::have_timeouts(Timeout const *ignore) const
 {
   for (unsigned i = 0; i < Wakeup_queue_count; ++i)
     {
+      if (!(_pending[i / Wheel_slots] & (1ULL << (i & (Wheel_slots - 1)))))
+        continue;
+
       To_list const &t = first(i);
       if (!t.empty())
         {
@@ -371,4 +514,3 @@ Timeout_q::have_timeouts(Timeout const *ignore) const
 
   return false;
 }
-
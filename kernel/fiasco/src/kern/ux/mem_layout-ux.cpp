@@ -121,6 +121,8 @@ public:
   /// reflect symbols in linker script
   static const char task_sighandler_start  asm ("_task_sighandler_start");
   static const char task_sighandler_end    asm ("_task_sighandler_end");
+  static const char task_batch_start       asm ("_task_batch_start");
+  static const char task_batch_end         asm ("_task_batch_end");
 
   static Address const kernel_trampoline_page;
 };
@@ -10,6 +10,7 @@ INTERFACE[ux]:
 #include "kmem.h"
 #include "mem_layout.h"
 #include "paging.h"
+#include "trampoline.h"
 
 extern "C" FIASCO_FASTCALL
 int
@@ -22,6 +23,9 @@ protected:
   void sync_kernel() const {}
 
   pid_t _pid;
+
+  // host mmap/munmap/mprotect calls not yet done in the host process
+  Trampoline::Batch _host_ops;
 };
 
 IMPLEMENTATION[ux]:
@@ -79,52 +83,64 @@ Mem_space::switchin_context(Mem_space *from)
   make_current();
 }
 
+/*
+ * page_map(), page_unmap() and page_protect() only queue the host system
+ * calls, sync_host() does them before the host process runs again.  The
+ * kernel itself accesses user memory through physical memory, so it does
+ * not depend on the host mappings being up to date.
+ */
+
 IMPLEMENT inline NEEDS [<asm/unistd.h>, <sys/mman.h>, "boot_info.h",
-                        "cpu_lock.h", "lock_guard.h", "mem_layout.h",
-                        "trampoline.h"]
+                        "cpu_lock.h", "lock_guard.h"]
 void
 Mem_space::page_map(Address phys, Address virt, Address size, Attr attr)
 {
   auto guard = lock_guard(cpu_lock);
 
-  Mword *trampoline = (Mword *)Mem_layout::kernel_trampoline_page;
-
-  *(trampoline + 1) = virt;
-  *(trampoline + 2) = size;
-  *(trampoline + 3) = PROT_READ | (attr.rights & Page::Rights::W() ? PROT_WRITE : 0);
-  *(trampoline + 4) = MAP_SHARED | MAP_FIXED;
-  *(trampoline + 5) = Boot_info::fd();
+  Address offset;
 
   if (phys >= Boot_info::fb_virt() &&
       phys + size <= Boot_info::fb_virt() +
                      Boot_info::fb_size() +
                      Boot_info::input_size())
-    *(trampoline + 6) = Boot_info::fb_phys() + (phys - Boot_info::fb_virt());
+    offset = Boot_info::fb_phys() + (phys - Boot_info::fb_virt());
   else
-    *(trampoline + 6) = phys;
+    offset = phys;
 
-  Trampoline::syscall(pid(), __NR_mmap, Mem_layout::Trampoline_page + 4);
+  _host_ops.add(pid(), __NR_mmap2, virt, size,
+                PROT_READ | (attr.rights & Page::Rights::W() ? PROT_WRITE : 0),
+                MAP_SHARED | MAP_FIXED, Boot_info::fd(), offset >> 12);
 }
 
-IMPLEMENT inline NEEDS [<asm/unistd.h>, "cpu_lock.h", "lock_guard.h",
-                        "trampoline.h"]
+IMPLEMENT inline NEEDS [<asm/unistd.h>, "cpu_lock.h", "lock_guard.h"]
 void
 Mem_space::page_unmap(Address virt, Address size)
 {
   auto guard = lock_guard(cpu_lock);
 
-  Trampoline::syscall(pid(), __NR_munmap, virt, size);
+  _host_ops.add(pid(), __NR_munmap, virt, size);
 }
 
-IMPLEMENT inline NEEDS [<asm/unistd.h>, "cpu_lock.h", "lock_guard.h",
-                        "trampoline.h"]
+IMPLEMENT inline NEEDS [<asm/unistd.h>, <sys/mman.h>, "cpu_lock.h",
+                        "lock_guard.h"]
 void
 Mem_space::page_protect(Address virt, Address size, unsigned attr)
 {
   auto guard = lock_guard(cpu_lock);
 
-  Trampoline::syscall(pid(), __NR_mprotect, virt, size,
-                      PROT_READ | (attr & Page_writable ? PROT_WRITE : 0));
+  _host_ops.add(pid(), __NR_mprotect, virt, size,
+                PROT_READ | (attr & Page_writable ? PROT_WRITE : 0));
+}
+
+/**
+ * Do the queued host memory-management calls in the host process.
+ * @pre cpu_lock held
+ */
+PUBLIC inline
+void
+Mem_space::sync_host()
+{
+  _host_ops.flush(pid());
 }
 
 
@@ -226,21 +242,24 @@ Mem_space::copy_from_user(T *kdst, T const *usrc, size_t n)
 
   char *ptr = (char *)usrc;
   char *dst = (char *)kdst;
-  char *src = 0;
 
   n *= sizeof (T);
 
-  while (n--)
+  // copy page by page, each page needs one page-table lookup
+  while (n)
     {
-      if (!src || ((Address)ptr & ~Config::PAGE_MASK) == 0)
-        src = user_to_kernel(ptr, false);
-
-      *dst++ = *src++;
-      ptr++;
+      size_t len = Config::PAGE_SIZE - ((Address)ptr & ~Config::PAGE_MASK);
+      if (len > n)
+        len = n;
+
+      memcpy(dst, user_to_kernel(ptr, false), len);
+      dst += len;
+      ptr += len;
+      n   -= len;
     }
 }
 
-PRIVATE inline NEEDS ["config.h", "cpu_lock.h", "lock_guard.h"]
+PRIVATE inline NEEDS [<cstring>, "config.h", "cpu_lock.h", "lock_guard.h"]
 template< typename T >
 void
 Mem_space::copy_to_user(T *udst, T const *ksrc, size_t n)
@@ -249,17 +268,19 @@ Mem_space::copy_to_user(T *udst, T const *ksrc, size_t n)
 
   char *ptr = (char *)udst;
   char *src = (char *)ksrc;
-  char *dst = 0;
 
   n *= sizeof (T);
 
-  while (n--)
+  while (n)
     {
-      if (!dst || ((Address)ptr & ~Config::PAGE_MASK) == 0)
-        dst = user_to_kernel(ptr, true);
-
-      *dst++ = *src++;
-      ptr++;
+      size_t len = Config::PAGE_SIZE - ((Address)ptr & ~Config::PAGE_MASK);
+      if (len > n)
+        len = n;
+
+      memcpy(user_to_kernel(ptr, true), src, len);
+      src += len;
+      ptr += len;
+      n   -= len;
     }
 }
 
@@ -5,12 +5,53 @@ INTERFACE:
 #include "types.h"			// for Mword
 
 class Trampoline
-{};
+{
+public:
+  /**
+   * Host system calls queued for one host process.
+   *
+   * flush() executes all of them in the host process with one run of
+   * a loop on the trampoline page, which costs a fixed number of ptrace
+   * calls instead of a trampoline round trip per system call.  add()
+   * merges a call into the previous one if both are the same kind of
+   * memory-management call on adjacent ranges.
+   */
+  class Batch
+  {
+  public:
+    Batch() : _num(0) {}
+
+    void add(pid_t pid, Mword nr, Mword addr, Mword len, Mword prot = 0,
+             Mword flags = 0, Mword fd = 0, Mword pgoff = 0);
+    void flush(pid_t pid);
+    bool empty() const { return !_num; }
+
+  private:
+    // one entry of the descriptor array of the trampoline loop
+    struct Call
+    {
+      Mword nr, addr, len, prot, flags, fd, pgoff;
+    };
+
+    enum
+    {
+      Max_calls = 32,
+      // descriptor array on the trampoline page, clear of the code and
+      // of the word at offset 0x100 used by the signal handler
+      Calls_offset = 0x200,
+    };
+
+    Call _calls[Max_calls];
+    unsigned _num;
+  };
+};
 
 IMPLEMENTATION:
 
 #include <csignal>
+#include <cstring>
 #include <unistd.h>
+#include <asm/unistd.h>
 #include <sys/ptrace.h>
 #include <sys/user.h>
 #include <sys/wait.h>
@@ -68,3 +109,88 @@ Trampoline::syscall (pid_t pid, Mword eax = 0, Mword ebx = 0,
 
   ptrace (PTRACE_SETREGS, pid, NULL, &regs);		// Restore registers
 }
+
+/**
+ * Queue a host system call.  Flushes the batch first if it is full.
+ * All calls but munmap ignore `prot`, only mmap2 uses `flags`, `fd`
+ * and `pgoff`, which is in units of 4KB.
+ */
+IMPLEMENT
+void
+Trampoline::Batch::add(pid_t pid, Mword nr, Mword addr, Mword len, Mword prot,
+                       Mword flags, Mword fd, Mword pgoff)
+{
+  if (_num)
+    {
+      Call *l = &_calls[_num - 1];
+      if (l->nr == nr && l->addr + l->len == addr
+          && (nr == __NR_munmap || l->prot == prot)
+          && (nr != __NR_mmap2
+              || (l->flags == flags && l->fd == fd
+                  && l->pgoff + (l->len >> 12) == pgoff)))
+        {
+          l->len += len;
+          return;
+        }
+    }
+
+  if (_num == Max_calls)
+    flush(pid);
+
+  Call *c = &_calls[_num++];
+  c->nr    = nr;
+  c->addr  = addr;
+  c->len   = len;
+  c->prot  = prot;
+  c->flags = flags;
+  c->fd    = fd;
+  c->pgoff = pgoff;
+}
+
+/**
+ * Execute the queued system calls in host process `pid`.
+ */
+IMPLEMENT
+void
+Trampoline::Batch::flush(pid_t pid)
+{
+  struct user_regs_struct regs, tramp_regs;
+  int status;
+
+  if (!_num)
+    return;
+
+  // don't perform syscalls without PID -- should only happen in tests
+  if (!pid)
+    {
+      _num = 0;
+      return;
+    }
+
+  Mword *calls = (Mword *)(Mem_layout::kernel_trampoline_page + Calls_offset);
+  memcpy (calls, _calls, _num * sizeof (Call));
+  calls[_num * (sizeof (Call) / sizeof (Mword))] = 0;
+
+  memcpy ((void *) Mem_layout::kernel_trampoline_page,
+          (void *) &Mem_layout::task_batch_start,
+          &Mem_layout::task_batch_end - &Mem_layout::task_batch_start);
+
+  ptrace (PTRACE_GETREGS, pid, NULL, &regs);		// Save registers
+
+  tramp_regs     = regs;
+  tramp_regs.eip = Mem_layout::Trampoline_page;
+  tramp_regs.esp = Mem_layout::Trampoline_page + Calls_offset;
+
+  ptrace (PTRACE_SETREGS, pid, NULL, &tramp_regs);	// Setup trampoline
+
+  do	// Run until the final breakpoint, dropping signals in between
+    {
+      ptrace (PTRACE_CONT, pid, NULL, NULL);
+      waitpid (pid, &status, 0);
+    }
+  while (WIFSTOPPED (status) && WSTOPSIG (status) != SIGTRAP);
+
+  ptrace (PTRACE_SETREGS, pid, NULL, &regs);		// Restore registers
+
+  _num = 0;
+}
@@ -5,6 +5,8 @@ INTERFACE:
 #include "initcalls.h"
 #include "types.h"
 
+class Mem_space;
+
 class Usermode
 {};
 
@@ -25,6 +27,7 @@ IMPLEMENTATION:
 #include <sys/mman.h>
 #include <sys/ptrace.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/user.h>
 #include <sys/wait.h>
 #include "undef_page.h"
@@ -37,6 +40,7 @@ IMPLEMENTATION:
 #include "fpu.h"
 #include "globals.h"
 #include "mem_layout.h"
+#include "mem_space.h"
 #include "pic.h"
 #include "processor.h"
 #include "regdefs.h"
@@ -44,17 +48,86 @@ IMPLEMENTATION:
 #include "thread.h"
 #include "thread_state.h"
 
+static bool have_process_vm = true;
+
+/**
+ * Copy memory of a host process.
+ * Uses a single process_vm_readv() call, or one ptrace call per word if
+ * the host does not provide process_vm_readv().
+ * @param pid process id of the host process.
+ * @param addr address in the host process.
+ * @param buf buffer for the data.
+ * @param n number of bytes to read.
+ * @return true if all bytes could be read.
+ */
+PUBLIC static
+bool
+Usermode::read_user (pid_t pid, Address addr, void *buf, size_t n)
+{
+#ifdef __NR_process_vm_readv
+  if (EXPECT_TRUE (have_process_vm))
+    {
+      struct iovec local  = { buf, n };
+      struct iovec remote = { (void *) addr, n };
+      long r = syscall (__NR_process_vm_readv, pid, &local, 1UL,
+                        &remote, 1UL, 0UL);
+
+      if (r == (long) n)
+        return true;
+
+      if (r >= 0 || errno != ENOSYS)
+        return false;
+
+      have_process_vm = false;
+    }
+#endif
+
+  char *dst = (char *) buf;
+  Address a = addr & ~(sizeof (Mword) - 1);
+
+  for (; a < addr + n; a += sizeof (Mword))
+    {
+      errno = 0;
+      Mword w = ptrace (PTRACE_PEEKTEXT, pid, a, NULL);
+      if (errno)
+        return false;
+
+      Address from = a < addr ? addr : a;
+      Address to   = a + sizeof (Mword) > addr + n ? addr + n
+                                                   : a + sizeof (Mword);
+      memcpy (dst + (from - addr), (char *) &w + (from - a), to - from);
+    }
+
+  return true;
+}
+
+/**
+ * Read up to one word of user memory.
+ * If the page is mapped in the page table of the task, read it through
+ * the kernel's mapping of physical memory, which needs no host system
+ * call, otherwise read it from the host process.
+ * @param space memory space of the task.
+ * @param addr user address.
+ * @param n number of bytes to read (at most sizeof (Mword)).
+ */
 PRIVATE static
 Mword
-Usermode::peek_at_addr (pid_t pid, Address addr, unsigned n)
+Usermode::peek_at_addr (Mem_space *space, Address addr, unsigned n)
 {
-  Mword val;
+  Mword val = 0;
+  Virt_addr virt = Virt_addr (addr);
+  Mem_space::Phys_addr phys;
+  Mem_space::Page_order size;
 
-  if ((addr & sizeof (Mword) - 1) + n > sizeof (Mword))
-    val = ptrace (PTRACE_PEEKTEXT, pid, addr, NULL);
+  if ((addr & Config::PAGE_MASK) == ((addr + n - 1) & Config::PAGE_MASK)
+      && space->v_lookup (virt, &phys, &size, 0))
+    {
+      phys = phys | cxx::get_lsb (virt, size);
+      memcpy (&val, (void *) Mem_layout::phys_to_pmem
+                               (Mem_space::Phys_addr::val (phys)), n);
+    }
   else
-    val = ptrace (PTRACE_PEEKTEXT, pid, addr & ~(sizeof (Mword) - 1), NULL) >>
-          CHAR_BIT * (addr & sizeof (Mword) - 1);
+    read_user (space->pid(), addr, &val, n);
 
   return val & (Mword) -1 >> CHAR_BIT * (sizeof (Mword) - n);
 }
@@ -109,8 +182,9 @@ Usermode::cancel_syscall (pid_t pid, struct user_regs_struct *regs)
 
   wait_for_stop (pid);
 
+  // no need to poke EAX, the host registers are set from regs before the
+  // process runs again
   regs->eax = regs->orig_eax;
-  ptrace (PTRACE_POKEUSER, pid, offsetof (struct user, regs.eax), regs->eax);
 }
 
 /**
@@ -281,10 +355,12 @@ Usermode::l4_syscall (Mword opcode)
 
 PRIVATE static inline NOEXPORT NEEDS["thread_state.h"]
 bool
-Usermode::user_exception(Cpu_number _cpu, pid_t pid, struct ucontext *context,
+Usermode::user_exception(Cpu_number _cpu, Mem_space *space,
+                         struct ucontext *context,
                          struct user_regs_struct *regs)
 {
   Mword trap, error = 0, addr = 0;
+  pid_t pid = space->pid();
 
   if (EXPECT_FALSE ((trap = kip_syscall (regs->eip))))
     {
@@ -307,12 +383,12 @@ Usermode::user_exception(Cpu_number _cpu, pid_t pid, struct ucontext *context,
         regs->eip += 2;
       else
         {
-          regs->eip  = peek_at_addr (pid, regs->esp, 4);
+          regs->eip  = peek_at_addr (space, regs->esp, 4);
           regs->esp += 4;
         }
     }
 
-  else if ((trap = l4_syscall (peek_at_addr (pid, regs->eip, 2))))
+  else if ((trap = l4_syscall (peek_at_addr (space, regs->eip, 2))))
     regs->eip += 2;
 
   else
@@ -342,7 +418,7 @@ Usermode::user_exception(Cpu_number _cpu, pid_t pid, struct ucontext *context,
         {
           case 0xd:
 	    if (Boot_info::emulate_clisti())
-	      switch (peek_at_addr (pid, regs->eip, 1))
+	      switch (peek_at_addr (space, regs->eip, 1))
 		{
 		  case 0xfa:	// cli
 		    Pic::set_owner (Boot_info::pid());
@@ -382,7 +458,7 @@ Usermode::user_exception(Cpu_number _cpu, pid_t pid, struct ucontext *context,
 
 PRIVATE static inline NOEXPORT
 bool
-Usermode::user_emulation(Cpu_number _cpu, int stop, pid_t pid,
+Usermode::user_emulation(Cpu_number _cpu, int stop, Mem_space *space,
                          struct ucontext *context,
                          struct user_regs_struct *regs)
 {
@@ -391,7 +467,7 @@ Usermode::user_emulation(Cpu_number _cpu, int stop, pid_t pid,
   switch (stop)
     {
       case SIGSEGV:
-        return user_exception (_cpu, pid, context, regs);
+        return user_exception (_cpu, space, context, regs);
 
       case SIGIO:
         int irq_pend;
@@ -402,14 +478,14 @@ Usermode::user_emulation(Cpu_number _cpu, int stop, pid_t pid,
         break;
 
       case SIGTRAP:
-        if (peek_at_addr (pid, regs->eip - 1, 1) == 0xcc)
+        if (peek_at_addr (space, regs->eip - 1, 1) == 0xcc)
           {
             trap = 0x3;
             break;
           }
-        else if (peek_at_addr (pid, regs->eip - 2, 2) == 0x80cd)
+        else if (peek_at_addr (space, regs->eip - 2, 2) == 0x80cd)
           {
-            cancel_syscall (pid, regs);
+            cancel_syscall (space->pid(), regs);
             trap       = 0xd;
             error      = 0x80 << 3 | 2;
             regs->eip -= 2;
@@ -457,7 +533,11 @@ Usermode::iret_to_user_mode(Cpu_number _cpu,
   struct user_regs_struct regs;
   int irq_pend;
   Context *t = context_of (kesp);
-  pid_t pid = t->vcpu_aware_space()->pid();
+  Mem_space *space = t->vcpu_aware_space();
+  pid_t pid = space->pid();
+
+  // before the host process may receive interrupt signals
+  space->sync_host();
 
   Pic::set_owner (pid);
 
@@ -532,7 +612,7 @@ Usermode::iret_to_user_mode(Cpu_number _cpu,
 
       check(ptrace (PTRACE_GETREGS, pid, NULL, &regs) == 0);
 
-      if (EXPECT_TRUE (user_emulation (_cpu, stop, pid, context, &regs)))
+      if (EXPECT_TRUE (user_emulation (_cpu, stop, space, context, &regs)))
         break;
     }
 
@@ -1,8 +1,10 @@
 INTERFACE:
 
 #include "icu_helper.h"
+#include "spin_lock.h"
 
 class Irq;
+class Task;
 
 class Vlog : public Icu_h<Vlog>, public Irq_chip_soft
 {
@@ -28,22 +30,50 @@ public:
   };
 
 private:
+  /**
+   * Log ring in kernel-user memory.  The task appends characters at
+   * `head`, the kernel consumes them at `tail`; both are free-running
+   * byte counters.
+   */
+  struct Ring
+  {
+    Mword head;
+    Mword tail;
+    char data[];
+  };
+
+  enum
+  {
+    Ring_min_order = 6,
+    Ring_max_order = 20,
+    Drain_chunk    = 128,
+  };
+
   Irq_base *_irq;
   Mword _i_flags;
   Mword _o_flags;
   Mword _l_flags;
+
+  Spin_lock<> _ring_lock;
+  Task *_ring_task;
+  Ring *_ring;
+  Mword _ring_mask;
 };
 
 IMPLEMENTATION:
 
+#include <libc_backend.h>
 #include "entry_frame.h"
 #include "map_util.h"
 #include "mem_space.h"
+#include "task.h"
 #include "l4_buf_iter.h"
 #include "thread.h"
 #include "vkey.h"
 #include "irq.h"
 #include "irq_controller.h"
+#include "lock_guard.h"
+#include "mem.h"
 
 
 FIASCO_DEFINE_KOBJ(Vlog);
@@ -51,8 +81,10 @@ FIASCO_DEFINE_KOBJ(Vlog);
 PUBLIC
 Vlog::Vlog()
 : _irq(0),
-  _i_flags(F_ICRNL), _o_flags(F_ONLCR), _l_flags(F_ECHO)
+  _i_flags(F_ICRNL), _o_flags(F_ONLCR), _l_flags(F_ECHO),
+  _ring_task(0), _ring(0), _ring_mask(0)
 {
+  _ring_lock.init();
   Vkey::set_echo(Vkey::Echo_crnl);
   // CAP idx 5 is the initial kernel stream
   initial_kobjects.register_obj(this, 5);
@@ -79,22 +111,157 @@ Vlog::log_string(Syscall_frame *f, Utcb const *u)
 
   while (len--)
     {
-      int c = *str++;
+      int c = out_char(*str++);
+      if (c >= 0)
+        putchar(c);
+    }
+}
 
-      // the kernel does this anyway
+/**
+ * Apply the output flags to `c`.
+ * @return the character to print, or -1 if it is to be dropped
+ */
+PRIVATE inline
+int
+Vlog::out_char(int c) const
+{
+  // the kernel does this anyway
 #if 0
-      if (_o_flags & F_ONLCR && c == '\n')
-	putchar('\r');
+  if (_o_flags & F_ONLCR && c == '\n')
+    putchar('\r');
 #endif
 
-      if (_o_flags & F_OCRNL && c == '\r')
-	c = '\n';
+  if (_o_flags & F_OCRNL && c == '\r')
+    c = '\n';
 
-      if (_o_flags & F_ONLRET && c == '\r')
-	continue;
+  if (_o_flags & F_ONLRET && c == '\r')
+    return -1;
+
+  return c;
+}
+
+/**
+ * Print up to Drain_chunk characters from the log ring.
+ * @return true if characters are left in the ring
+ */
+PRIVATE
+bool
+Vlog::drain_ring_chunk()
+{
+  char buf[Drain_chunk];
+  unsigned n = 0;
+
+  auto guard = lock_guard(_ring_lock);
+  if (!_ring)
+    return false;
+
+  Mword tail = _ring->tail;
+  Mword avail = access_once(&_ring->head) - tail;
+  if (!avail)
+    return false;
+
+  // the producer overwrote unconsumed data (or scribbled over the
+  // header), continue with the oldest data still in the ring
+  if (EXPECT_FALSE(avail > _ring_mask + 1))
+    {
+      tail += avail - (_ring_mask + 1);
+      avail = _ring_mask + 1;
+    }
+
+  Mem::mp_rmb();
+
+  for (; avail && n < Drain_chunk; --avail, ++tail)
+    {
+      int c = out_char(_ring->data[tail & _ring_mask]);
+      if (c >= 0)
+        buf[n++] = c;
+    }
+
+  Mem::mp_mb();
+  write_now(&_ring->tail, tail);
+
+  if (n)
+    {
+      unsigned long state = __libc_backend_printf_lock();
+      __libc_backend_outs(buf, n);
+      __libc_backend_printf_unlock(state);
+    }
+
+  return avail;
+}
+
+/**
+ * Drain the log ring completely.  The ring lock is dropped after each
+ * chunk so that draining a large ring does not block interrupts for
+ * the whole time.
+ */
+PRIVATE
+void
+Vlog::drain_ring()
+{
+  while (drain_ring_chunk())
+    ;
+}
 
-      putchar(c);
+/**
+ * Register a log ring in the kernel-user memory of the caller's task,
+ * replacing any previously registered ring, or unregister the ring if
+ * the ring address is 0.
+ * values[1] is the user address of the ring, values[2] the log2 of the
+ * size of its data area.
+ *
+ * The Vlog holds a reference to the task of the ring, which keeps the
+ * kernel-user memory alive until the ring is replaced.
+ */
+PRIVATE inline NOEXPORT
+L4_msg_tag
+Vlog::set_ring(L4_fpage::Rights rights, Syscall_frame *f, Utcb const *u)
+{
+  if (EXPECT_FALSE(!(rights & L4_fpage::Rights::W())))
+    return commit_result(-L4_err::EPerm);
+
+  if (EXPECT_FALSE(f->tag().words() < 3))
+    return commit_result(-L4_err::EInval);
+
+  Task *t = 0;
+  Ring *r = 0;
+  Mword order = u->values[2];
+
+  if (u->values[1])
+    {
+      if (order < Ring_min_order || order > Ring_max_order)
+        return commit_result(-L4_err::EInval);
+
+      t = static_cast<Task *>(current()->space());
+      User<Ring>::Ptr ur((Ring *)u->values[1]);
+      Space::Ku_mem const *m
+        = t->find_ku_mem(ur, sizeof(Ring) + (1UL << order));
+      if (!m)
+        return commit_result(-L4_err::EInval);
+
+      r = m->kern_addr(ur);
+      t->inc_ref();
     }
+
+  // print what is left in the old ring before switching
+  drain_ring();
+
+  Task *old;
+    {
+      auto guard = lock_guard(_ring_lock);
+      old = _ring_task;
+      _ring_task = t;
+      _ring_mask = r ? (1UL << order) - 1 : 0;
+      _ring = r;
+    }
+
+  if (old && old->dec_ref() == 0)
+    {
+      current()->rcu_wait();
+      delete old;
+    }
+
+  return commit_result(0);
 }
 
 PRIVATE inline NOEXPORT
@@ -246,6 +413,13 @@ Vlog::kinvoke(L4_obj_ref ref, L4_fpage::Rights rights, Syscall_frame *f,
     case 3: // get attr
       return get_attr(rights, f, s_msg);
 
+    case 4: // set log ring
+      return set_ring(rights, f, r_msg);
+
+    case 5: // doorbell: print the log ring
+      drain_ring();
+      return no_reply();
+
     default:
       return get_input(rights, f, s_msg);
     }
@@ -254,3 +428,14 @@ Vlog::kinvoke(L4_obj_ref ref, L4_fpage::Rights rights, Syscall_frame *f,
 
 static Vlog __vlog;
 
+/**
+ * Print pending output of the log ring.  Called from the idle loop so
+ * that tasks using a log ring need not ring the doorbell.
+ */
+PUBLIC static
+void
+Vlog::drain_idle()
+{
+  if (EXPECT_FALSE(__vlog._ring != 0))
+    __vlog.drain_ring();
+}
@@ -0,0 +1,141 @@
+INTERFACE:
+
+#include <cxx/slist>
+
+#include "per_cpu_data.h"
+#include "spin_lock.h"
+#include "types.h"
+
+/**
+ * Per-CPU pool of pre-zeroed pages.
+ *
+ * The idle loop of each CPU refills the pool of that CPU up to
+ * High_water pages (Kmem_alloc::refill_zeroed()), so that allocations of
+ * pages that must be cleared need not zero them on the syscall path
+ * (Kmem_alloc::unaligned_alloc_zeroed()).  Pool pages do not count
+ * against any quota until they are handed out.
+ */
+class Zero_page_pool
+{
+public:
+  enum { High_water = 32 };
+
+private:
+  // a free page in the pool; the link is the only non-zero word
+  struct Page : cxx::S_list_item {};
+  typedef cxx::S_list<Page> Page_list;
+
+  Spin_lock<> _lock;
+  Page_list _pages;
+  unsigned _cnt;
+
+  // lowest fill level since the pool was last full
+  unsigned _low;
+  Mword _hits;
+  Mword _misses;
+  Mword _refills;
+
+  static Per_cpu<Zero_page_pool> _pool;
+};
+
+
+IMPLEMENTATION:
+
+#include "lock_guard.h"
+#include "mem.h"
+
+DEFINE_PER_CPU Per_cpu<Zero_page_pool> Zero_page_pool::_pool;
+
+PUBLIC
+Zero_page_pool::Zero_page_pool()
+: _cnt(0), _low(0), _hits(0), _misses(0), _refills(0)
+{ _lock.init(); }
+
+/**
+ * Take a zeroed page from the pool of the current CPU.
+ * @return the page, or 0 if the pool is empty
+ */
+PUBLIC static
+void *
+Zero_page_pool::pop()
+{
+  Zero_page_pool &pool = _pool.current();
+  Page *p;
+  {
+    auto guard = lock_guard(pool._lock);
+    p = pool._pages.pop_front();
+    if (!p)
+      {
+        ++pool._misses;
+        return 0;
+      }
+
+    ++pool._hits;
+    if (--pool._cnt < pool._low)
+      pool._low = pool._cnt;
+  }
+
+  Mem::memset_mwords(p, 0, sizeof(Page) / sizeof(Mword));
+  return p;
+}
+
+/** Does the pool of `cpu` need more pages? */
+PUBLIC static inline
+bool
+Zero_page_pool::low(Cpu_number cpu)
+{ return access_once(&_pool.cpu(cpu)._cnt) < High_water; }
+
+/**
+ * Put the zeroed page `page` into the pool of `cpu`.
+ * @pre `page` is page aligned and completely zero
+ */
+PUBLIC static
+void
+Zero_page_pool::push(Cpu_number cpu, void *page)
+{
+  Zero_page_pool &pool = _pool.cpu(cpu);
+  auto guard = lock_guard(pool._lock);
+  pool._pages.push_front(new (page) Page());
+  ++pool._refills;
+  if (++pool._cnt == High_water)
+    pool._low = High_water;
+}
+
+/**
+ * Take any page from the pool of `cpu`, for giving it back to the
+ * allocator.
+ * @return the page (not zeroed), or 0 if the pool is empty
+ */
+PUBLIC static
+void *
+Zero_page_pool::reap(Cpu_number cpu)
+{
+  Zero_page_pool &pool = _pool.cpu(cpu);
+  auto guard = lock_guard(pool._lock);
+  Page *p = pool._pages.pop_front();
+  if (p)
+    pool._low = --pool._cnt;
+  return p;
+}
+
+// ------------------------------------------------------------------------
+IMPLEMENTATION [debug]:
+
+#include <cstdio>
+
+PUBLIC static
+void
+Zero_page_pool::debug_dump()
+{
+  printf("Zeroed page pools (high water %u pages):\n", (unsigned)High_water);
+  for (Cpu_number i = Cpu_number::first(); i < Config::max_num_cpus(); ++i)
+    {
+      if (!Per_cpu_data::valid(i))
+        continue;
+
+      Zero_page_pool const &p = _pool.cpu(i);
+      printf("  CPU%u: %u pages, low water %u, hits=%lu misses=%lu refills=%lu\n",
+             cxx::int_value<Cpu_number>(i), p._cnt, p._low,
+             p._hits, p._misses, p._refills);
+    }
+}
@@ -147,6 +147,13 @@ unsigned
 Slab_cache::entry_size(unsigned elem_size, unsigned alignment)
 { return (elem_size + alignment - 1) & ~(alignment - 1); }
 
+/** Size of one object including alignment padding, as charged to the
+ * quota. */
+PUBLIC inline
+unsigned
+Slab_cache::entry_size() const
+{ return _entry_size; }
+
 // 
 // Slab_cache
 // 
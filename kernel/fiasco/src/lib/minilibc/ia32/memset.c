@@ -0,0 +1,36 @@
+#include <stddef.h>
+
+/*
+ * Overrides the generic memset.c.  Short fills use 4-byte stores, which
+ * need not be aligned on ia32.  Long fills align the destination and
+ * use rep stosl, whose startup cost only pays off from a few hundred bytes.
+ */
+void * memset(void * dst, int s, size_t count) {
+  typedef unsigned long __attribute__((may_alias)) word;
+  register char *a = dst;
+  word w = (unsigned char)s * (~0UL / 0xff);
+
+  if (count >= 512) {
+    unsigned long head = -(unsigned long)a & 3, words = (count - head) >> 2;
+    unsigned long tail = (count - head) & 3;
+
+    asm volatile ("cld					\n\t"
+                  "rep stosb %%al, %%es:(%%edi)		\n\t"
+                  "movl %2, %%ecx				\n\t"
+                  "rep stosl %%eax, %%es:(%%edi)		\n\t"
+                  "movl %3, %%ecx				\n\t"
+                  "rep stosb %%al, %%es:(%%edi)		\n\t"
+                  : "+&c" (head), "+&D" (a)
+                  : "g" (words), "g" (tail), "a" (w)
+                  : "memory");
+    return dst;
+  }
+
+  for (; count >= sizeof(word); count -= sizeof(word)) {
+    *(word *)a = w;
+    a += sizeof(word);
+  }
+  while (count--)
+    *a++ = s;
+  return dst;
+}
@@ -0,0 +1,29 @@
+#ifndef __MEM_WORD_H__
+#define __MEM_WORD_H__
+
+/*
+ * Helpers for the word-at-a-time mem* and str* routines.  The routines
+ * only do word accesses to addresses that are word aligned, so they
+ * also work on architectures without unaligned loads and stores.
+ */
+
+#include <stddef.h>
+
+typedef unsigned long __attribute__((may_alias)) mem_word_t;
+
+#define MEM_WSIZE	(sizeof(mem_word_t))
+#define MEM_WMASK	(MEM_WSIZE - 1)
+
+/* the byte `c` in each byte of a word */
+#define MEM_WREP(c)	((mem_word_t)-1 / 0xff * (unsigned char)(c))
+
+/* nonzero iff one of the bytes of `x` is zero */
+#define MEM_WHASZERO(x)	(((x) - MEM_WREP(0x01)) & ~(x) & MEM_WREP(0x80))
+
+/* are `a` and `b` at the same offset to a word boundary? */
+#define MEM_WCOALIGNED(a, b) \
+  ((((unsigned long)(a) ^ (unsigned long)(b)) & MEM_WMASK) == 0)
+
+#define MEM_WALIGNED(a)	(((unsigned long)(a) & MEM_WMASK) == 0)
+
+#endif // __MEM_WORD_H__
@@ -1,9 +1,27 @@
 #include <stddef.h>
+#include "mem_word.h"
 
 int memcmp(const void *dst, const void *src, size_t count) {
   register int r;
-  register const char *d=dst;
-  register const char *s=src;
+  register const unsigned char *d=dst;
+  register const unsigned char *s=src;
+
+  /* skip equal words, the differing byte is found by the byte loop */
+  if (count >= MEM_WSIZE && MEM_WCOALIGNED(d, s)) {
+    for (; !MEM_WALIGNED(d); --count) {
+      if ((r=(*d - *s)))
+        return r;
+      ++d;
+      ++s;
+    }
+    for (; count >= MEM_WSIZE; count -= MEM_WSIZE) {
+      if (*(const mem_word_t *)d != *(const mem_word_t *)s)
+        break;
+      d += MEM_WSIZE;
+      s += MEM_WSIZE;
+    }
+  }
+
   while (count--) {
     if ((r=(*d - *s)))
       return r;
@@ -1,8 +1,25 @@
 #include <stddef.h>
+#include "mem_word.h"
 
 void* memcpy(void* dst, const void* src, size_t count) {
   register char *d=dst;
   register const char *s=src;
+
+  if (count >= MEM_WSIZE && MEM_WCOALIGNED(d, s)) {
+    for (; !MEM_WALIGNED(d); --count)
+      *d++ = *s++;
+    for (; count >= 4 * MEM_WSIZE; count -= 4 * MEM_WSIZE) {
+      mem_word_t *wd = (mem_word_t *)d;
+      const mem_word_t *ws = (const mem_word_t *)s;
+      wd[0] = ws[0]; wd[1] = ws[1]; wd[2] = ws[2]; wd[3] = ws[3];
+      d += 4 * MEM_WSIZE; s += 4 * MEM_WSIZE;
+    }
+    for (; count >= MEM_WSIZE; count -= MEM_WSIZE) {
+      *(mem_word_t *)d = *(const mem_word_t *)s;
+      d += MEM_WSIZE; s += MEM_WSIZE;
+    }
+  }
+
   ++count;	/* this actually produces better code than using count-- */
   while (--count) {
     *d = *s;
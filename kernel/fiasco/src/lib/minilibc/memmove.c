@@ -6,6 +6,7 @@
 #endif
 #include <stddef.h>
 #include <string.h>
+#include "mem_word.h"
 
 void *memmove(void *dst, const void *src, size_t count)
 {
@@ -15,13 +16,32 @@ void *memmove(void *dst, const void *src, size_t count)
   {
     if (src>dst)
     {
+      if (count >= MEM_WSIZE && MEM_WCOALIGNED(a, b))
+      {
+        for (; !MEM_WALIGNED(a); --count) *a++ = *b++;
+        for (; count >= MEM_WSIZE; count -= MEM_WSIZE)
+        {
+          *(mem_word_t *)a = *(const mem_word_t *)b;
+          a += MEM_WSIZE; b += MEM_WSIZE;
+        }
+      }
       while (count--) *a++ = *b++;
     }
     else
     {
-      a+=count-1;
-      b+=count-1;
-      while (count--) *a-- = *b--;
+      /* copy backwards, a and b point behind the bytes still to copy */
+      a+=count;
+      b+=count;
+      if (count >= MEM_WSIZE && MEM_WCOALIGNED(a, b))
+      {
+        for (; !MEM_WALIGNED(a); --count) *--a = *--b;
+        for (; count >= MEM_WSIZE; count -= MEM_WSIZE)
+        {
+          a -= MEM_WSIZE; b -= MEM_WSIZE;
+          *(mem_word_t *)a = *(const mem_word_t *)b;
+        }
+      }
+      while (count--) *--a = *--b;
     }
   }
   return dst;
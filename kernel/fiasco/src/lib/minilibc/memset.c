@@ -1,7 +1,24 @@
 #include <stddef.h>
+#include "mem_word.h"
 
 void * memset(void * dst, int s, size_t count) {
     register char * a = dst;
+
+    if (count >= MEM_WSIZE) {
+	mem_word_t w = MEM_WREP(s);
+	for (; !MEM_WALIGNED(a); --count)
+	    *a++ = s;
+	for (; count >= 4 * MEM_WSIZE; count -= 4 * MEM_WSIZE) {
+	    mem_word_t *wa = (mem_word_t *)a;
+	    wa[0] = w; wa[1] = w; wa[2] = w; wa[3] = w;
+	    a += 4 * MEM_WSIZE;
+	}
+	for (; count >= MEM_WSIZE; count -= MEM_WSIZE) {
+	    *(mem_word_t *)a = w;
+	    a += MEM_WSIZE;
+	}
+    }
+
     count++;	/* this actually creates smaller code than using count-- */
     while (--count)
 	*a++ = s;
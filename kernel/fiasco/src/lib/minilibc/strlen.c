@@ -1,10 +1,23 @@
 #include <string.h>
+#include "mem_word.h"
 
 size_t
 strlen(const char *s)
 {
-  register int i;
+  register const char *p = s;
+  const mem_word_t *w;
+
   if (!s) return 0;
-  for (i=0; *s; ++s) ++i;
-  return i;
+
+  for (; !MEM_WALIGNED(p); ++p)
+    if (!*p)
+      return p - s;
+
+  /* aligned word loads never cross a page boundary */
+  for (w = (const mem_word_t *)p; !MEM_WHASZERO(*w); ++w)
+    ;
+
+  for (p = (const char *)w; *p; ++p)
+    ;
+  return p - s;
 }
@@ -0,0 +1,101 @@
+/*
+ * Capability lookup benchmark.
+ *
+ * Runs as root task.  Measures the latency of syscalls that resolve a
+ * capability index in
+ *  - the caller's own task, which reads the virtually mapped cap table,
+ *  - another task at a low cap index, which the kernel resolves through
+ *    its per-space cap-page cache,
+ *  - another task at a high cap index, which the kernel resolves by
+ *    walking the page table of the cap area.
+ * For the other task, map/unmap round trips of a capability are measured
+ * as well.
+ */
+
+#include <l4/sys/consts.h>
+#include <l4/sys/factory.h>
+#include <l4/sys/task.h>
+#include <l4/sys/types.h>
+#include <l4/util/rdtsc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+  Rounds     = 100000,
+  Map_rounds = 10000,
+  Child_cap  = 0x20 << L4_CAP_SHIFT,
+  Low_idx    = 0x10,     /* first cap page: cached */
+  High_idx   = 0x10000,  /* far beyond the cached cap pages */
+};
+
+static l4_cpu_time_t
+bench_cap_valid(l4_cap_idx_t task, l4_cap_idx_t cap)
+{
+  l4_cpu_time_t start;
+  unsigned i;
+
+  start = l4_rdtsc();
+  for (i = 0; i < Rounds; ++i)
+    l4_task_cap_valid(task, cap);
+  return (l4_rdtsc() - start) / Rounds;
+}
+
+static int
+map_cap(unsigned idx)
+{
+  return l4_error(l4_task_map(Child_cap, L4_BASE_TASK_CAP,
+                              l4_obj_fpage(L4_BASE_FACTORY_CAP, 0,
+                                           L4_FPAGE_RWX),
+                              l4_map_obj_control(idx << L4_CAP_SHIFT,
+                                                 L4_MAP_ITEM_MAP)));
+}
+
+static l4_cpu_time_t
+bench_map_unmap(unsigned idx)
+{
+  l4_cpu_time_t start;
+  unsigned i;
+
+  start = l4_rdtsc();
+  for (i = 0; i < Map_rounds; ++i)
+    {
+      map_cap(idx);
+      l4_task_unmap(Child_cap,
+                    l4_obj_fpage(idx << L4_CAP_SHIFT, 0, L4_FPAGE_RWX),
+                    L4_FP_ALL_SPACES);
+    }
+  return (l4_rdtsc() - start) / Map_rounds;
+}
+
+int
+main(void)
+{
+  if (l4_error(l4_factory_create_task(L4_BASE_FACTORY_CAP, Child_cap,
+                                      l4_fpage_invalid()))
+      || map_cap(Low_idx) || map_cap(High_idx))
+    {
+      printf("capbench: cannot set up child task\n");
+      exit(1);
+    }
+
+  printf("cap lookup, %d rounds:\n", Rounds);
+  printf("  own task:           %llu cycles\n",
+         (unsigned long long)bench_cap_valid(L4_BASE_TASK_CAP,
+                                             L4_BASE_FACTORY_CAP));
+  printf("  other task, cached: %llu cycles\n",
+         (unsigned long long)bench_cap_valid(Child_cap,
+                                             Low_idx << L4_CAP_SHIFT));
+  printf("  other task, walk:   %llu cycles\n",
+         (unsigned long long)bench_cap_valid(Child_cap,
+                                             High_idx << L4_CAP_SHIFT));
+
+  printf("cap map/unmap, %d rounds:\n", Map_rounds);
+  printf("  cached:             %llu cycles\n",
+         (unsigned long long)bench_map_unmap(Low_idx));
+  printf("  walk:               %llu cycles\n",
+         (unsigned long long)bench_map_unmap(High_idx));
+
+  exit(0);
+}
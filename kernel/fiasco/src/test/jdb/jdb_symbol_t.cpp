@@ -0,0 +1,181 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+#include "jdb_symbol.h"
+#include "jdb_util.h"
+
+// Checks Jdb_util::sort() and the address index of Jdb_symbol_info: with
+// the index, exact, fuzzy and batched lookups must give the same symbols
+// as a scan of the symbol list without it.
+
+enum
+{
+  Nr_sort  = 1000,
+  Nr_syms  = 400,
+  Nr_addrs = 300,     // distinct symbol addresses, so there are aliases
+  Sym_base = 0x100000,
+  Sym_step = 0x20,
+};
+
+static Unsigned32 rnd_state = 42;
+
+static Unsigned32
+rnd()
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return rnd_state >> 8;
+}
+
+static bool
+word_less(Unsigned32 x, Unsigned32 y)
+{ return x < y; }
+
+static bool
+sort_ok(unsigned n)
+{
+  static Unsigned32 a[Nr_sort];
+  Unsigned32 sum = 0, xsum = 0;
+
+  for (unsigned i = 0; i < n; ++i)
+    {
+      a[i] = rnd() % (n / 2 + 1);   // with duplicates
+      sum += a[i];
+      xsum ^= a[i];
+    }
+
+  Jdb_util::sort(a, n, word_less);
+
+  for (unsigned i = 0; i < n; ++i)
+    {
+      if (i && a[i - 1] > a[i])
+        return false;
+      sum -= a[i];
+      xsum ^= a[i];
+    }
+
+  return !sum && !xsum;
+}
+
+static void
+test_sort()
+{
+  static unsigned const sizes[] = { 0, 1, 2, 3, 64, Nr_sort };
+
+  cout << "[UTEST] Jdb_util::sort" << endl;
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    cout << "[UTEST]   " << setbase(10) << sizes[i] << " elements: "
+         << (sort_ok(sizes[i]) ? "ok" : "FAILED") << endl;
+}
+
+// symbol table in nm format, see Jdb_symbol_info::transform()
+static char sym_text[Nr_syms * 32 + 64];
+static Unsigned32 sym_index[Nr_syms];
+static Jdb_symbol_info info;
+
+static Address
+query(unsigned i)
+{
+  return Sym_base - 2 * Sym_step + i * (Sym_step / 4);
+}
+
+enum { Nr_queries = (Nr_addrs + 4) * 4 };
+
+static char const *exact_ref[Nr_queries];
+static char const *fuzzy_ref[Nr_queries];
+
+static size_t
+make_symbols()
+{
+  size_t len = 0;
+
+  for (unsigned i = 0; i < Nr_syms; ++i)
+    {
+      // a few symbols that are never shown for an address
+      char const *name = i % 50 == 7 ? "Letext" : "sym";
+      len += snprintf(sym_text + len, sizeof(sym_text) - len, "%0*lx T %s_%u\n",
+                      (int)Jdb_symbol::Digits,
+                      (unsigned long)(Sym_base + (rnd() % Nr_addrs) * Sym_step),
+                      name, i);
+    }
+
+  // room for terminating the transformed list
+  return len + 4 * sizeof(Address);
+}
+
+static void
+test_index()
+{
+  unsigned exact_bad = 0, fuzzy_bad = 0, batch_bad = 0, found = 0;
+
+  cout << "[UTEST] Jdb_symbol_info index" << endl;
+
+  if (!info.set((Address)sym_text, make_symbols()))
+    {
+      cout << "[UTEST]   set FAILED" << endl;
+      return;
+    }
+
+  for (unsigned i = 0; i < Nr_queries; ++i)
+    {
+      exact_ref[i] = info.find(query(i), false);
+      fuzzy_ref[i] = info.find(query(i), true);
+    }
+
+  if (info.index_size() > sizeof(sym_index))
+    {
+      cout << "[UTEST]   index size FAILED" << endl;
+      return;
+    }
+  info.set_index(sym_index);
+
+  for (unsigned i = 0; i < Nr_queries; ++i)
+    {
+      if (info.find(query(i), false) != exact_ref[i])
+        ++exact_bad;
+      if (info.find(query(i), true) != fuzzy_ref[i])
+        ++fuzzy_bad;
+    }
+
+  static Address addrs[Nr_queries];
+  static char const *syms[Nr_queries];
+
+  for (unsigned i = 0; i < Nr_queries; ++i)
+    addrs[i] = query(i);
+
+  found = info.find_all(addrs, syms, Nr_queries);
+
+  for (unsigned i = 0; i < Nr_queries; ++i)
+    {
+      char const *ref = fuzzy_ref[i];
+      if (!ref)
+        batch_bad += syms[i] != 0;
+      else if (syms[i] != ref + Jdb_symbol::Start
+               || addrs[i] != query(i) - *(Address const *)ref)
+        ++batch_bad;
+      else
+        --found;
+    }
+
+  info.clear_index();
+
+  cout << "[UTEST]   exact lookups: " << (exact_bad ? "FAILED" : "ok") << endl;
+  cout << "[UTEST]   fuzzy lookups: " << (fuzzy_bad ? "FAILED" : "ok") << endl;
+  cout << "[UTEST]   batch lookups: " << (batch_bad || found ? "FAILED" : "ok")
+       << endl;
+}
+
+int main()
+{
+  test_sort();
+  test_index();
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
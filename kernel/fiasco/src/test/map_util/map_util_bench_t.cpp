@@ -0,0 +1,224 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+#include "map_util.h"
+#include "space.h"
+#include "globals.h"
+#include "config.h"
+
+#include "boot_info.h"
+#include "cpu.h"
+#include "kip_init.h"
+#include "kmem.h"
+#include "kmem_alloc.h"
+#include "per_cpu_data_alloc.h"
+#include "pic.h"
+#include "static_init.h"
+#include "usermode.h"
+
+IMPLEMENTATION:
+
+// Unmap microbenchmark: cost per page of unmapping scattered pages one
+// by one (a TLB flush per operation) and as one batch (a single ranged
+// flush), and the number of flush ranges the batch ends up with.
+//
+// Only the [UTEST] lines are compared against the verify file; the
+// cycle counts are informational.
+
+class Test_space : public Space
+{
+public:
+  Test_space(Ram_quota *rq, char const *name)
+  : Space(rq, Caps::all()), name(name)
+  {
+    initialize();
+  }
+
+  void* operator new (size_t s)
+  { return malloc (s); }
+
+  void operator delete (void *p)
+  { ::free (p); }
+
+  char const *const name;
+};
+
+class Sigma0_space : public Test_space
+{
+public:
+  explicit Sigma0_space(Ram_quota *q) : Test_space(q, "s0") {}
+  bool is_sigma0() const { return true; }
+};
+
+PUBLIC
+bool
+Sigma0_space::v_fabricate(Mem_space::Vaddr address,
+                          Mem_space::Phys_addr *phys, Mem_space::Page_order *size,
+                          Mem_space::Attr *attribs = 0)
+{
+  *size = static_cast<Mem_space const &>(*this).largest_page_size();
+  *phys = cxx::mask_lsb(Virt_addr(address), *size);
+
+  if (attribs)
+    *attribs = Mem_space::Attr(L4_fpage::Rights::URWX());
+
+  return true;
+}
+
+PUBLIC inline
+Page_number
+Sigma0_space::mem_space_map_max_address() const
+{ return Page_number(1UL << (MWORD_BITS - Mem_space::Page_shift)); }
+
+class Timeout;
+
+DEFINE_PER_CPU Per_cpu<Timeout *> timeslice_timeout;
+STATIC_INITIALIZER_P(init, STARTUP_INIT_PRIO);
+STATIC_INITIALIZER_P(init2, POST_CPU_LOCAL_INIT_PRIO);
+
+static void init()
+{
+  Usermode::init(Cpu_number::boot_cpu());
+  Boot_info::init();
+  Kip_init::init();
+  Kmem_alloc::base_init();
+  Kmem_alloc::init();
+
+  // Initialize cpu-local data management and run constructors for CPU 0
+  Per_cpu_data::init_ctors();
+  Per_cpu_data_alloc::alloc(Cpu_number::boot_cpu());
+  Per_cpu_data::run_ctors(Cpu_number::boot_cpu());
+
+  Mem_space::init_page_sizes();
+}
+
+static void init2()
+{
+  Cpu::init_global_features();
+  Config::init();
+  Kmem::init_mmu(*Cpu::boot_cpu());
+  Pic::init();
+}
+
+class Fake_factory : public Ram_quota
+{
+};
+
+static Fake_factory rq;
+static Space *sigma0;
+static Test_space *server;
+static Test_space *client;
+
+enum { Rounds = 100 };
+
+/// Address of the i-th page, spread over the address space with a
+/// stride so that no two pages are adjacent.
+static Address
+page_addr(unsigned i)
+{ return 0x400000 + i * 5 * Config::PAGE_SIZE; }
+
+static L4_fpage
+page(unsigned i)
+{ return L4_fpage::mem(page_addr(i), Config::PAGE_SHIFT, L4_fpage::Rights::URWX()); }
+
+/// Map n pages from sigma0 to the server and on to the client.
+static void
+map_pages(unsigned n)
+{
+  Reap_list reap;
+  for (unsigned i = 0; i < n; ++i)
+    {
+      fpage_map(sigma0, page(i), server, L4_fpage::all_spaces(),
+                L4_msg_item(page_addr(i)), &reap);
+      fpage_map(server, page(i), client, L4_fpage::all_spaces(),
+                L4_msg_item(page_addr(i)), &reap);
+    }
+}
+
+/// Check that a batched unmap records the byte range of the unmapped page
+/// in both the server and the client.
+static void
+check_ranges()
+{
+  Reap_list reap;
+  map_pages(4);
+
+  Tlb_flush_batch batch;
+  fpage_unmap(server, page(3), L4_map_mask::full(), reap.list(), &batch);
+
+  cout << "[UTEST] batch ranges: " << setbase(10) << batch.ranges()
+       << (batch.all() ? " (all)" : "") << endl;
+  for (unsigned i = 0; i < batch.ranges(); ++i)
+    {
+      Mem_space::Tlb_range const &r = batch.range(i);
+      Space *s = static_cast<Space *>(r.space);
+      cout << "[UTEST]   " << static_cast<Test_space *>(s)->name
+           << setbase(16) << ": " << r.start << "-" << r.end
+           << (r.start == page_addr(3)
+               && r.end == page_addr(3) + Config::PAGE_SIZE ? " ok" : " BAD")
+           << endl;
+    }
+  batch.flush();
+
+  for (unsigned i = 0; i < 3; ++i)
+    fpage_unmap(server, page(i), L4_map_mask::full(), reap.list());
+}
+
+static void
+bench_unmap(unsigned n)
+{
+  Reap_list reap;
+  Unsigned64 t, single = 0, batched = 0;
+  unsigned ranges = 0, fallback = 0;
+
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      map_pages(n);
+      t = Cpu::rdtsc();
+      for (unsigned i = 0; i < n; ++i)
+        fpage_unmap(server, page(i), L4_map_mask::full(), reap.list());
+      single += Cpu::rdtsc() - t;
+
+      map_pages(n);
+      t = Cpu::rdtsc();
+      Tlb_flush_batch batch;
+      for (unsigned i = 0; i < n; ++i)
+        fpage_unmap(server, page(i), L4_map_mask::full(), reap.list(), &batch);
+      ranges += batch.ranges();
+      fallback += batch.all();
+      batch.flush();
+      batched += Cpu::rdtsc() - t;
+    }
+
+  cout << "[UTEST] unmap " << setbase(10) << n << " pages" << endl;
+  cout << "  single: " << single / (Rounds * n) << " cycles/page"
+       << "  batched: " << batched / (Rounds * n) << " cycles/page"
+       << "  ranges: " << ranges / Rounds
+       << "  full flushes: " << fallback << endl;
+}
+
+int main()
+{
+  static unsigned const sizes[] = { 1, 4, 16, 64, 256 };
+
+  sigma0 = new Sigma0_space(&rq);
+  init_mapdb_mem(sigma0);
+  server = new Test_space(&rq, "server");
+  client = new Test_space(&rq, "client");
+
+  check_ranges();
+
+  cout << "[UTEST] Unmap benchmark" << endl;
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    bench_unmap(sizes[i]);
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
@@ -0,0 +1,226 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+#include "mapdb.h"
+
+IMPLEMENTATION:
+
+#include "config.h"
+#include "cpu.h"
+#include "mapping_tree.h"
+#include "space.h"
+
+// Mapdb microbenchmark: cost of lookup, tree-header resolution and
+// unmap as a function of the number of mappings in a mapping tree.
+//
+// Only the [UTEST] lines are compared against the verify file; the
+// cycle counts are informational.
+
+static Space *s0;
+static Space *other;
+
+static size_t page_sizes[] =
+{ Config::SUPERPAGE_SHIFT - Config::PAGE_SHIFT, 0 };
+
+static size_t page_sizes_max = 2;
+
+enum { Rounds = 1000 };
+
+class Fake_factory : public Ram_quota
+{
+};
+
+class Fake_task : public Space
+{
+public:
+  Fake_task(Ram_quota *r, char const *name)
+  : Space(r, Caps::all()), name(name) {}
+
+  char const *name;
+};
+
+static void init_spaces()
+{
+  static Fake_factory rq;
+  s0 = new Fake_task(&rq, "s0");
+  other = new Fake_task(&rq, "other");
+}
+
+static
+Mapdb::Pfn to_pfn(Address a)
+{ return Mem_space::to_pfn(Mem_space::V_pfn(Virt_addr(a))); }
+
+static
+Mapdb::Pcnt to_pcnt(unsigned order)
+{ return Mem_space::to_pcnt(Mem_space::Page_order(order)); }
+
+static Mapdb::Pfn
+child_va(unsigned i)
+{ return to_pfn(Config::SUPERPAGE_SIZE + i * Config::PAGE_SIZE); }
+
+/** Fill the mapping tree of physical page 0 with n children of
+    the Sigma0 mapping. */
+static void
+fill_tree(Mapdb *m, unsigned n)
+{
+  for (unsigned i = 0; i < n; ++i)
+    {
+      Mapping *node;
+      Mapdb::Frame frame;
+      bool found = m->lookup(s0, to_pfn(0), to_pfn(0), &node, &frame);
+      assert (found);
+      (void)found;
+      Mapping *sub = m->insert(frame, node, other, child_va(i), to_pfn(0),
+                               to_pcnt(Config::PAGE_SHIFT));
+      assert (sub);
+      (void)sub;
+      m->free(frame);
+    }
+}
+
+static void
+bench_tree(unsigned n)
+{
+  Mapdb m (s0, Mapping::Page(1U << (32 - Config::PAGE_SHIFT - page_sizes[0])),
+           page_sizes, page_sizes_max);
+
+  fill_tree(&m, n);
+
+  Mapping *node;
+  Mapdb::Frame frame;
+  Unsigned64 t, lookup = 0, head = 0, unmap = 0;
+
+  // Lookup of the last mapping in the tree.
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      t = Cpu::rdtsc();
+      bool found = m.lookup(other, child_va(n - 1), to_pfn(0), &node, &frame);
+      lookup += Cpu::rdtsc() - t;
+      assert (found);
+      (void)found;
+
+      t = Cpu::rdtsc();
+      Mapping_tree *h = Mapping_tree::head_of(node);
+      head += Cpu::rdtsc() - t;
+      assert (h->mappings()->depth() == Mapping::Depth_root);
+      (void)h;
+
+      m.free(frame);
+    }
+
+  // Unmap and re-establish the last mapping in the tree.
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      t = Cpu::rdtsc();
+      bool found = m.lookup(other, child_va(n - 1), to_pfn(0), &node, &frame);
+      assert (found);
+      (void)found;
+      Mapdb::flush(frame, node, L4_map_mask::full(), child_va(n - 1),
+                   child_va(n));
+      m.free(frame);
+      unmap += Cpu::rdtsc() - t;
+
+      found = m.lookup(s0, to_pfn(0), to_pfn(0), &node, &frame);
+      assert (found);
+      Mapping *sub = m.insert(frame, node, other, child_va(n - 1), to_pfn(0),
+                              to_pcnt(Config::PAGE_SHIFT));
+      assert (sub);
+      (void)sub;
+      m.free(frame);
+    }
+
+  cout << "[UTEST] tree size " << setbase(10) << n << endl;
+  cout << "  lookup: " << lookup / Rounds << " cycles"
+       << "  head_of: " << head / Rounds << " cycles"
+       << "  unmap: " << unmap / Rounds << " cycles" << endl;
+}
+
+/** head_of() must follow saturated hints.  Mapping trees hold at most
+    2048 entries, so use a plain array to also cover offsets beyond the
+    widest hint (12 bits) of any architecture. */
+static void
+check_saturation()
+{
+  enum { Nr_entries = 6000 };
+  static Mapping a[Nr_entries];
+  Mapping_tree *head = reinterpret_cast<Mapping_tree *>
+    (reinterpret_cast<char *>(a) - sizeof(Mapping_tree));
+  unsigned bad = 0;
+
+  a[0].set_depth(Mapping::Depth_root);
+  a[0].set_tree_offs(0);
+  for (unsigned i = 1; i < Nr_entries; ++i)
+    {
+      a[i].set_depth(1);
+      a[i].set_tree_offs(i);
+      if (a[i].tree_offs() != (i < Mapping::Tree_offs_max
+                               ? i : (unsigned)Mapping::Tree_offs_max))
+        ++bad;
+    }
+
+  for (unsigned i = 0; i < Nr_entries; ++i)
+    if (Mapping_tree::head_of(&a[i]) != head)
+      ++bad;
+
+  cout << "[UTEST] head_of with saturated hints: "
+       << (bad ? "FAILED" : "ok") << endl;
+}
+
+#include "boot_info.h"
+#include "cpu.h"
+#include "config.h"
+#include "kip_init.h"
+#include "kmem.h"
+#include "kmem_alloc.h"
+#include "per_cpu_data_alloc.h"
+#include "static_init.h"
+#include "usermode.h"
+
+class Timeout;
+
+DEFINE_PER_CPU Per_cpu<Timeout *> timeslice_timeout;
+STATIC_INITIALIZER_P(init, STARTUP_INIT_PRIO);
+STATIC_INITIALIZER_P(init2, POST_CPU_LOCAL_INIT_PRIO);
+
+static void init()
+{
+  Usermode::init(Cpu_number::boot_cpu());
+  Boot_info::init();
+  Kip_init::init();
+  Kmem_alloc::base_init();
+  Kmem_alloc::init();
+
+  // Initialize cpu-local data management and run constructors for CPU 0
+  Per_cpu_data::init_ctors();
+  Per_cpu_data_alloc::alloc(Cpu_number::boot_cpu());
+  Per_cpu_data::run_ctors(Cpu_number::boot_cpu());
+
+}
+
+static void init2()
+{
+  Cpu::init_global_features();
+  Config::init();
+  Kmem::init_mmu(Cpu::cpus.cpu(Cpu_number::boot_cpu()));
+}
+
+int main()
+{
+  static unsigned const sizes[] = { 4, 16, 64, 256, 1024, 2000 };
+
+  init_spaces();
+  check_saturation();
+  cout << "[UTEST] Mapdb benchmark" << endl;
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    bench_tree(sizes[i]);
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
@@ -0,0 +1,183 @@
+/*
+ * Mapping database stress test.
+ *
+ * Runs as root task.  Obtains one superpage from sigma0 and lets one
+ * worker thread per CPU map 4K pages of it into a child task and unmap
+ * them again.  All these mappings are children of the same superpage
+ * mapping, but each worker uses its own pages, i.e., its own subframes
+ * of the superpage.  The test reports the map/unmap throughput for 1, 2,
+ * 4, ... CPUs, which shows how well operations on disjoint subframes of
+ * one superpage scale.
+ */
+
+#include <l4/sigma0/sigma0.h>
+#include <l4/sys/consts.h>
+#include <l4/sys/factory.h>
+#include <l4/sys/scheduler.h>
+#include <l4/sys/task.h>
+#include <l4/sys/thread.h>
+#include <l4/sys/utcb.h>
+#include <l4/util/rdtsc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+  Rounds         = 2000,
+  Max_cpus       = 32,
+  Pages_per_cpu  = 8,
+  Child_cap      = 0x20 << L4_CAP_SHIFT,
+  Worker_cap     = 0x40 << L4_CAP_SHIFT, /* one per worker */
+  Area           = 0x40000000,           /* superpage from sigma0 */
+  Child_area     = 0x10000000,
+};
+
+static char stacks[Max_cpus][8 << 10] __attribute__((aligned(16)));
+
+static volatile unsigned generation;
+static volatile unsigned active;
+static volatile unsigned done;
+static unsigned long errors;
+
+static void
+map_unmap(unsigned worker)
+{
+  l4_utcb_t *u = l4_utcb();
+  unsigned i;
+
+  for (i = 0; i < Rounds; ++i)
+    {
+      l4_addr_t offs = (worker * Pages_per_cpu + i % Pages_per_cpu)
+                       * L4_PAGESIZE;
+
+      if (l4_error(l4_task_map_u(Child_cap, L4_BASE_TASK_CAP,
+                                 l4_fpage(Area + offs, L4_PAGESHIFT,
+                                          L4_FPAGE_RW),
+                                 l4_map_control(Child_area + offs, 0,
+                                                L4_MAP_ITEM_MAP), u)))
+        __atomic_add_fetch(&errors, 1, __ATOMIC_RELAXED);
+
+      l4_task_unmap_u(Child_cap,
+                      l4_fpage(Child_area + offs, L4_PAGESHIFT,
+                               L4_FPAGE_RWX),
+                      L4_FP_ALL_SPACES, u);
+    }
+}
+
+static l4_utcb_t *main_utcb;
+
+static void
+worker(void)
+{
+  unsigned id = ((char *)l4_utcb() - (char *)main_utcb) / L4_UTCB_OFFSET;
+  unsigned seen = 0;
+
+  for (;;)
+    {
+      while (generation == seen)
+        ;
+      seen = generation;
+
+      if (id < active)
+        {
+          map_unmap(id);
+          __atomic_add_fetch(&done, 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+static int
+run_on(l4_cap_idx_t thread, unsigned cpu)
+{
+  l4_sched_param_t sp = l4_sched_param(2, 0);
+  sp.affinity = l4_sched_cpu_set(cpu, 0, 1);
+  return l4_error(l4_scheduler_run_thread(L4_BASE_SCHEDULER_CAP, thread, &sp));
+}
+
+static int
+start_worker(unsigned id)
+{
+  l4_cap_idx_t cap = Worker_cap + (id << L4_CAP_SHIFT);
+  l4_utcb_t *u = (l4_utcb_t *)((char *)main_utcb + id * L4_UTCB_OFFSET);
+
+  if (l4_error(l4_factory_create_thread(L4_BASE_FACTORY_CAP, cap)))
+    return -1;
+
+  l4_thread_control_start();
+  l4_thread_control_pager(L4_BASE_PAGER_CAP);
+  l4_thread_control_exc_handler(L4_BASE_PAGER_CAP);
+  l4_thread_control_bind(u, L4_BASE_TASK_CAP);
+  if (l4_error(l4_thread_control_commit(cap)))
+    return -1;
+
+  if (l4_error(l4_thread_ex_regs(cap, (l4_umword_t)worker,
+                                 (l4_umword_t)(stacks[id]
+                                               + sizeof(stacks[id])), 0)))
+    return -1;
+
+  return run_on(cap, id);
+}
+
+int
+main(void)
+{
+  l4_umword_t cpu_max;
+  l4_sched_cpu_set_t cpus = l4_sched_cpu_set(0, 0, 1);
+  l4_addr_t phys;
+  unsigned n, cpu;
+
+  if (l4_error(l4_scheduler_info(L4_BASE_SCHEDULER_CAP, &cpu_max, &cpus)))
+    cpu_max = 1;
+  if (cpu_max > Max_cpus)
+    cpu_max = Max_cpus;
+
+  if (l4sigma0_map_anypage(L4_BASE_PAGER_CAP, Area, L4_SUPERPAGESHIFT,
+                           &phys, L4_SUPERPAGESHIFT)
+      || l4_error(l4_factory_create_task(L4_BASE_FACTORY_CAP, Child_cap,
+                                         l4_fpage_invalid())))
+    {
+      printf("mapdb_stress: cannot set up superpage and child task\n");
+      exit(1);
+    }
+
+  /* the main thread is worker 0, workers find their id from the UTCB */
+  main_utcb = l4_utcb();
+  run_on(L4_BASE_THREAD_CAP, 0);
+  for (cpu = 1; cpu < cpu_max; ++cpu)
+    if (start_worker(cpu))
+      break;
+  cpu_max = cpu;
+
+  printf("mapdb map/unmap of 4K pages of one superpage, %d rounds per CPU:\n",
+         Rounds);
+  for (n = 1;; n *= 2)
+    {
+      l4_cpu_time_t start, end;
+
+      if (n > cpu_max)
+        n = cpu_max;
+
+      done = 0;
+      active = n;
+      start = l4_rdtsc();
+      __atomic_add_fetch(&generation, 1, __ATOMIC_RELEASE);
+
+      map_unmap(0);
+      while (__atomic_load_n(&done, __ATOMIC_ACQUIRE) != n - 1)
+        ;
+      end = l4_rdtsc();
+
+      printf("  %2u CPUs: %llu cycles per map/unmap, %llu map/unmaps per Mcycle\n",
+             n, (unsigned long long)(end - start) / Rounds,
+             (unsigned long long)n * Rounds * 1000000 / (end - start));
+
+      if (n == cpu_max)
+        break;
+    }
+
+  if (errors)
+    printf("  %lu map operations failed\n", errors);
+
+  exit(0);
+}
@@ -0,0 +1,288 @@
+/*
+ * Host-side benchmark of the kernel's minilibc mem* and str* routines.
+ *
+ * Compares the byte loops the minilibc used to have, the generic
+ * word-at-a-time routines (gen_*, lib/minilibc), the rep movs/stos
+ * routines of the architecture (arch_*, lib/minilibc/<arch>) and the
+ * host libc across sizes and alignments, after checking all minilibc
+ * routines against the byte loops.  Prints MB/s, higher is better.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void *gen_memcpy(void *, const void *, size_t);
+void *gen_memset(void *, int, size_t);
+void *gen_memmove(void *, const void *, size_t);
+int gen_memcmp(const void *, const void *, size_t);
+size_t gen_strlen(const char *);
+void *arch_memcpy(void *, const void *, size_t);
+void *arch_memset(void *, int, size_t);
+
+enum { Buf_size = 1 << 20, Total = 64 << 20 };
+
+static unsigned char *buf_a, *buf_b, *buf_c;
+
+/* the former minilibc routines */
+
+static void *
+byte_memcpy(void *dst, const void *src, size_t n)
+{
+  char *d = dst;
+  const char *s = src;
+  while (n--)
+    *d++ = *s++;
+  return dst;
+}
+
+static void *
+byte_memset(void *dst, int c, size_t n)
+{
+  char *d = dst;
+  while (n--)
+    *d++ = c;
+  return dst;
+}
+
+static void *
+byte_memmove(void *dst, const void *src, size_t n)
+{
+  char *a = dst;
+  const char *b = src;
+  if (b > a)
+    while (n--)
+      *a++ = *b++;
+  else
+    while (n--)
+      a[n] = b[n];
+  return dst;
+}
+
+static int
+byte_memcmp(const void *a, const void *b, size_t n)
+{
+  const unsigned char *x = a, *y = b;
+  for (; n--; ++x, ++y)
+    if (*x != *y)
+      return *x - *y;
+  return 0;
+}
+
+static size_t
+byte_strlen(const char *s)
+{
+  size_t i = 0;
+  while (s[i])
+    ++i;
+  return i;
+}
+
+static int
+sign(int x)
+{ return (x > 0) - (x < 0); }
+
+static unsigned long failures;
+
+static void
+fail(char const *what, size_t n, unsigned da, unsigned sa)
+{
+  if (failures++ < 10)
+    printf("FAIL: %s size=%zu dst+%u src+%u\n", what, n, da, sa);
+}
+
+static void
+fill(unsigned char *p, size_t n, unsigned seed)
+{
+  size_t i;
+  for (i = 0; i < n; ++i)
+    p[i] = (unsigned char)(i * 7 + seed) | 1;
+}
+
+static void
+check(void)
+{
+  size_t n;
+  unsigned da, sa, i;
+
+  for (n = 0; n < 200; ++n)
+    for (da = 0; da < 8; ++da)
+      for (sa = 0; sa < 8; ++sa)
+        {
+          unsigned char *d = buf_a + 64 + da, *s = buf_b + 64 + sa;
+
+          fill(buf_b, 512, n);
+          fill(buf_a, 512, 3);
+          fill(buf_c, 512, 3);
+          byte_memcpy(buf_c + 64 + da, s, n);
+          gen_memcpy(d, s, n);
+          if (memcmp(buf_a, buf_c, 512))
+            fail("memcpy", n, da, sa);
+          fill(buf_a, 512, 3);
+          arch_memcpy(d, s, n);
+          if (memcmp(buf_a, buf_c, 512))
+            fail("arch memcpy", n, da, sa);
+
+          fill(buf_c, 512, 3);
+          byte_memset(buf_c + 64 + da, 0x80 + sa, n);
+          fill(buf_a, 512, 3);
+          gen_memset(d, 0x80 + sa, n);
+          if (memcmp(buf_a, buf_c, 512))
+            fail("memset", n, da, sa);
+          fill(buf_a, 512, 3);
+          arch_memset(d, 0x80 + sa, n);
+          if (memcmp(buf_a, buf_c, 512))
+            fail("arch memset", n, da, sa);
+
+          /* overlapping both ways within one buffer */
+          fill(buf_a, 512, 5);
+          fill(buf_c, 512, 5);
+          byte_memmove(buf_c + 64 + da, buf_c + 64 + sa * 5, n);
+          gen_memmove(buf_a + 64 + da, buf_a + 64 + sa * 5, n);
+          if (memcmp(buf_a, buf_c, 512))
+            fail("memmove", n, da, sa);
+
+          fill(buf_a, 512, n);
+          memcpy(d, s, n);
+          if (n)
+            d[(n * 5) / 7] ^= 0x80 >> (sa % 8);
+          if (sign(gen_memcmp(d, s, n)) != sign(byte_memcmp(d, s, n)))
+            fail("memcmp", n, da, sa);
+
+          memset(s, 'x', n);
+          s[n] = 0;
+          if (gen_strlen((char *)s) != n)
+            fail("strlen", n, da, sa);
+        }
+
+  /* strlen with a zero byte in each position of a word */
+  for (i = 0; i < 64; ++i)
+    {
+      memset(buf_a, 'x', 128);
+      buf_a[i] = 0;
+      if (gen_strlen((char *)buf_a) != i)
+        fail("strlen zero", i, 0, 0);
+      buf_a[i] = 0x80;
+      buf_a[i + 1] = 0;
+      if (gen_strlen((char *)buf_a) != i + 1)
+        fail("strlen 0x80", i, 0, 0);
+    }
+}
+
+static double
+now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+enum Op { Cpy, Set, Move, Cmp, Len };
+
+typedef struct
+{
+  char const *name;
+  enum Op op;
+  void *fn;
+} Variant;
+
+/* keep the compiler from optimizing the calls away */
+static volatile size_t sink;
+
+static double
+run(Variant const *v, size_t n, unsigned da, unsigned sa)
+{
+  unsigned char *d = buf_a + da, *s = buf_b + sa;
+  unsigned long i, rounds = Total / (n + 16);
+  double t;
+
+  memset(s, 'x', n);
+  s[n] = 0;
+  memcpy(d, s, n + 1);
+
+  t = now();
+  for (i = 0; i < rounds; ++i)
+    switch (v->op)
+      {
+      case Cpy:
+        ((void *(*)(void *, const void *, size_t))v->fn)(d, s, n);
+        break;
+      case Set:
+        ((void *(*)(void *, int, size_t))v->fn)(d, i, n);
+        break;
+      case Move:
+        ((void *(*)(void *, const void *, size_t))v->fn)(d, d + 16, n);
+        break;
+      case Cmp:
+        sink += ((int (*)(const void *, const void *, size_t))v->fn)(d, s, n);
+        break;
+      case Len:
+        sink += ((size_t (*)(const char *))v->fn)((char *)s);
+        break;
+      }
+  t = now() - t;
+
+  return rounds * (double)n / t / 1e6;
+}
+
+int
+main(void)
+{
+  static Variant const variants[] =
+  {
+    { "memcpy  byte", Cpy,  byte_memcpy },
+    { "memcpy  word", Cpy,  gen_memcpy },
+    { "memcpy  rep",  Cpy,  arch_memcpy },
+    { "memcpy  libc", Cpy,  memcpy },
+    { "memset  byte", Set,  byte_memset },
+    { "memset  word", Set,  gen_memset },
+    { "memset  rep",  Set,  arch_memset },
+    { "memset  libc", Set,  memset },
+    { "memmove byte", Move, byte_memmove },
+    { "memmove word", Move, gen_memmove },
+    { "memmove libc", Move, memmove },
+    { "memcmp  byte", Cmp,  byte_memcmp },
+    { "memcmp  word", Cmp,  gen_memcmp },
+    { "memcmp  libc", Cmp,  memcmp },
+    { "strlen  byte", Len,  byte_strlen },
+    { "strlen  word", Len,  gen_strlen },
+    { "strlen  libc", Len,  strlen },
+  };
+  static size_t const sizes[] = { 16, 64, 256, 1500, 4096, 65536 };
+  static unsigned const align[][2] = { { 0, 0 }, { 3, 3 }, { 0, 5 } };
+  unsigned v, s, a;
+
+  buf_a = aligned_alloc(4096, Buf_size);
+  buf_b = aligned_alloc(4096, Buf_size);
+  buf_c = aligned_alloc(4096, Buf_size);
+  if (!buf_a || !buf_b || !buf_c)
+    return 1;
+
+  check();
+  if (failures)
+    {
+      printf("%lu checks failed\n", failures);
+      return 1;
+    }
+
+  printf("MB/s                  ");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    printf(" %8zu", sizes[s]);
+  printf("\n");
+
+  for (a = 0; a < sizeof(align) / sizeof(align[0]); ++a)
+    {
+      printf("dst+%u src+%u:\n", align[a][0], align[a][1]);
+      for (v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v)
+        {
+          printf("  %-20s", variants[v].name);
+          for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            printf(" %8.0f", run(&variants[v], sizes[s],
+                                 align[a][0], align[a][1]));
+          printf("\n");
+        }
+    }
+
+  return 0;
+}
@@ -1,14 +1,175 @@
+/*
+ * Cross-CPU IPC round-trip benchmark.
+ *
+ * Runs as root task.  The main thread is pinned to CPU 0 and calls a
+ * server thread pinned to CPU 1.  Each round trip is measured without
+ * items, with a capability map item and with a memory map item, so the
+ * cost of the item transfer path of cross-CPU IPC can be compared with
+ * plain short IPC.
+ */
+
+#include <l4/sys/consts.h>
+#include <l4/sys/factory.h>
 #include <l4/sys/ipc.h>
-#include <l4/sys/syscalls.h>
-#include <l4/sys/kdebug.h>
+#include <l4/sys/scheduler.h>
+#include <l4/sys/thread.h>
+#include <l4/sys/utcb.h>
+#include <l4/util/rdtsc.h>
 
-/* #include <l4/rmgr/librmgr.h> */
-/* #include <l4/util/rdtsc.h> */
 #include <stdio.h>
+#include <stdlib.h>
 
-int main(int argc, char **argv) 
+enum
 {
-  printf("testing short ipc with small address spaces:\n");
-  exit(0);
+  Rounds     = 10000,
+  Server_cap = 0x20 << L4_CAP_SHIFT,
+  Rcv_cap    = 0x21 << L4_CAP_SHIFT,
+  Client_cpu = 0,
+  Server_cpu = 1,
+};
+
+enum Mode { Plain, Obj_item, Mem_item, Num_modes };
+
+static char const *const mode_name[Num_modes] =
+{ "no items", "cap item", "mem item" };
+
+static char server_stack[8 << 10] __attribute__((aligned(16)));
+static char snd_page[L4_PAGESIZE] __attribute__((aligned(L4_PAGESIZE)));
+static char rcv_page[L4_PAGESIZE] __attribute__((aligned(L4_PAGESIZE)));
+
+/* Offer a memory and a capability receive buffer for the next message. */
+static void
+setup_rcv_buffers(l4_utcb_t *u)
+{
+  l4_buf_regs_t *br = l4_utcb_br_u(u);
+  br->bdr   = (0 << L4_BDR_MEM_SHIFT) | (2 << L4_BDR_OBJ_SHIFT);
+  br->br[0] = L4_ITEM_MAP;
+  br->br[1] = l4_fpage((l4_addr_t)rcv_page, L4_PAGESHIFT, L4_FPAGE_RWX).raw;
+  br->br[2] = Rcv_cap | L4_RCV_ITEM_SINGLE_CAP;
 }
 
+static void
+server(void)
+{
+  l4_utcb_t *u = l4_utcb();
+  l4_umword_t label;
+  l4_msgtag_t tag;
+
+  setup_rcv_buffers(u);
+  tag = l4_ipc_wait(u, &label, L4_IPC_NEVER);
+  for (;;)
+    {
+      if (l4_ipc_error(tag, u))
+        {
+          setup_rcv_buffers(u);
+          tag = l4_ipc_wait(u, &label, L4_IPC_NEVER);
+          continue;
+        }
+
+      setup_rcv_buffers(u);
+      tag = l4_ipc_reply_and_wait(u, l4_msgtag(0, 0, 0, 0), &label,
+                                  L4_IPC_NEVER);
+    }
+}
+
+static int
+run_on(l4_cap_idx_t thread, unsigned cpu)
+{
+  l4_sched_param_t sp = l4_sched_param(2, 0);
+  sp.affinity = l4_sched_cpu_set(cpu, 0, 1);
+  return l4_error(l4_scheduler_run_thread(L4_BASE_SCHEDULER_CAP, thread, &sp));
+}
+
+static int
+start_server(void)
+{
+  l4_utcb_t *u = (l4_utcb_t *)((char *)l4_utcb() + L4_UTCB_OFFSET);
+
+  if (l4_error(l4_factory_create_thread(L4_BASE_FACTORY_CAP, Server_cap)))
+    return -1;
+
+  l4_thread_control_start();
+  l4_thread_control_pager(L4_BASE_PAGER_CAP);
+  l4_thread_control_exc_handler(L4_BASE_PAGER_CAP);
+  l4_thread_control_bind(u, L4_BASE_TASK_CAP);
+  if (l4_error(l4_thread_control_commit(Server_cap)))
+    return -1;
+
+  if (l4_error(l4_thread_ex_regs(Server_cap, (l4_umword_t)server,
+                                 (l4_umword_t)(server_stack
+                                               + sizeof(server_stack)), 0)))
+    return -1;
+
+  return run_on(Server_cap, Server_cpu);
+}
+
+static l4_msgtag_t
+call(enum Mode m, l4_utcb_t *u)
+{
+  l4_msg_regs_t *mr = l4_utcb_mr_u(u);
+
+  switch (m)
+    {
+    case Obj_item:
+      mr->mr[0] = l4_map_obj_control(0, 0);
+      mr->mr[1] = l4_obj_fpage(L4_BASE_FACTORY_CAP, 0, L4_FPAGE_RWX).raw;
+      return l4_ipc_call(Server_cap, u, l4_msgtag(0, 0, 1, 0), L4_IPC_NEVER);
+
+    case Mem_item:
+      mr->mr[0] = l4_map_control((l4_addr_t)snd_page, 0, 0);
+      mr->mr[1] = l4_fpage((l4_addr_t)snd_page, L4_PAGESHIFT,
+                           L4_FPAGE_RWX).raw;
+      return l4_ipc_call(Server_cap, u, l4_msgtag(0, 0, 1, 0), L4_IPC_NEVER);
+
+    default:
+      mr->mr[0] = 0;
+      return l4_ipc_call(Server_cap, u, l4_msgtag(0, 1, 0, 0), L4_IPC_NEVER);
+    }
+}
+
+static void
+bench(enum Mode m)
+{
+  l4_utcb_t *u = l4_utcb();
+  l4_cpu_time_t start, end;
+  unsigned i;
+
+  /* warm up caches and establish the first mapping */
+  for (i = 0; i < 100; ++i)
+    if (l4_ipc_error(call(m, u), u))
+      {
+        printf("  %-9s: IPC error %lx\n", mode_name[m],
+               l4_utcb_tcr_u(u)->error);
+        return;
+      }
+
+  start = l4_rdtsc();
+  for (i = 0; i < Rounds; ++i)
+    call(m, u);
+  end = l4_rdtsc();
+
+  printf("  %-9s: %llu cycles per round trip\n", mode_name[m],
+         (unsigned long long)(end - start) / Rounds);
+}
+
+int
+main(void)
+{
+  int m;
+
+  snd_page[0] = 1;
+
+  if (run_on(L4_BASE_THREAD_CAP, Client_cpu) || start_server())
+    {
+      printf("pingpong: cannot set up threads on CPU %d and %d\n",
+             Client_cpu, Server_cpu);
+      exit(1);
+    }
+
+  printf("cross-CPU IPC, CPU %d -> CPU %d, %d rounds:\n",
+         Client_cpu, Server_cpu, Rounds);
+  for (m = 0; m < Num_modes; ++m)
+    bench((enum Mode)m);
+
+  exit(0);
+}
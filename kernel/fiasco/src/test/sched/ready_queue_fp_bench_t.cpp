@@ -0,0 +1,158 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+#include "ready_queue_fp.h"
+
+IMPLEMENTATION:
+
+#include "cpu.h"
+#include "cpu_lock.h"
+#include "lock_guard.h"
+
+// Ready queue benchmark: cost of a block/wakeup pair (dequeue, pick the
+// next context to run, enqueue) for different priority layouts.
+//
+// Only the [UTEST] lines are compared against the verify file; the
+// cycle counts are informational.
+
+class Bench_sc : public cxx::D_list_item
+{
+public:
+  typedef cxx::Sd_list<Bench_sc> Fp_list;
+
+  unsigned short prio() const { return _prio; }
+  bool in_ready_list() const { return Fp_list::in_list(this); }
+
+  unsigned short _prio;
+};
+
+enum { Nr_scs = 64, Rounds = 100000 };
+
+static Bench_sc scs[Nr_scs];
+static unsigned queued[256];
+
+static Unsigned64 rnd_state = 42;
+
+static unsigned
+rnd()
+{
+  rnd_state = rnd_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rnd_state >> 33;
+}
+
+static unsigned
+highest_queued()
+{
+  for (unsigned p = 255; p > 0; --p)
+    if (queued[p])
+      return p;
+  return 0;
+}
+
+static void
+bench_layout(char const *name, unsigned short (*prio)(unsigned))
+{
+  static Ready_queue_fp<Bench_sc> rq;
+  Unsigned64 t, pairs = 0;
+
+  auto guard = lock_guard(cpu_lock);
+
+  for (unsigned i = 0; i < Nr_scs; ++i)
+    {
+      scs[i]._prio = prio(i);
+      ++queued[scs[i]._prio];
+      rq.enqueue(&scs[i], false);
+    }
+
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      Bench_sc *sc = &scs[rnd() % Nr_scs];
+
+      t = Cpu::rdtsc();
+      rq.dequeue(sc);
+      Bench_sc *next = rq.next_to_run();
+      rq.enqueue(sc, false);
+      pairs += Cpu::rdtsc() - t;
+
+      if ((r & 63) == 0)
+        {
+          --queued[sc->_prio];
+          assert (next);
+          assert (next->prio() == highest_queued());
+          ++queued[sc->_prio];
+        }
+      (void)next;
+    }
+
+  for (unsigned i = 0; i < Nr_scs; ++i)
+    {
+      rq.dequeue(&scs[i]);
+      --queued[scs[i]._prio];
+    }
+  assert (!rq.next_to_run());
+
+  cout << "[UTEST] layout " << name << endl;
+  cout << "  block/wakeup: " << setbase(10) << pairs / Rounds << " cycles"
+       << endl;
+}
+
+static unsigned short prio_single(unsigned)  { return 100; }
+static unsigned short prio_sparse(unsigned i)
+{
+  static unsigned short const p[] = { 2, 40, 120, 250 };
+  return p[i % 4];
+}
+static unsigned short prio_dense(unsigned i) { return 192 + i; }
+static unsigned short prio_random(unsigned)  { return rnd() % 256; }
+
+#include "boot_info.h"
+#include "config.h"
+#include "kip_init.h"
+#include "kmem.h"
+#include "kmem_alloc.h"
+#include "per_cpu_data_alloc.h"
+#include "static_init.h"
+#include "usermode.h"
+
+STATIC_INITIALIZER_P(init, STARTUP_INIT_PRIO);
+STATIC_INITIALIZER_P(init2, POST_CPU_LOCAL_INIT_PRIO);
+
+static void init()
+{
+  Usermode::init(Cpu_number::boot_cpu());
+  Boot_info::init();
+  Kip_init::init();
+  Kmem_alloc::base_init();
+  Kmem_alloc::init();
+
+  // Initialize cpu-local data management and run constructors for CPU 0
+  Per_cpu_data::init_ctors();
+  Per_cpu_data_alloc::alloc(Cpu_number::boot_cpu());
+  Per_cpu_data::run_ctors(Cpu_number::boot_cpu());
+}
+
+static void init2()
+{
+  Cpu::init_global_features();
+  Config::init();
+  Kmem::init_mmu(Cpu::cpus.cpu(Cpu_number::boot_cpu()));
+}
+
+int main()
+{
+  cout << "[UTEST] Ready queue benchmark" << endl;
+  bench_layout("single", prio_single);
+  bench_layout("sparse", prio_sparse);
+  bench_layout("dense", prio_dense);
+  bench_layout("random", prio_random);
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
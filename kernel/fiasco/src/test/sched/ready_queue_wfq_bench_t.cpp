@@ -0,0 +1,171 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+#include "ready_queue_wfq.h"
+
+IMPLEMENTATION:
+
+#include "cpu.h"
+#include "cpu_lock.h"
+#include "lock_guard.h"
+
+// WFQ ready queue benchmark: cost of enqueue, dequeue and requeue with
+// more runnable contexts than the heap's initial capacity, including the
+// growth of the heap during the initial burst of wakeups.  As in the
+// kernel, room for the contexts is reserved before they are enqueued.
+//
+// Only the [UTEST] lines are compared against the verify file; the
+// cycle counts are informational.
+
+class Bench_sc : public Sched_context_wfq<Bench_sc>
+{
+public:
+  typedef Bench_sc Wfq_sc;
+
+  static Bench_sc *wfq_elem(Bench_sc *x) { return x; }
+  bool in_ready_list() const { return _ready_link != 0; }
+
+  Bench_sc **_ready_link;
+  bool _idle:1;
+  Unsigned64 _dl;
+  Unsigned64 _left;
+  unsigned _q;
+  unsigned _w;
+};
+
+// below Ready_queue_wfq::Max_size for 32 and 64 bit
+enum { Max_scs = 16000, Rounds = 100000 };
+
+static Bench_sc scs[Max_scs];
+static Bench_sc idle_sc;
+
+static Unsigned64 rnd_state = 42;
+
+static unsigned
+rnd()
+{
+  rnd_state = rnd_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rnd_state >> 33;
+}
+
+static void
+bench_heap(unsigned n)
+{
+  static Ready_queue_wfq<Bench_sc> rq;
+  Unsigned64 t, burst, cycle = 0, requeue = 0;
+
+  if (!rq.reserve(n))
+    {
+      cout << "reserve(" << n << ") failed" << endl;
+      exit(1);
+    }
+
+  auto guard = lock_guard(cpu_lock);
+
+  rq.set_idle(&idle_sc);
+
+  // burst of n wakeups, growing the heap as needed
+  t = Cpu::rdtsc();
+  for (unsigned i = 0; i < n; ++i)
+    {
+      scs[i]._ready_link = 0;
+      scs[i]._dl = rnd();
+      rq.enqueue(&scs[i], false);
+    }
+  burst = Cpu::rdtsc() - t;
+
+  // block/wakeup of random contexts
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      Bench_sc *sc = &scs[rnd() % n];
+
+      t = Cpu::rdtsc();
+      rq.dequeue(sc);
+      Bench_sc *next = rq.next_to_run();
+      rq.enqueue(sc, false);
+      cycle += Cpu::rdtsc() - t;
+
+      assert (next && next != &idle_sc);
+      (void)next;
+    }
+
+  // timeslice expiry of the head: push its deadline and requeue
+  for (unsigned r = 0; r < Rounds; ++r)
+    {
+      Bench_sc *sc = rq.next_to_run();
+      sc->_dl += 1 + rnd() % 1000;
+
+      t = Cpu::rdtsc();
+      rq.requeue(sc);
+      requeue += Cpu::rdtsc() - t;
+    }
+
+  // drain in deadline order
+  Unsigned64 last = 0;
+  for (unsigned i = 0; i < n; ++i)
+    {
+      Bench_sc *sc = rq.next_to_run();
+      assert (sc != &idle_sc);
+      assert (sc->_dl >= last);
+      last = sc->_dl;
+      rq.dequeue(sc);
+    }
+  assert (rq.next_to_run() == &idle_sc);
+
+  cout << "[UTEST] ready contexts " << setbase(10) << n << endl;
+  cout << "  enqueue burst: " << burst / n << " cycles"
+       << "  block/wakeup: " << cycle / Rounds << " cycles"
+       << "  requeue: " << requeue / Rounds << " cycles" << endl;
+}
+
+#include "boot_info.h"
+#include "config.h"
+#include "kip_init.h"
+#include "kmem.h"
+#include "kmem_alloc.h"
+#include "per_cpu_data_alloc.h"
+#include "static_init.h"
+#include "usermode.h"
+
+STATIC_INITIALIZER_P(init, STARTUP_INIT_PRIO);
+STATIC_INITIALIZER_P(init2, POST_CPU_LOCAL_INIT_PRIO);
+
+static void init()
+{
+  Usermode::init(Cpu_number::boot_cpu());
+  Boot_info::init();
+  Kip_init::init();
+  Kmem_alloc::base_init();
+  Kmem_alloc::init();
+
+  // Initialize cpu-local data management and run constructors for CPU 0
+  Per_cpu_data::init_ctors();
+  Per_cpu_data_alloc::alloc(Cpu_number::boot_cpu());
+  Per_cpu_data::run_ctors(Cpu_number::boot_cpu());
+}
+
+static void init2()
+{
+  Cpu::init_global_features();
+  Config::init();
+  Kmem::init_mmu(Cpu::cpus.cpu(Cpu_number::boot_cpu()));
+}
+
+int main()
+{
+  static unsigned const sizes[] = { 16, 1024, 4096, 12000, Max_scs };
+
+  cout << "[UTEST] WFQ ready queue benchmark" << endl;
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    bench_heap(sizes[i]);
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
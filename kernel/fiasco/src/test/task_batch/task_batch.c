@@ -0,0 +1,221 @@
+/*
+ * Batched map/unmap test.
+ *
+ * Runs as root task.  Maps a set of pages into a child task with one
+ * l4_task_map_ku_batch() call, maps them back with l4_task_map_batch()
+ * and checks their contents, then revokes them with
+ * l4_task_unmap_ku_batch().  A second child is created from a factory
+ * with a tight quota, so that a batch spread over many page tables runs
+ * out of memory part way through; the error result must then report the
+ * number of pages mapped before the failing one, and those pages must be
+ * mapped.
+ */
+
+#include <l4/sys/consts.h>
+#include <l4/sys/factory.h>
+#include <l4/sys/task.h>
+#include <l4/sys/types.h>
+#include <l4/sys/utcb.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+  Num_pages    = 24,            /* fits one UTCB map-back batch */
+  Num_ok       = 8,
+  Ku_mem       = 0x20000000,
+  Ku_mem_order = L4_PAGESHIFT,
+  Dst_base     = 0x10000000,
+  Dst_stride   = 4 << 20,       /* one page table per page */
+  Scratch      = 0x30000000,
+  Spare_pages  = 6,             /* quota left for page tables */
+  Max_limit    = 256 * L4_PAGESIZE,
+  Child_cap    = 0x20 << L4_CAP_SHIFT,
+  Tight_cap    = 0x21 << L4_CAP_SHIFT,
+  Factory_cap  = 0x22 << L4_CAP_SHIFT,
+};
+
+static char pages[Num_pages][L4_PAGESIZE]
+  __attribute__((aligned(L4_PAGESIZE)));
+
+static void
+fail(char const *what, l4_msgtag_t tag)
+{
+  printf("task_batch: %s failed: %ld\n", what, l4_error(tag));
+  exit(1);
+}
+
+static l4_addr_t
+dst_addr(unsigned i, l4_addr_t stride)
+{
+  return Dst_base + i * stride;
+}
+
+/* Fill the kernel-user memory vector for mapping the first n pages. */
+static l4_umword_t *
+map_vector(unsigned n, l4_addr_t stride)
+{
+  l4_umword_t *vec = (l4_umword_t *)Ku_mem;
+  unsigned i;
+
+  for (i = 0; i < n; ++i)
+    {
+      vec[2 * i] = l4_map_control(dst_addr(i, stride), 0, L4_MAP_ITEM_MAP);
+      vec[2 * i + 1] = l4_fpage((l4_addr_t)pages[i], L4_PAGESHIFT,
+                                L4_FPAGE_RW).raw;
+    }
+  return vec;
+}
+
+/* Map n pages of task back to Scratch and check that they are ours. */
+static int
+check_mapped(l4_cap_idx_t task, unsigned n, l4_addr_t stride)
+{
+  l4_fpage_t fps[Num_pages];
+  l4_addr_t bases[Num_pages];
+  unsigned i;
+  l4_msgtag_t tag;
+
+  for (i = 0; i < n; ++i)
+    {
+      fps[i] = l4_fpage(dst_addr(i, stride), L4_PAGESHIFT, L4_FPAGE_RW);
+      bases[i] = l4_map_control(Scratch + i * L4_PAGESIZE, 0,
+                                L4_MAP_ITEM_MAP);
+    }
+
+  tag = l4_task_map_batch(L4_BASE_TASK_CAP, task, fps, bases, n);
+  if (l4_error(tag))
+    fail("map back", tag);
+
+  for (i = 0; i < n; ++i)
+    if (*(unsigned volatile *)(Scratch + i * L4_PAGESIZE) != i + 1)
+      {
+        printf("task_batch: page %u has wrong contents\n", i);
+        return 0;
+      }
+  return 1;
+}
+
+static void
+test_batch(void)
+{
+  l4_fpage_t *fps = (l4_fpage_t *)Ku_mem;
+  l4_msgtag_t tag;
+  unsigned i;
+
+  tag = l4_factory_create_task(L4_BASE_FACTORY_CAP, Child_cap,
+                               l4_fpage_invalid());
+  if (l4_error(tag))
+    fail("create task", tag);
+
+  tag = l4_task_map_ku_batch(Child_cap, L4_BASE_TASK_CAP,
+                             map_vector(Num_ok, L4_PAGESIZE), Num_ok);
+  if (l4_error(tag))
+    fail("map batch", tag);
+
+  if (!check_mapped(Child_cap, Num_ok, L4_PAGESIZE))
+    exit(1);
+  printf("task_batch: map %u pages ok\n", (unsigned)Num_ok);
+
+  for (i = 0; i < Num_ok; ++i)
+    fps[i] = l4_fpage(dst_addr(i, L4_PAGESIZE), L4_PAGESHIFT, L4_FPAGE_RWX);
+
+  tag = l4_task_unmap_ku_batch(Child_cap, fps, Num_ok, L4_FP_ALL_SPACES);
+  if (l4_error(tag))
+    fail("unmap batch", tag);
+
+  /* the scratch mappings were read, so each page reports read access */
+  for (i = 0; i < Num_ok; ++i)
+    if (!(l4_fpage_rights(fps[i]) & L4_FPAGE_RO))
+      {
+        printf("task_batch: page %u lacks flushed rights\n", i);
+        exit(1);
+      }
+  printf("task_batch: unmap %u pages ok\n", (unsigned)Num_ok);
+
+  l4_task_delete_obj(L4_BASE_TASK_CAP, Child_cap);
+}
+
+/*
+ * Create Tight_cap from a factory whose quota leaves only a few pages
+ * after creating the task.
+ */
+static void
+create_tight_task(void)
+{
+  unsigned long limit;
+
+  for (limit = L4_PAGESIZE; limit <= Max_limit; limit += L4_PAGESIZE)
+    {
+      l4_msgtag_t tag
+        = l4_factory_create_factory(L4_BASE_FACTORY_CAP, Factory_cap,
+                                    limit + Spare_pages * L4_PAGESIZE);
+      if (l4_error(tag))
+        fail("create factory", tag);
+
+      if (!l4_error(l4_factory_create_task(Factory_cap, Tight_cap,
+                                           l4_fpage_invalid())))
+        return;
+
+      l4_task_delete_obj(L4_BASE_TASK_CAP, Factory_cap);
+    }
+
+  printf("task_batch: no task within %lu bytes of quota\n",
+         (unsigned long)Max_limit);
+  exit(1);
+}
+
+static void
+test_partial(void)
+{
+  l4_msgtag_t tag;
+  unsigned done;
+
+  create_tight_task();
+
+  tag = l4_task_map_ku_batch(Tight_cap, L4_BASE_TASK_CAP,
+                             map_vector(Num_pages, Dst_stride), Num_pages);
+  if (!l4_error(tag))
+    {
+      printf("task_batch: %u pages mapped despite the quota\n",
+             (unsigned)Num_pages);
+      exit(1);
+    }
+
+  done = l4_utcb_mr()->mr[0];
+  if (done == 0 || done >= Num_pages)
+    {
+      printf("task_batch: partial map: error %ld after %u pages\n",
+             l4_error(tag), done);
+      exit(1);
+    }
+
+  if (!check_mapped(Tight_cap, done, Dst_stride))
+    exit(1);
+  printf("task_batch: partial map stopped after %u pages ok\n", done);
+
+  l4_task_delete_obj(L4_BASE_TASK_CAP, Tight_cap);
+  l4_task_delete_obj(L4_BASE_TASK_CAP, Factory_cap);
+}
+
+int
+main(void)
+{
+  l4_msgtag_t tag;
+  unsigned i;
+
+  tag = l4_task_add_ku_mem(L4_BASE_TASK_CAP,
+                           l4_fpage(Ku_mem, Ku_mem_order, L4_FPAGE_RW));
+  if (l4_error(tag))
+    fail("add ku_mem", tag);
+
+  for (i = 0; i < Num_pages; ++i)
+    *(unsigned *)pages[i] = i + 1;
+
+  test_batch();
+  test_partial();
+
+  printf("task_batch: done\n");
+  return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * Host-side decoder for the trace-buffer stream of the tbuf_export
+ * collector.
+ *
+ * Reads a console log from stdin, picks up the "TBX " lines and prints
+ * one line per trace-buffer entry, in the style of the JDB trace-buffer
+ * view: event number (counted per ring from the time the collector
+ * attached), CPU, TSC, type, IP and context, followed by the contents.
+ * Kernel messages (ke, ke_reg, ke_bin) and page faults are decoded, all
+ * other entries are shown as payload words together with the name of
+ * their log event.  The stream format is described in ../tbuf_export.c,
+ * the entry layouts follow fiasco/src/kern/tb_entry.cpp.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+  Version       = 1,
+  Max_rings     = 1024,
+  Max_payload   = 256,
+  Max_types     = 256,
+
+  /* fixed entry types, see kern/tb_entry.cpp */
+  Tbuf_pf       = 1,
+  Tbuf_ke       = 5,
+  Tbuf_ke_reg   = 6,
+  Tbuf_ke_bin   = 11,
+  Tbuf_hidden   = 0x80,
+};
+
+static char const *const fixed_names[] =
+{
+  "unused", "pf", "ipc", "ipc_res", "ipc_trace", "ke", "ke_reg", "exregs",
+  "bp", "pf_res", "preempt", "ke_bin",
+};
+
+/* short names of the log events, from the 'N' records */
+static char *type_names[Max_types];
+
+static unsigned char *stream;
+static size_t stream_len, stream_pos;
+
+static unsigned word_size, entry_size, num_rings, hdr_size;
+static uint64_t tsc[Max_rings];
+static uint64_t number[Max_rings];
+static unsigned long entries, lost;
+
+static void
+truncated(void)
+{
+  fprintf(stderr, "tbx_decode: stream truncated at byte %zu\n", stream_pos);
+  exit(1);
+}
+
+static int
+hexval(int c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+/* collect the bytes of all "TBX " lines */
+static void
+read_stream(FILE *f)
+{
+  size_t cap = 1 << 16;
+  char buf[1024];
+
+  stream = malloc(cap);
+  while (fgets(buf, sizeof(buf), f))
+    {
+      char const *p = strstr(buf, "TBX ");
+      if (!p)
+        continue;
+
+      for (p += 4; hexval(p[0]) >= 0 && hexval(p[1]) >= 0; p += 2)
+        {
+          if (stream_len == cap)
+            stream = realloc(stream, cap *= 2);
+          stream[stream_len++] = hexval(p[0]) << 4 | hexval(p[1]);
+        }
+    }
+}
+
+static unsigned
+get(void)
+{
+  if (stream_pos >= stream_len)
+    truncated();
+  return stream[stream_pos++];
+}
+
+static uint64_t
+get_num(void)
+{
+  uint64_t v = 0;
+  unsigned shift = 0, c;
+
+  do
+    {
+      c = get();
+      v |= (uint64_t)(c & 0x7f) << shift;
+      shift += 7;
+    }
+  while (c & 0x80);
+
+  return v;
+}
+
+static char *
+get_str(void)
+{
+  size_t start = stream_pos;
+  while (get())
+    ;
+  return strdup((char const *)stream + start);
+}
+
+static uint64_t
+word(unsigned char const *p)
+{
+  uint64_t v = 0;
+  unsigned i;
+
+  /* the targets the trace buffer is exported from are little endian */
+  for (i = word_size; i; --i)
+    v = v << 8 | p[i - 1];
+  return v;
+}
+
+static char const *
+type_name(unsigned type)
+{
+  type &= ~Tbuf_hidden;
+  if (type < sizeof(fixed_names) / sizeof(fixed_names[0]))
+    return fixed_names[type];
+  if (type_names[type])
+    return type_names[type];
+  return "?";
+}
+
+/* message of a ke or ke_reg entry: either inline or a pointer to a
+ * constant string in the kernel */
+static void
+print_msg(unsigned char const *m, unsigned len)
+{
+  unsigned i;
+
+  if (m[0] == 0 && m[1] == 1)
+    {
+      printf(" msg@%0*llx", 2 * word_size,
+             (unsigned long long)word(m + 2));
+      return;
+    }
+
+  printf(" \"");
+  for (i = 0; i < len && m[i]; ++i)
+    putchar(isprint(m[i]) ? m[i] : '.');
+  printf("\"");
+}
+
+static void
+print_payload(unsigned type, unsigned char const *p, unsigned len)
+{
+  unsigned i;
+
+  switch (type & ~Tbuf_hidden)
+    {
+    case Tbuf_pf:
+      printf(" pfa=%0*llx err=%llx space=%0*llx",
+             2 * word_size, (unsigned long long)word(p),
+             (unsigned long long)word(p + word_size),
+             2 * word_size, (unsigned long long)word(p + 2 * word_size));
+      break;
+
+    case Tbuf_ke:
+      print_msg(p, entry_size - hdr_size);
+      break;
+
+    case Tbuf_ke_reg:
+      print_msg(p + 3 * word_size, entry_size - hdr_size - 3 * word_size);
+      for (i = 0; i < 3; ++i)
+        printf(" %0*llx", 2 * word_size,
+               (unsigned long long)word(p + i * word_size));
+      break;
+
+    case Tbuf_ke_bin:
+      for (i = 0; i < len; ++i)
+        printf(" %02x", p[i]);
+      break;
+
+    default:
+      for (i = 0; i < len; i += word_size)
+        printf(" %0*llx", 2 * word_size, (unsigned long long)word(p + i));
+      break;
+    }
+}
+
+static void
+decode_entry(void)
+{
+  unsigned char payload[Max_payload];
+  unsigned ring = get_num();
+  uint64_t ip   = get_num();
+  uint64_t ctx  = get_num();
+  uint64_t dtsc = get_num();
+  uint64_t pmc1 = get_num();
+  uint64_t pmc2 = get_num();
+  uint64_t kclk = get_num();
+  unsigned type = get_num();
+  unsigned cpu  = get_num();
+  unsigned len  = get_num();
+  unsigned i;
+
+  (void)pmc1;
+  (void)pmc2;
+
+  if (ring >= num_rings || len > entry_size - hdr_size)
+    {
+      fprintf(stderr, "tbx_decode: bad entry at byte %zu\n", stream_pos);
+      exit(1);
+    }
+
+  /* trailing zero bytes were dropped by the collector */
+  memset(payload, 0, sizeof(payload));
+  for (i = 0; i < len; ++i)
+    payload[i] = get();
+
+  tsc[ring] += dtsc;
+  ++entries;
+
+  printf("%8llu %3u %16llu %8llx %-10s %0*llx %0*llx:",
+         (unsigned long long)number[ring]++, cpu,
+         (unsigned long long)tsc[ring], (unsigned long long)kclk,
+         type_name(type), 2 * word_size, (unsigned long long)ip,
+         2 * word_size, (unsigned long long)ctx);
+  print_payload(type, payload, len);
+  printf("\n");
+}
+
+int
+main(void)
+{
+  read_stream(stdin);
+
+  while (stream_pos < stream_len)
+    {
+      unsigned rec = get();
+      unsigned type, ring;
+      uint64_t cnt;
+
+      switch (rec)
+        {
+        case 'H':
+          if (get_num() != Version)
+            {
+              fprintf(stderr, "tbx_decode: unknown stream version\n");
+              return 1;
+            }
+          word_size  = get_num();
+          entry_size = get_num();
+          num_rings  = get_num();
+          /* sizeof(Tb_entry): packed header, 8-byte aligned */
+          hdr_size   = (3 * word_size + 22 + 7) & ~7U;
+          if ((word_size != 4 && word_size != 8) || num_rings > Max_rings
+              || entry_size > hdr_size + Max_payload || entry_size < hdr_size)
+            {
+              fprintf(stderr, "tbx_decode: bad stream header\n");
+              return 1;
+            }
+          break;
+
+        case 'N':
+          /* the short name, as in the JDB trace-buffer view */
+          type = get_num();
+          free(get_str());
+          free(type_names[type % Max_types]);
+          type_names[type % Max_types] = get_str();
+          break;
+
+        case 'E':
+          if (!entry_size)
+            truncated();
+          decode_entry();
+          break;
+
+        case 'D':
+          ring = get_num();
+          cnt  = get_num();
+          if (ring < num_rings)
+            number[ring] += cnt;
+          lost += cnt;
+          printf("         --- ring %u: %llu entries lost\n",
+                 ring, (unsigned long long)cnt);
+          break;
+
+        default:
+          fprintf(stderr, "tbx_decode: bad record '%c' at byte %zu\n",
+                  rec, stream_pos - 1);
+          return 1;
+        }
+    }
+
+  fprintf(stderr, "tbx_decode: %lu entries, %lu lost, %zu stream bytes\n",
+          entries, lost, stream_len);
+  return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * Streaming trace-buffer collector.
+ *
+ * Runs as root task.  Attaches to the kernel trace buffer as streaming
+ * collector (l4_debugger_tbuf_export()), switches on some log events and
+ * drains the per-CPU rings whenever the kernel signals that one of them
+ * filled up to the watermark, and at least every 100ms.  The raw entries
+ * are written to the console as a compact binary stream, hex-encoded in
+ * lines starting with "TBX ".  host/tbx_decode turns a console log back
+ * into readable entries.
+ *
+ * Stream records, all numbers are unsigned LEB128:
+ *  'H' version, word size, entry size, number of rings
+ *  'N' type, name (0-terminated), short name (0-terminated)
+ *  'E' ring, ip, ctx, tsc delta to the previous entry of the ring,
+ *      pmc1, pmc2, kclock, type, cpu, payload length, payload bytes
+ *      (the entry behind the header, trailing zero bytes dropped)
+ *  'D' ring, number of entries lost
+ * Event numbers are not transmitted: within a ring they count up by one,
+ * lost entries are accounted for by 'D' records.
+ */
+
+#include <l4/sys/consts.h>
+#include <l4/sys/debugger.h>
+#include <l4/sys/factory.h>
+#include <l4/sys/irq.h>
+#include <l4/sys/task.h>
+#include <l4/sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum
+{
+  Version      = 1,
+  Irq_cap      = 0x20 << L4_CAP_SHIFT,
+  Ku_mem       = 0x20000000,
+  Ku_mem_order = L4_PAGESHIFT + 1,
+  Max_rings    = (1 << Ku_mem_order) / sizeof(l4_debugger_tbuf_export_ring_t),
+  Max_entry    = 256,
+  Rounds       = 50,   /* times 100ms */
+  Line_bytes   = 32,
+};
+
+/* Header of a trace-buffer entry (keep in sync with
+ * fiasco/src/kern/tb_entry.cpp) */
+typedef struct __attribute__((packed))
+{
+  l4_umword_t number;
+  l4_umword_t ip;
+  l4_umword_t ctx;
+  l4_uint64_t tsc;
+  l4_uint32_t pmc1;
+  l4_uint32_t pmc2;
+  l4_uint32_t kclock;
+  l4_uint8_t type;
+  l4_uint8_t cpu;
+} tb_entry_t;
+
+/* sizeof(Tb_entry): the header is 8-byte aligned */
+#define HDR_SIZE ((sizeof(tb_entry_t) + 7) & ~7UL)
+
+static l4_debugger_tbuf_export_ring_t *const state
+  = (l4_debugger_tbuf_export_ring_t *)Ku_mem;
+static l4_debugger_tbuf_export_info_t info;
+static l4_uint64_t last_tsc[Max_rings];
+static unsigned long exported[Max_rings];
+static unsigned long lost[Max_rings];
+
+static unsigned char line[Line_bytes];
+static unsigned line_len;
+static unsigned long stream_bytes;
+
+static void
+flush(void)
+{
+  static char const hex[] = "0123456789abcdef";
+  char buf[4 + 2 * Line_bytes + 1];
+  unsigned i;
+
+  if (!line_len)
+    return;
+
+  memcpy(buf, "TBX ", 4);
+  for (i = 0; i < line_len; ++i)
+    {
+      buf[4 + 2 * i]     = hex[line[i] >> 4];
+      buf[4 + 2 * i + 1] = hex[line[i] & 15];
+    }
+  buf[4 + 2 * i] = 0;
+  puts(buf);
+  line_len = 0;
+}
+
+static void
+put(unsigned char c)
+{
+  line[line_len++] = c;
+  ++stream_bytes;
+  if (line_len == Line_bytes)
+    flush();
+}
+
+static void
+put_num(l4_uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      put((v & 0x7f) | 0x80);
+      v >>= 7;
+    }
+  put(v);
+}
+
+static void
+put_str(char const *s)
+{
+  do
+    put(*s);
+  while (*s++);
+}
+
+/* Emit the entry in slot n of ring r, if the kernel did not reuse the
+ * slot while we were copying it. */
+static int
+export_entry(unsigned r, l4_umword_t n)
+{
+  unsigned long slots = info.ring_size / info.entry_size;
+  unsigned char const *slot = (unsigned char const *)info.rings
+                              + r * info.ring_size
+                              + (n % slots) * info.entry_size;
+  l4_umword_t const *num = (l4_umword_t const *)slot;
+  l4_umword_t expect = (n + 1) * info.num_rings + r;
+  unsigned char e[Max_entry];
+  tb_entry_t const *h = (tb_entry_t const *)e;
+  unsigned len, i;
+
+  /* the kernel writes the number of an entry first: if it is unchanged
+   * after the copy, the copy is consistent */
+  if (__atomic_load_n(num, __ATOMIC_ACQUIRE) != expect)
+    return 0;
+  memcpy(e, slot, info.entry_size);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(num, __ATOMIC_RELAXED) != expect)
+    return 0;
+
+  if (h->type == 0)
+    return 1;
+
+  for (len = info.entry_size - HDR_SIZE; len && !e[HDR_SIZE + len - 1]; --len)
+    ;
+
+  put('E');
+  put_num(r);
+  put_num(h->ip);
+  put_num(h->ctx);
+  put_num(h->tsc - last_tsc[r]);
+  put_num(h->pmc1);
+  put_num(h->pmc2);
+  put_num(h->kclock);
+  put_num(h->type);
+  put_num(h->cpu);
+  put_num(len);
+  for (i = 0; i < len; ++i)
+    put(e[HDR_SIZE + i]);
+
+  last_tsc[r] = h->tsc;
+  ++exported[r];
+  return 1;
+}
+
+static void
+put_lost(unsigned r, l4_umword_t cnt)
+{
+  put('D');
+  put_num(r);
+  put_num(cnt);
+  lost[r] += cnt;
+}
+
+static void
+drain(void)
+{
+  unsigned long slots = info.ring_size / info.entry_size;
+  unsigned r;
+
+  for (r = 0; r < info.num_rings; ++r)
+    {
+      l4_debugger_tbuf_export_ring_t *s = &state[r];
+      l4_umword_t head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+      l4_umword_t tail = s->tail;
+      l4_umword_t miss = 0;
+
+      if (head - tail > slots)
+        {
+          put_lost(r, head - slots - tail);
+          tail = head - slots;
+        }
+
+      for (; tail != head; ++tail)
+        if (!export_entry(r, tail))
+          ++miss;
+        else if (miss)
+          {
+            put_lost(r, miss);
+            miss = 0;
+          }
+
+      if (miss)
+        put_lost(r, miss);
+
+      __atomic_store_n(&s->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+static void
+put_names(void)
+{
+  char name[64], shortname[32];
+  unsigned i;
+
+  for (i = 0;
+       !l4_debugger_query_log_name(L4_BASE_TASK_CAP, i,
+                                   name, sizeof(name),
+                                   shortname, sizeof(shortname));
+       ++i)
+    {
+      put('N');
+      put_num(i + 12 /* Tbuf_dynentries */);
+      put_str(name);
+      put_str(shortname);
+    }
+}
+
+int
+main(void)
+{
+  unsigned long dropped = 0, notified = 0, total = 0, missed = 0;
+  unsigned r, i;
+
+  if (l4_error(l4_task_add_ku_mem(L4_BASE_TASK_CAP,
+                                  l4_fpage(Ku_mem, Ku_mem_order,
+                                           L4_FPAGE_RW)))
+      || l4_error(l4_factory_create_irq(L4_BASE_FACTORY_CAP, Irq_cap))
+      || l4_error(l4_irq_attach(Irq_cap, 0, L4_BASE_THREAD_CAP)))
+    {
+      printf("tbuf_export: cannot set up ku_mem and IRQ\n");
+      exit(1);
+    }
+
+  /* check that the states fit before attaching */
+  if (l4_debugger_tbuf_export_info(L4_BASE_TASK_CAP, &info)
+      || info.num_rings > Max_rings || info.entry_size > Max_entry
+      || info.entry_size < HDR_SIZE
+      || l4_debugger_tbuf_export(Irq_cap, state, 0, &info))
+    {
+      printf("tbuf_export: no trace buffer export in this kernel\n");
+      exit(1);
+    }
+
+  l4_debugger_switch_log(L4_BASE_TASK_CAP, "csw",
+                         L4_DEBUGGER_SWITCH_LOG_ON);
+
+  put('H');
+  put_num(Version);
+  put_num(sizeof(l4_umword_t));
+  put_num(info.entry_size);
+  put_num(info.num_rings);
+  put_names();
+
+  /* every 100ms, or when a ring reaches the watermark */
+  for (i = 0; i < Rounds; ++i)
+    {
+      l4_irq_receive(Irq_cap, l4_timeout(L4_IPC_TIMEOUT_NEVER,
+                                         l4_timeout_rel(390, 8)));
+      drain();
+    }
+
+  l4_debugger_switch_log(L4_BASE_TASK_CAP, "csw",
+                         L4_DEBUGGER_SWITCH_LOG_OFF);
+  drain();
+  flush();
+
+  for (r = 0; r < info.num_rings; ++r)
+    {
+      total    += exported[r];
+      missed   += lost[r];
+      dropped  += state[r].dropped;
+      notified += state[r].notified;
+    }
+
+  if (l4_debugger_tbuf_export(Irq_cap, 0, 0, 0))
+    printf("tbuf_export: detach failed\n");
+
+  printf("tbuf_export: %lu entries in %lu bytes (%lu bytes raw), "
+         "%lu lost (%lu overwritten), %lu watermark IRQs\n",
+         total, stream_bytes, total * info.entry_size,
+         missed, dropped, notified);
+
+  exit(0);
+}
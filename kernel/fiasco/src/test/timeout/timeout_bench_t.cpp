@@ -0,0 +1,173 @@
+IMPLEMENTATION:
+
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+#include "timeout.h"
+
+IMPLEMENTATION:
+
+#include "cpu.h"
+#include "cpu_lock.h"
+#include "kip.h"
+#include "lock_guard.h"
+
+// Timeout queue stress benchmark: throughput of enqueue, reset and
+// expiry, and accuracy of the wakeup time programmed in one-shot mode.
+//
+// Only the [UTEST] lines are compared against the verify file; the
+// cycle counts are informational.
+
+class Bench_timeout : public Timeout
+{
+public:
+  unsigned hits;
+  Bench_timeout() : hits(0) {}
+  Unsigned64 wakeup() const { return _wakeup; }
+
+private:
+  bool expired() { ++hits; return false; }
+};
+
+enum { Max_timeouts = 8192 };
+
+static Bench_timeout timeouts[Max_timeouts];
+
+static Unsigned64 rnd_state = 42;
+
+static Unsigned64
+rnd()
+{
+  rnd_state = rnd_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rnd_state >> 33;
+}
+
+/** Random wakeup time: mostly near IPC timeouts, some far away. */
+static Unsigned64
+rnd_wakeup(Unsigned64 clock)
+{
+  switch (rnd() & 3)
+    {
+    case 0:  return clock + rnd() % 1000;
+    case 1:  return clock + rnd() % 100000;
+    case 2:  return clock + rnd() % 10000000;
+    default: return clock + rnd() % 10000000000ULL;
+    }
+}
+
+static void
+bench_timeouts(unsigned n)
+{
+  Timeout_q &q = Timeout_q::timeout_queue.cpu(Cpu_number::boot_cpu());
+  Cpu_time volatile &clock = Kip::k()->clock;
+  Unsigned64 t, enq = 0, rst = 0, exp = 0;
+  unsigned expired = 0, exact = 0;
+  Unsigned64 slack = 0;
+
+  auto guard = lock_guard(cpu_lock);
+
+  q.do_timeouts();
+
+  t = Cpu::rdtsc();
+  for (unsigned i = 0; i < n; ++i)
+    timeouts[i].set(rnd_wakeup(clock), Cpu_number::boot_cpu());
+  enq = Cpu::rdtsc() - t;
+
+  // cancel every second timeout
+  t = Cpu::rdtsc();
+  for (unsigned i = 0; i < n; i += 2)
+    timeouts[i].reset();
+  rst = Cpu::rdtsc() - t;
+
+  // advance the clock in steps and compare the next programmed
+  // wakeup with the earliest pending timeout
+  for (unsigned step = 0; step < 1000; ++step)
+    {
+      Unsigned64 min = ~0ULL;
+      for (unsigned i = 1; i < n; i += 2)
+        if (timeouts[i].is_set() && timeouts[i].wakeup() < min)
+          min = timeouts[i].wakeup();
+
+      Unsigned64 next = q.next_wakeup(clock + 10000);
+      assert (next <= min);
+      if (next == min)
+        ++exact;
+      else if (min < clock + 10000)
+        slack += min - next;
+
+      clock += rnd() % 20000;
+      t = Cpu::rdtsc();
+      q.do_timeouts();
+      exp += Cpu::rdtsc() - t;
+    }
+
+  for (unsigned i = 0; i < n; ++i)
+    {
+      if (timeouts[i].is_set())
+        {
+          assert (timeouts[i].wakeup() > clock);
+          timeouts[i].reset();
+        }
+      expired += timeouts[i].hits;
+      timeouts[i].hits = 0;
+      timeouts[i].init();
+    }
+
+  cout << "[UTEST] timeouts " << setbase(10) << n << endl;
+  cout << "  enqueue: " << enq / n << " cycles"
+       << "  reset: " << rst / (n / 2) << " cycles"
+       << "  do_timeouts: " << exp / 1000 << " cycles"
+       << "  expired: " << expired << endl;
+  cout << "  one-shot: " << exact << "/1000 exact"
+       << "  early by " << slack / 1000 << "us on average" << endl;
+}
+
+#include "boot_info.h"
+#include "config.h"
+#include "kip_init.h"
+#include "kmem.h"
+#include "kmem_alloc.h"
+#include "per_cpu_data_alloc.h"
+#include "static_init.h"
+#include "usermode.h"
+
+STATIC_INITIALIZER_P(init, STARTUP_INIT_PRIO);
+STATIC_INITIALIZER_P(init2, POST_CPU_LOCAL_INIT_PRIO);
+
+static void init()
+{
+  Usermode::init(Cpu_number::boot_cpu());
+  Boot_info::init();
+  Kip_init::init();
+  Kmem_alloc::base_init();
+  Kmem_alloc::init();
+
+  // Initialize cpu-local data management and run constructors for CPU 0
+  Per_cpu_data::init_ctors();
+  Per_cpu_data_alloc::alloc(Cpu_number::boot_cpu());
+  Per_cpu_data::run_ctors(Cpu_number::boot_cpu());
+}
+
+static void init2()
+{
+  Cpu::init_global_features();
+  Config::init();
+  Kmem::init_mmu(Cpu::cpus.cpu(Cpu_number::boot_cpu()));
+}
+
+int main()
+{
+  static unsigned const sizes[] = { 16, 256, 2048, 8192 };
+
+  cout << "[UTEST] Timeout queue benchmark" << endl;
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    bench_timeouts(sizes[i]);
+  cout << "[UTEST] ########################################" << endl;
+
+  cerr << "OK" << endl;
+  return(0);
+}
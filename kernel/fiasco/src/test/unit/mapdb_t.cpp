@@ -342,6 +342,60 @@ void flushtest()
   cout << "[UTEST] Resurrection is impossible, as it ought to be." << endl;
 }
 
+void handover()
+{
+  Mapdb m (s0, Mapping::Page(1U << (32 - Config::PAGE_SHIFT - page_sizes[0])),
+      page_sizes, page_sizes_max);
+
+  Mapping *node, *sub;
+  Mapdb::Frame frame;
+
+  cout << "[UTEST] Inserting 4K submapping with lock hand-over" << endl;
+  assert (m.lookup (s0, to_pfn(0), to_pfn(0), &node, &frame));
+  assert (frame.page_shift() == Mapdb::Order(page_sizes[0]));
+  sub = m.insert_child (&frame, node, other,
+                        to_pfn(3*Config::PAGE_SIZE),
+                        to_pfn(Config::PAGE_SIZE),
+                        to_pcnt(Config::PAGE_SHIFT));
+  assert (sub);
+  assert (sub->space() == other);
+  // frame now is the subframe holding the new mapping
+  assert (frame.page_shift() == Mapdb::Order(0));
+  assert (frame.vaddr(sub) == to_pfn(3*Config::PAGE_SIZE));
+  cout << "[UTEST] tree page size 0x" << setbase(16)
+       << (Mapdb::Pfn(1) << frame.page_shift()) << endl;
+  m.free (frame);
+
+  cout << "[UTEST] Inserting 4K submapping into another subframe" << endl;
+  assert (m.lookup (s0, to_pfn(0), to_pfn(0), &node, &frame));
+  assert (m.insert_child (&frame, node, other,
+                          to_pfn(5*Config::PAGE_SIZE),
+                          to_pfn(2*Config::PAGE_SIZE),
+                          to_pcnt(Config::PAGE_SHIFT)));
+  m.free (frame);
+
+  cout << "[UTEST] Looking up both submappings" << endl;
+  assert (m.lookup (other, to_pfn(3*Config::PAGE_SIZE),
+                    to_pfn(Config::PAGE_SIZE), &sub, &frame));
+  assert (frame.page_shift() == Mapdb::Order(0));
+  m.free (frame);
+  assert (m.lookup (other, to_pfn(5*Config::PAGE_SIZE),
+                    to_pfn(2*Config::PAGE_SIZE), &sub, &frame));
+  m.free (frame);
+
+  cout << "[UTEST] Inserting 4M submapping keeps the tree" << endl;
+  assert (m.lookup (s0, to_pfn(2*Config::SUPERPAGE_SIZE),
+                    to_pfn(2*Config::SUPERPAGE_SIZE), &node, &frame));
+  sub = m.insert_child (&frame, node, other,
+                        to_pfn(4*Config::SUPERPAGE_SIZE),
+                        to_pfn(2*Config::SUPERPAGE_SIZE),
+                        to_pcnt(Config::SUPERPAGE_SHIFT));
+  assert (sub);
+  cout << "[UTEST] tree page size 0x" << setbase(16)
+       << (Mapdb::Pfn(1) << frame.page_shift()) << endl;
+  m.free (frame);
+}
+
 void multilevel ()
 {
   size_t page_sizes[] = { 30 - Config::PAGE_SHIFT,
@@ -412,6 +466,10 @@ int main()
   flushtest();
   cout << "[UTEST] ########################################" << endl;
 
+  cout << "[UTEST] Hand-over test" << endl;
+  handover();
+  cout << "[UTEST] ########################################" << endl;
+
   cout << "Multilevel test" << endl;
   multilevel();
   cout << "[UTEST] ########################################" << endl;
@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+# Count the host system calls per IPC round trip of two Fiasco-UX kernels.
+#
+# Usage: count_syscalls.sh <uxipc> <baseline fiasco> <changed fiasco> [fiasco options]
+#
+# Runs the uxipc root task on each kernel under strace and counts the
+# ptrace, wait4 and process_vm_readv calls of the kernel process between
+# the line announcing the round trips and the line reporting the cycles,
+# that is, during the measurement loop only.  The counts are divided by
+# the number of round trips and printed side by side.
+#
+# Only the kernel process is traced (no strace -f): the kernel itself is
+# the ptrace tracer of its user processes.
+
+set -e
+
+if [ $# -lt 3 ]; then
+  echo "usage: $0 <uxipc> <baseline fiasco> <changed fiasco> [fiasco options]" >&2
+  exit 2
+fi
+
+uxipc=$1
+base=$2
+changed=$3
+shift 3
+
+timeout=${TIMEOUT:-120}
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# run <kernel> <log> [fiasco options]: run the benchmark under strace
+# until it reported
+run()
+{
+  kernel=$1
+  log=$2
+  shift 2
+
+  strace -o "$log" -s 256 -e trace=ptrace,wait4,process_vm_readv,write \
+    "$kernel" -R "$uxipc" "$@" > "$log.out" 2>&1 &
+  tracer=$!
+
+  n=0
+  until grep -qE "cycles per round trip|IPC error|cannot start" "$log.out"; do
+    if [ $n -ge "$timeout" ] || ! kill -0 $tracer 2>/dev/null; then
+      echo "$kernel: no result within ${timeout}s" >&2
+      break
+    fi
+    sleep 1
+    n=$((n + 1))
+  done
+
+  # the kernel does not stop when the root task is done; killing the
+  # kernel rather than strace also ends its user processes
+  pkill -P $tracer 2>/dev/null || true
+  sleep 1
+  kill $tracer 2>/dev/null || true
+  wait $tracer 2>/dev/null || true
+}
+
+# count <log>: print "<syscall> <calls per round trip>" lines
+count()
+{
+  awk '
+    /^write\(1, "/ {
+      s = $0
+      sub(/^write\(1, "/, "", s)
+      if (match(s, /", [0-9]+\) +=/))
+        s = substr(s, 1, RSTART - 1)
+      gsub(/\\n/, "\n", s)
+      gsub(/\\"/, "\"", s)
+      out = out s
+      if (!active && match(out, /IPC, [0-9]+ round trips:\n/))
+        {
+          r = substr(out, RSTART, RLENGTH)
+          gsub(/[^0-9]/, "", r)
+          rounds = r + 0
+          active = 1
+          out = ""
+        }
+      else if (active && index(out, "cycles per round trip"))
+        active = 0
+      else if (length(out) > 512)
+        out = substr(out, length(out) - 255)
+      next
+    }
+    active && /^[a-z_0-9]+\(/ {
+      name = $0
+      sub(/\(.*/, "", name)
+      calls[name]++
+      total++
+    }
+    END {
+      if (!rounds)
+        exit 1
+      n = split("ptrace wait4 process_vm_readv", names, " ")
+      for (i = 1; i <= n; ++i)
+        printf "%s %.2f\n", names[i], calls[names[i]] / rounds
+      printf "total %.2f\n", total / rounds
+    }' "$1"
+}
+
+run "$base" "$tmp/base" "$@"
+run "$changed" "$tmp/changed" "$@"
+
+if ! count "$tmp/base" > "$tmp/base.cnt" \
+   || ! count "$tmp/changed" > "$tmp/changed.cnt"; then
+  echo "no measurement found, kernel output:" >&2
+  cat "$tmp/base.out" "$tmp/changed.out" >&2
+  exit 1
+fi
+
+echo "host system calls per round trip:"
+printf "%-18s %10s %10s\n" "" baseline changed
+paste -d ' ' "$tmp/base.cnt" "$tmp/changed.cnt" \
+  | awk '{ printf "%-18s %10s %10s\n", $1, $2, $4 }'
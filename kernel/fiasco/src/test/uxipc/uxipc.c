@@ -0,0 +1,116 @@
+/*
+ * Fiasco-UX IPC round-trip benchmark.
+ *
+ * Runs as root task.  The main thread calls a server thread in the same
+ * task on the same CPU.  Under Fiasco-UX every kernel entry from user mode
+ * costs several host system calls (ptrace, wait4), so the round-trip time
+ * mostly reflects the number of host system calls per kernel entry.
+ *
+ * count_syscalls.sh runs this benchmark on two UX kernels under strace
+ * and prints the host system calls per round trip (two kernel entries)
+ * of each, counted between the two lines printed below.
+ */
+
+#include <l4/sys/consts.h>
+#include <l4/sys/factory.h>
+#include <l4/sys/ipc.h>
+#include <l4/sys/thread.h>
+#include <l4/sys/utcb.h>
+#include <l4/util/rdtsc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum
+{
+  Rounds     = 20000,
+  Server_cap = 0x20 << L4_CAP_SHIFT,
+};
+
+static char server_stack[8 << 10] __attribute__((aligned(16)));
+
+static void
+server(void)
+{
+  l4_utcb_t *u = l4_utcb();
+  l4_umword_t label;
+  l4_msgtag_t tag;
+
+  tag = l4_ipc_wait(u, &label, L4_IPC_NEVER);
+  for (;;)
+    {
+      if (l4_ipc_error(tag, u))
+        {
+          tag = l4_ipc_wait(u, &label, L4_IPC_NEVER);
+          continue;
+        }
+
+      tag = l4_ipc_reply_and_wait(u, l4_msgtag(0, 1, 0, 0), &label,
+                                  L4_IPC_NEVER);
+    }
+}
+
+static int
+start_server(void)
+{
+  l4_utcb_t *u = (l4_utcb_t *)((char *)l4_utcb() + L4_UTCB_OFFSET);
+
+  if (l4_error(l4_factory_create_thread(L4_BASE_FACTORY_CAP, Server_cap)))
+    return -1;
+
+  l4_thread_control_start();
+  l4_thread_control_pager(L4_BASE_PAGER_CAP);
+  l4_thread_control_exc_handler(L4_BASE_PAGER_CAP);
+  l4_thread_control_bind(u, L4_BASE_TASK_CAP);
+  if (l4_error(l4_thread_control_commit(Server_cap)))
+    return -1;
+
+  return l4_error(l4_thread_ex_regs(Server_cap, (l4_umword_t)server,
+                                    (l4_umword_t)(server_stack
+                                                  + sizeof(server_stack)),
+                                    0));
+}
+
+static l4_msgtag_t
+call(l4_utcb_t *u)
+{
+  l4_utcb_mr_u(u)->mr[0] = 0;
+  return l4_ipc_call(Server_cap, u, l4_msgtag(0, 1, 0, 0), L4_IPC_NEVER);
+}
+
+static void
+bench(void)
+{
+  l4_utcb_t *u = l4_utcb();
+  l4_cpu_time_t start, end;
+  unsigned i;
+
+  if (l4_ipc_error(call(u), u))
+    {
+      printf("  IPC error %lx\n", l4_utcb_tcr_u(u)->error);
+      return;
+    }
+
+  start = l4_rdtsc();
+  for (i = 0; i < Rounds; ++i)
+    call(u);
+  end = l4_rdtsc();
+
+  printf("  %llu cycles per round trip\n",
+         (unsigned long long)(end - start) / Rounds);
+}
+
+int
+main(void)
+{
+  if (start_server())
+    {
+      printf("uxipc: cannot start server thread\n");
+      exit(1);
+    }
+
+  printf("same-CPU IPC, %d round trips:\n", Rounds);
+  bench();
+
+  exit(0);
+}
@@ -160,6 +160,90 @@ L4_INLINE l4_msgtag_t
 l4_debugger_switch_log_u(l4_cap_idx_t cap, const char *name, int on_off,
                          l4_utcb_t *utcb) L4_NOTHROW;
 
+/**
+ * \brief Consumer state of one trace-buffer ring for a streaming
+ *        collector (keep in sync with fiasco/src/jabi/jdb_ktrace.cpp).
+ *
+ * `head` and `tail` count entries; entry n of a ring is in slot
+ * n % (ring_size / entry_size) of the ring.
+ */
+typedef struct l4_debugger_tbuf_export_ring_t
+{
+  l4_umword_t head;     /**< entries committed, written by the kernel */
+  l4_umword_t tail;     /**< entries consumed, written by the collector */
+  l4_umword_t dropped;  /**< entries overwritten before they were consumed */
+  l4_umword_t notified; /**< high-watermark IRQs raised for this ring */
+} l4_debugger_tbuf_export_ring_t;
+
+/**
+ * \brief Location of the trace-buffer rings in the collector's task.
+ */
+typedef struct l4_debugger_tbuf_export_info_t
+{
+  l4_addr_t     rings;      /**< address of the first ring */
+  unsigned long ring_size;  /**< distance between rings in bytes */
+  unsigned long entry_size; /**< size of one entry in bytes */
+  unsigned long num_rings;  /**< number of rings (one per CPU) */
+} l4_debugger_tbuf_export_info_t;
+
+/**
+ * \brief Attach a streaming collector to the trace buffer.
+ *
+ * \param irq        IRQ triggered when a ring fills up to the watermark.
+ * \param rings      One consumer state per ring, `info->num_rings` of
+ *                   them, in one kernel-user memory area of the calling
+ *                   task (see l4_task_add_ku_mem()).
+ *                   0 detaches the current collector.
+ * \param watermark  Fill level in entries, 0 for half a ring.
+ * \param info       Receives the location of the rings, may be 0.
+ *
+ * \return 0 for success, -L4_EPERM when detaching from a task other
+ *         than the attached collector, negative error code otherwise
+ *
+ * Attaching replaces the current collector.  Use
+ * l4_debugger_tbuf_export_info() to learn the number of rings before
+ * setting up the consumer states.  This is a debugging facility, the
+ * call might be invalid.
+ */
+L4_INLINE int
+l4_debugger_tbuf_export(l4_cap_idx_t irq,
+                        l4_debugger_tbuf_export_ring_t *rings,
+                        unsigned long watermark,
+                        l4_debugger_tbuf_export_info_t *info) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE int
+l4_debugger_tbuf_export_u(l4_cap_idx_t irq,
+                          l4_debugger_tbuf_export_ring_t *rings,
+                          unsigned long watermark,
+                          l4_debugger_tbuf_export_info_t *info,
+                          l4_utcb_t *utcb) L4_NOTHROW;
+
+/**
+ * \brief Query the location of the trace-buffer rings.
+ *
+ * \param cap   Capability for the debugger protocol.
+ * \param info  Receives the location of the rings.
+ *
+ * \return 0 for success, negative error code otherwise
+ *
+ * Does not change the attached collector.  This is a debugging facility,
+ * the call might be invalid.
+ */
+L4_INLINE int
+l4_debugger_tbuf_export_info(l4_cap_idx_t cap,
+                             l4_debugger_tbuf_export_info_t *info) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE int
+l4_debugger_tbuf_export_info_u(l4_cap_idx_t cap,
+                               l4_debugger_tbuf_export_info_t *info,
+                               l4_utcb_t *utcb) L4_NOTHROW;
+
 enum
 {
   L4_DEBUGGER_NAME_SET_OP         = 0UL,
@@ -169,6 +253,8 @@ enum
   L4_DEBUGGER_SWITCH_LOG_OP       = 4UL,
   L4_DEBUGGER_NAME_GET_OP         = 5UL,
   L4_DEBUGGER_QUERY_LOG_NAME_OP   = 6UL,
+  L4_DEBUGGER_TBUF_EXPORT_OP      = 7UL,
+  L4_DEBUGGER_TBUF_EXPORT_INFO_OP = 8UL,
 };
 
 enum
@@ -286,6 +372,48 @@ l4_debugger_get_object_name_u(l4_cap_idx_t cap, unsigned id,
 }
 
 
+L4_INLINE int
+l4_debugger_tbuf_export_u(l4_cap_idx_t irq,
+                          l4_debugger_tbuf_export_ring_t *rings,
+                          unsigned long watermark,
+                          l4_debugger_tbuf_export_info_t *info,
+                          l4_utcb_t *utcb) L4_NOTHROW
+{
+  int e;
+  l4_utcb_mr_u(utcb)->mr[0] = L4_DEBUGGER_TBUF_EXPORT_OP;
+  l4_utcb_mr_u(utcb)->mr[1] = (l4_umword_t)rings;
+  l4_utcb_mr_u(utcb)->mr[2] = watermark;
+  e = l4_error_u(l4_invoke_debugger(irq, l4_msgtag(0, 3, 0, 0), utcb), utcb);
+  if (e < 0)
+    return e;
+  if (info)
+    {
+      info->rings      = l4_utcb_mr_u(utcb)->mr[0];
+      info->ring_size  = l4_utcb_mr_u(utcb)->mr[1];
+      info->entry_size = l4_utcb_mr_u(utcb)->mr[2];
+      info->num_rings  = l4_utcb_mr_u(utcb)->mr[3];
+    }
+  return 0;
+}
+
+L4_INLINE int
+l4_debugger_tbuf_export_info_u(l4_cap_idx_t cap,
+                               l4_debugger_tbuf_export_info_t *info,
+                               l4_utcb_t *utcb) L4_NOTHROW
+{
+  int e;
+  l4_utcb_mr_u(utcb)->mr[0] = L4_DEBUGGER_TBUF_EXPORT_INFO_OP;
+  e = l4_error_u(l4_invoke_debugger(cap, l4_msgtag(0, 1, 0, 0), utcb), utcb);
+  if (e < 0)
+    return e;
+  info->rings      = l4_utcb_mr_u(utcb)->mr[0];
+  info->ring_size  = l4_utcb_mr_u(utcb)->mr[1];
+  info->entry_size = l4_utcb_mr_u(utcb)->mr[2];
+  info->num_rings  = l4_utcb_mr_u(utcb)->mr[3];
+  return 0;
+}
+
+
 L4_INLINE l4_msgtag_t
 l4_debugger_set_object_name(unsigned long cap,
                             const char *name) L4_NOTHROW
@@ -334,3 +462,19 @@ l4_debugger_get_object_name(l4_cap_idx_t cap, unsigned id,
 {
   return l4_debugger_get_object_name_u(cap, id, name, size, l4_utcb());
 }
+
+L4_INLINE int
+l4_debugger_tbuf_export(l4_cap_idx_t irq,
+                        l4_debugger_tbuf_export_ring_t *rings,
+                        unsigned long watermark,
+                        l4_debugger_tbuf_export_info_t *info) L4_NOTHROW
+{
+  return l4_debugger_tbuf_export_u(irq, rings, watermark, info, l4_utcb());
+}
+
+L4_INLINE int
+l4_debugger_tbuf_export_info(l4_cap_idx_t cap,
+                             l4_debugger_tbuf_export_info_t *info) L4_NOTHROW
+{
+  return l4_debugger_tbuf_export_info_u(cap, info, l4_utcb());
+}
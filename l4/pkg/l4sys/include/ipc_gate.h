@@ -66,6 +66,86 @@ l4_ipc_gate_get_infos(l4_cap_idx_t gate, l4_umword_t *label);
 L4_INLINE l4_msgtag_t
 l4_ipc_gate_get_infos_u(l4_cap_idx_t gate, l4_umword_t *label, l4_utcb_t *utcb);
 
+/**
+ * \brief Overflow policies of the asynchronous send queue of an IPC-gate.
+ * \ingroup l4_kernel_object_gate_api
+ */
+enum L4_ipc_gate_queue_policy
+{
+  /** A send to a full queue fails with #L4_IPC_SETIMEOUT. */
+  L4_IPC_GATE_QUEUE_REJECT      = 0,
+  /** A send to a full queue overwrites the oldest queued message. */
+  L4_IPC_GATE_QUEUE_DROP_OLDEST = 1,
+  /** A send to a full queue waits for the bound thread as usual. */
+  L4_IPC_GATE_QUEUE_SYNC        = 2,
+};
+
+/**
+ * \brief Statistics of the asynchronous send queue of an IPC-gate.
+ * \ingroup l4_kernel_object_gate_api
+ */
+typedef struct l4_ipc_gate_queue_stats_t
+{
+  l4_umword_t slots;     /**< Size of the queue in messages. */
+  l4_umword_t depth;     /**< Messages currently queued. */
+  l4_umword_t max_depth; /**< Highest number of queued messages. */
+  l4_umword_t sent;      /**< Messages queued. */
+  l4_umword_t delivered; /**< Messages received by the bound thread. */
+  l4_umword_t dropped;   /**< Messages rejected or overwritten. */
+} l4_ipc_gate_queue_stats_t;
+
+/**
+ * \brief Set up an asynchronous send queue for the IPC-gate.
+ * \ingroup l4_kernel_object_gate_api
+ *
+ * \param gate    IPC-gate.
+ * \param slots   Minimum number of messages the queue shall hold, at most
+ *                1024.  The kernel rounds it up to a power of two.
+ * \param policy  What to do when the queue is full, see
+ *                #L4_ipc_gate_queue_policy.
+ *
+ * \return System call return tag.
+ *
+ * With a queue, send-only IPC (l4_ipc_send()) to the gate with no items
+ * and at most 6 words does not wait for the bound thread: the message is
+ * copied into the queue and the bound thread receives it in one of its
+ * next receive operations, with the label of the gate.  Other IPC to the
+ * gate is synchronous as usual.  The queue cannot be resized once it
+ * exists, later calls only change the overflow policy.  Its memory is
+ * accounted to the quota the gate was created with.
+ */
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_set_queue(l4_cap_idx_t gate, unsigned slots, unsigned policy);
+
+/**
+ * \internal
+ * \ingroup l4_kernel_object_gate_api
+ */
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_set_queue_u(l4_cap_idx_t gate, unsigned slots, unsigned policy,
+                        l4_utcb_t *utcb);
+
+/**
+ * \brief Get the statistics of the asynchronous send queue of the IPC-gate.
+ * \ingroup l4_kernel_object_gate_api
+ *
+ * \param gate    IPC-gate.
+ * \retval stats  Queue statistics.
+ *
+ * \return System call return tag, the label is -L4_ENOENT if the gate has
+ *         no queue.
+ */
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_queue_stats(l4_cap_idx_t gate, l4_ipc_gate_queue_stats_t *stats);
+
+/**
+ * \internal
+ * \ingroup l4_kernel_object_gate_api
+ */
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_queue_stats_u(l4_cap_idx_t gate, l4_ipc_gate_queue_stats_t *stats,
+                          l4_utcb_t *utcb);
+
 /**
  * \brief Operations on the IPC-gate.
  * \ingroup l4_kernel_object_gate_api
@@ -76,6 +156,8 @@ enum L4_ipc_gate_ops
 {
   L4_IPC_GATE_BIND_OP     = 0x10, /**< Bind operation */
   L4_IPC_GATE_GET_INFO_OP = 0x11, /**< Info operation */
+  L4_IPC_GATE_SET_QUEUE_OP   = 0x12, /**< Set up the send queue */
+  L4_IPC_GATE_QUEUE_STATS_OP = 0x13, /**< Send queue statistics */
 };
 
 
@@ -112,6 +194,40 @@ l4_ipc_gate_get_infos_u(l4_cap_idx_t gate, l4_umword_t *label, l4_utcb_t *utcb)
 }
 
 
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_set_queue_u(l4_cap_idx_t gate, unsigned slots, unsigned policy,
+                        l4_utcb_t *utcb)
+{
+  l4_msg_regs_t *m = l4_utcb_mr_u(utcb);
+  m->mr[0] = L4_IPC_GATE_SET_QUEUE_OP;
+  m->mr[1] = slots;
+  m->mr[2] = policy;
+  return l4_ipc_call(gate, utcb, l4_msgtag(L4_PROTO_KOBJECT, 3, 0, 0),
+                     L4_IPC_NEVER);
+}
+
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_queue_stats_u(l4_cap_idx_t gate, l4_ipc_gate_queue_stats_t *stats,
+                          l4_utcb_t *utcb)
+{
+  l4_msgtag_t tag;
+  l4_msg_regs_t *m = l4_utcb_mr_u(utcb);
+  m->mr[0] = L4_IPC_GATE_QUEUE_STATS_OP;
+  tag = l4_ipc_call(gate, utcb, l4_msgtag(L4_PROTO_KOBJECT, 1, 0, 0),
+                    L4_IPC_NEVER);
+  if (!l4_msgtag_has_error(tag) && l4_msgtag_label(tag) >= 0)
+    {
+      stats->slots     = m->mr[0];
+      stats->depth     = m->mr[1];
+      stats->max_depth = m->mr[2];
+      stats->sent      = m->mr[3];
+      stats->delivered = m->mr[4];
+      stats->dropped   = m->mr[5];
+    }
+
+  return tag;
+}
+
 
 L4_INLINE l4_msgtag_t
 l4_ipc_gate_bind_thread(l4_cap_idx_t gate, l4_cap_idx_t thread,
@@ -125,3 +241,15 @@ l4_ipc_gate_get_infos(l4_cap_idx_t gate, l4_umword_t *label)
 {
   return l4_ipc_gate_get_infos_u(gate, label, l4_utcb());
 }
+
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_set_queue(l4_cap_idx_t gate, unsigned slots, unsigned policy)
+{
+  return l4_ipc_gate_set_queue_u(gate, slots, policy, l4_utcb());
+}
+
+L4_INLINE l4_msgtag_t
+l4_ipc_gate_queue_stats(l4_cap_idx_t gate, l4_ipc_gate_queue_stats_t *stats)
+{
+  return l4_ipc_gate_queue_stats_u(gate, stats, l4_utcb());
+}
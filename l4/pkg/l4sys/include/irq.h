@@ -199,6 +199,47 @@ l4_irq_unmask(l4_cap_idx_t irq) L4_NOTHROW;
 L4_INLINE l4_msgtag_t
 l4_irq_unmask_u(l4_cap_idx_t irq, l4_utcb_t *utcb) L4_NOTHROW;
 
+/**
+ * \brief Flags for l4_irq_coalesce().
+ * \ingroup l4_irq_api
+ */
+enum L4_irq_coalesce_flags
+{
+  /** Keep the IRQ masked from a notification until the next unmask. */
+  L4_IRQ_COALESCE_MASK  = 1,
+  /** Do not change the configuration, only return the statistics. */
+  L4_IRQ_COALESCE_QUERY = 2,
+};
+
+/**
+ * \brief Configure interrupt coalescing for an edge-triggered IRQ.
+ * \ingroup l4_irq_api
+ * \param irq        IRQ to configure.
+ * \param max_count  Deliver a notification after this many interrupts,
+ *                   0 for no count threshold.
+ * \param usecs      Deliver a notification at most this many
+ *                   microseconds after the first interrupt of a batch,
+ *                   0 for no time threshold.
+ * \param flags      Flags, see #L4_irq_coalesce_flags.
+ * \return Syscall return tag
+ *
+ * With coalescing enabled the IRQ sends one notification for a batch of
+ * interrupts; MR0 of the notification holds the number of interrupts in
+ * the batch.  A \a max_count of 0 or 1 together with a \a usecs of 0
+ * switches coalescing off.  On return MR0 to MR2 hold the number of
+ * interrupts, of notifications and the largest batch so far.
+ */
+L4_INLINE l4_msgtag_t
+l4_irq_coalesce(l4_cap_idx_t irq, l4_umword_t max_count, l4_umword_t usecs,
+                unsigned flags) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_irq_coalesce_u(l4_cap_idx_t irq, l4_umword_t max_count, l4_umword_t usecs,
+                  unsigned flags, l4_utcb_t *utcb) L4_NOTHROW;
+
 /**
  * \internal
  */
@@ -208,6 +249,7 @@ enum L4_irq_op
   L4_IRQ_OP_TRIGGER   = 2,
   L4_IRQ_OP_CHAIN     = 3,
   L4_IRQ_OP_EOI       = 4,
+  L4_IRQ_OP_COALESCE  = 5,
 };
 
 /**************************************************************************
@@ -276,6 +318,17 @@ l4_irq_unmask_u(l4_cap_idx_t irq, l4_utcb_t *utcb) L4_NOTHROW
   return l4_ipc_send(irq, utcb, l4_msgtag(L4_PROTO_IRQ, 1, 0, 0), L4_IPC_NEVER);
 }
 
+L4_INLINE l4_msgtag_t
+l4_irq_coalesce_u(l4_cap_idx_t irq, l4_umword_t max_count, l4_umword_t usecs,
+                  unsigned flags, l4_utcb_t *utcb) L4_NOTHROW
+{
+  l4_msg_regs_t *m = l4_utcb_mr_u(utcb);
+  m->mr[0] = L4_IRQ_OP_COALESCE | (flags << 16);
+  m->mr[1] = max_count;
+  m->mr[2] = usecs;
+  return l4_ipc_call(irq, utcb, l4_msgtag(L4_PROTO_IRQ, 3, 0, 0), L4_IPC_NEVER);
+}
+
 
 L4_INLINE l4_msgtag_t
 l4_irq_attach(l4_cap_idx_t irq, l4_umword_t label,
@@ -322,3 +375,10 @@ l4_irq_unmask(l4_cap_idx_t irq) L4_NOTHROW
   return l4_irq_unmask_u(irq, l4_utcb());
 }
 
+L4_INLINE l4_msgtag_t
+l4_irq_coalesce(l4_cap_idx_t irq, l4_umword_t max_count, l4_umword_t usecs,
+                unsigned flags) L4_NOTHROW
+{
+  return l4_irq_coalesce_u(irq, max_count, usecs, flags, l4_utcb());
+}
+
@@ -69,6 +69,67 @@ L4_INLINE l4_msgtag_t
 l4_task_map_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
               l4_fpage_t const snd_fpage, l4_addr_t snd_base, l4_utcb_t *utcb) L4_NOTHROW;
 
+/**
+ * \brief Map several resources of the source task to a destination task.
+ * \ingroup l4_task_api
+ *
+ * \param dst_task      Capability selector of destination task
+ * \param src_task      Capability selector of source task
+ * \param snd_fpages    Array of send flexpages in the source task
+ * \param snd_bases     Array of send bases, one per send flexpage
+ * \param num_fpages    Number of send flexpages
+ *
+ * \return Syscall return tag
+ *
+ * All flexpages are mapped in one call, with a single TLB flush at the
+ * end.  Mapping stops at the first flexpage that fails; then the tag has
+ * the error flag set and MR0 holds the number of flexpages mapped before.
+ *
+ * \pre num_fpages is at least 1 and not bigger than
+ *      (L4_UTCB_GENERIC_DATA_SIZE - 3) / 2.
+ */
+L4_INLINE l4_msgtag_t
+l4_task_map_batch(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                  l4_fpage_t const *snd_fpages, l4_addr_t const *snd_bases,
+                  unsigned num_fpages) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_task_map_batch_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                    l4_fpage_t const *snd_fpages, l4_addr_t const *snd_bases,
+                    unsigned num_fpages, l4_utcb_t *u) L4_NOTHROW;
+
+/**
+ * \brief Map a vector of resources in kernel-user memory to a
+ *        destination task.
+ * \ingroup l4_task_api
+ *
+ * \param dst_task      Capability selector of destination task
+ * \param src_task      Capability selector of source task
+ * \param vec           num pairs of send base and send flexpage (raw),
+ *                      in kernel-user memory of the calling task
+ * \param num           Number of pairs
+ *
+ * \return Syscall return tag
+ *
+ * Like l4_task_map_batch(), but the number of flexpages is not limited by
+ * the size of the UTCB.  On error, MR0 holds the number of pairs mapped
+ * before the failing one.
+ */
+L4_INLINE l4_msgtag_t
+l4_task_map_ku_batch(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                     l4_umword_t const *vec, unsigned num) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_task_map_ku_batch_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                       l4_umword_t const *vec, unsigned num,
+                       l4_utcb_t *u) L4_NOTHROW;
+
 /**
  * \brief Revoke rights from the task.
  * \ingroup l4_task_api
@@ -133,6 +194,35 @@ l4_task_unmap_batch_u(l4_cap_idx_t task, l4_fpage_t const *fpages,
                       unsigned num_fpages, unsigned long map_mask,
                       l4_utcb_t *u) L4_NOTHROW;
 
+/**
+ * \brief Revoke rights from a task, for a vector of flexpages in
+ *        kernel-user memory.
+ * \ingroup l4_task_api
+ *
+ * \param task          Capability selector of destination task
+ * \param fpages        Array of num_fpages flexpages in kernel-user memory
+ *                      of the calling task
+ * \param num_fpages    Number of flexpages
+ * \param map_mask      Unmap mask, see #l4_unmap_flags_t
+ *
+ * \return Syscall return tag
+ *
+ * Like l4_task_unmap_batch(), but the number of flexpages is not limited
+ * by the size of the UTCB.  The rights bits of each flexpage in the array
+ * are replaced by the access rights flushed from it.
+ */
+L4_INLINE l4_msgtag_t
+l4_task_unmap_ku_batch(l4_cap_idx_t task, l4_fpage_t *fpages,
+                       unsigned num_fpages, unsigned long map_mask) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_task_unmap_ku_batch_u(l4_cap_idx_t task, l4_fpage_t *fpages,
+                         unsigned num_fpages, unsigned long map_mask,
+                         l4_utcb_t *u) L4_NOTHROW;
+
 /**
  * \brief Release capability and delete object.
  * \ingroup l4_task_api
@@ -250,6 +340,28 @@ l4_task_add_ku_mem_u(l4_cap_idx_t task, l4_fpage_t const ku_mem,
 L4_INLINE l4_msgtag_t
 l4_task_add_ku_mem(l4_cap_idx_t task, l4_fpage_t const ku_mem) L4_NOTHROW;
 
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_task_alloc_caps_u(l4_cap_idx_t task, l4_fpage_t const caps,
+                     l4_utcb_t *u) L4_NOTHROW;
+
+/**
+ * \brief Allocate the kernel memory for a capability range.
+ * \ingroup l4_task_api
+ *
+ * \param task   Capability selector of the task
+ * \param caps   Object flexpage describing the capability range.
+ *
+ * \return Syscall return tag
+ *
+ * Later mappings into the range do not need to allocate kernel memory.
+ * The memory is charged to the quota of the task.
+ */
+L4_INLINE l4_msgtag_t
+l4_task_alloc_caps(l4_cap_idx_t task, l4_fpage_t const caps) L4_NOTHROW;
+
 
 /**
  * \internal
@@ -269,6 +381,9 @@ enum L4_task_ops
   L4_TASK_UNMAP_OP       = 1UL,    /**< Unmap */
   L4_TASK_CAP_INFO_OP    = 2UL,    /**< Cap info */
   L4_TASK_ADD_KU_MEM_OP  = 3UL,    /**< Add kernel-user memory */
+  L4_TASK_MAP_BATCH_OP   = 4UL,    /**< Map vector in kernel-user memory */
+  L4_TASK_UNMAP_BATCH_OP = 5UL,    /**< Unmap vector in kernel-user memory */
+  L4_TASK_ALLOC_CAPS_OP  = 6UL,    /**< Allocate capability range */
   L4_TASK_LDT_SET_X86_OP = 0x11UL, /**< x86: LDT set */
 };
 
@@ -291,6 +406,38 @@ l4_task_map_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
   return l4_ipc_call(dst_task, u, l4_msgtag(L4_PROTO_TASK, 3, 1, 0), L4_IPC_NEVER);
 }
 
+L4_INLINE l4_msgtag_t
+l4_task_map_batch_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                    l4_fpage_t const *snd_fpages, l4_addr_t const *snd_bases,
+                    unsigned num_fpages, l4_utcb_t *u) L4_NOTHROW
+{
+  l4_msg_regs_t *v = l4_utcb_mr_u(u);
+  unsigned i, w = 1;
+  v->mr[0] = L4_TASK_MAP_OP;
+  for (i = 0; i < num_fpages; ++i, w += 2)
+    {
+      v->mr[w] = snd_bases[i];
+      v->mr[w + 1] = snd_fpages[i].raw;
+    }
+  v->mr[w] = l4_map_obj_control(0,0);
+  v->mr[w + 1] = l4_obj_fpage(src_task, 0, L4_FPAGE_RWX).raw;
+  return l4_ipc_call(dst_task, u, l4_msgtag(L4_PROTO_TASK, w, 1, 0), L4_IPC_NEVER);
+}
+
+L4_INLINE l4_msgtag_t
+l4_task_map_ku_batch_u(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                       l4_umword_t const *vec, unsigned num,
+                       l4_utcb_t *u) L4_NOTHROW
+{
+  l4_msg_regs_t *v = l4_utcb_mr_u(u);
+  v->mr[0] = L4_TASK_MAP_BATCH_OP;
+  v->mr[1] = (l4_umword_t)vec;
+  v->mr[2] = num;
+  v->mr[3] = l4_map_obj_control(0,0);
+  v->mr[4] = l4_obj_fpage(src_task, 0, L4_FPAGE_RWX).raw;
+  return l4_ipc_call(dst_task, u, l4_msgtag(L4_PROTO_TASK, 3, 1, 0), L4_IPC_NEVER);
+}
+
 L4_INLINE l4_msgtag_t
 l4_task_unmap_u(l4_cap_idx_t task, l4_fpage_t const fpage,
                 unsigned long map_mask, l4_utcb_t *u) L4_NOTHROW
@@ -314,6 +461,19 @@ l4_task_unmap_batch_u(l4_cap_idx_t task, l4_fpage_t const *fpages,
   return l4_ipc_call(task, u, l4_msgtag(L4_PROTO_TASK, 2 + num_fpages, 0, 0), L4_IPC_NEVER);
 }
 
+L4_INLINE l4_msgtag_t
+l4_task_unmap_ku_batch_u(l4_cap_idx_t task, l4_fpage_t *fpages,
+                         unsigned num_fpages, unsigned long map_mask,
+                         l4_utcb_t *u) L4_NOTHROW
+{
+  l4_msg_regs_t *v = l4_utcb_mr_u(u);
+  v->mr[0] = L4_TASK_UNMAP_BATCH_OP;
+  v->mr[1] = (l4_umword_t)fpages;
+  v->mr[2] = num_fpages;
+  v->mr[3] = map_mask;
+  return l4_ipc_call(task, u, l4_msgtag(L4_PROTO_TASK, 4, 0, 0), L4_IPC_NEVER);
+}
+
 L4_INLINE l4_msgtag_t
 l4_task_cap_valid_u(l4_cap_idx_t task, l4_cap_idx_t cap, l4_utcb_t *u) L4_NOTHROW
 {
@@ -353,6 +513,16 @@ l4_task_add_ku_mem_u(l4_cap_idx_t task, l4_fpage_t const ku_mem,
   return l4_ipc_call(task, u, l4_msgtag(L4_PROTO_TASK, 2, 0, 0), L4_IPC_NEVER);
 }
 
+L4_INLINE l4_msgtag_t
+l4_task_alloc_caps_u(l4_cap_idx_t task, l4_fpage_t const caps,
+                     l4_utcb_t *u) L4_NOTHROW
+{
+  l4_msg_regs_t *v = l4_utcb_mr_u(u);
+  v->mr[0] = L4_TASK_ALLOC_CAPS_OP;
+  v->mr[1] = caps.raw;
+  return l4_ipc_call(task, u, l4_msgtag(L4_PROTO_TASK, 2, 0, 0), L4_IPC_NEVER);
+}
+
 
 
 L4_INLINE l4_msgtag_t
@@ -362,6 +532,22 @@ l4_task_map(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
   return l4_task_map_u(dst_task, src_task, snd_fpage, snd_base, l4_utcb());
 }
 
+L4_INLINE l4_msgtag_t
+l4_task_map_batch(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                  l4_fpage_t const *snd_fpages, l4_addr_t const *snd_bases,
+                  unsigned num_fpages) L4_NOTHROW
+{
+  return l4_task_map_batch_u(dst_task, src_task, snd_fpages, snd_bases,
+                             num_fpages, l4_utcb());
+}
+
+L4_INLINE l4_msgtag_t
+l4_task_map_ku_batch(l4_cap_idx_t dst_task, l4_cap_idx_t src_task,
+                     l4_umword_t const *vec, unsigned num) L4_NOTHROW
+{
+  return l4_task_map_ku_batch_u(dst_task, src_task, vec, num, l4_utcb());
+}
+
 L4_INLINE l4_msgtag_t
 l4_task_unmap(l4_cap_idx_t task, l4_fpage_t const fpage,
               unsigned long map_mask) L4_NOTHROW
@@ -377,6 +563,14 @@ l4_task_unmap_batch(l4_cap_idx_t task, l4_fpage_t const *fpages,
                                l4_utcb());
 }
 
+L4_INLINE l4_msgtag_t
+l4_task_unmap_ku_batch(l4_cap_idx_t task, l4_fpage_t *fpages,
+                       unsigned num_fpages, unsigned long map_mask) L4_NOTHROW
+{
+  return l4_task_unmap_ku_batch_u(task, fpages, num_fpages, map_mask,
+                                  l4_utcb());
+}
+
 L4_INLINE l4_msgtag_t
 l4_task_delete_obj_u(l4_cap_idx_t task, l4_cap_idx_t obj,
                      l4_utcb_t *u) L4_NOTHROW
@@ -430,3 +624,9 @@ l4_task_add_ku_mem(l4_cap_idx_t task, l4_fpage_t const ku_mem) L4_NOTHROW
 {
   return l4_task_add_ku_mem_u(task, ku_mem, l4_utcb());
 }
+
+L4_INLINE l4_msgtag_t
+l4_task_alloc_caps(l4_cap_idx_t task, l4_fpage_t const caps) L4_NOTHROW
+{
+  return l4_task_alloc_caps_u(task, caps, l4_utcb());
+}
@@ -168,6 +168,24 @@ L4_INLINE l4_msg_regs_t *l4_utcb_mr(void) L4_NOTHROW L4_PURE;
  */
 L4_INLINE l4_msg_regs_t *l4_utcb_mr_u(l4_utcb_t *u) L4_NOTHROW L4_PURE;
 
+/**
+ * \brief Get the fault-around window of a page-fault message.
+ * \ingroup l4_utcb_mr_api
+ *
+ * \param tag  Tag of the page-fault message.
+ * \param mr   Message registers holding the page-fault message.
+ * \return Aligned memory flex page around the fault address, or an
+ *         invalid flex page if the message carries no window.
+ *
+ * The kernel suggests a window around the fault address in the third
+ * word of page-fault messages.  The pager may reply with a mapping of
+ * any part of the window instead of just the faulting page, which saves
+ * the page faults on the neighbouring pages.  If no page table covers
+ * the fault address yet, the window is a whole superpage.
+ */
+L4_INLINE l4_fpage_t
+l4_pf_around_window(l4_msgtag_t tag, l4_msg_regs_t const *mr) L4_NOTHROW;
+
 /**
  * \brief Get the buffer-register block of a UTCB.
  * \ingroup l4_utcb_api
@@ -316,6 +334,14 @@ unsigned l4_utcb_mr64_idx(unsigned idx) L4_NOTHROW;
 L4_INLINE l4_msg_regs_t *l4_utcb_mr_u(l4_utcb_t *u) L4_NOTHROW
 { return (l4_msg_regs_t*)((char*)u + L4_UTCB_MSG_REGS_OFFSET); }
 
+L4_INLINE l4_fpage_t
+l4_pf_around_window(l4_msgtag_t tag, l4_msg_regs_t const *mr) L4_NOTHROW
+{
+  l4_fpage_t fp;
+  fp.raw = l4_msgtag_words(tag) > 2 ? mr->mr[2] : 0;
+  return fp;
+}
+
 L4_INLINE l4_buf_regs_t *l4_utcb_br_u(l4_utcb_t *u) L4_NOTHROW
 { return (l4_buf_regs_t*)((char*)u + L4_UTCB_BUF_REGS_OFFSET); }
 
@@ -108,6 +108,81 @@ L4_INLINE int
 l4_vcon_read_u(l4_cap_idx_t vcon, char *buf, int size, l4_utcb_t *utcb) L4_NOTHROW;
 
 
+/**
+ * \brief Log ring shared between a task and the kernel vcon.
+ * \ingroup l4_vcon_api
+ *
+ * The ring lives in kernel-user memory of the task (see
+ * l4_task_add_ku_mem()) and is followed by its data area of
+ * 2^order bytes.  The task appends at \a head with l4_vcon_ring_write(),
+ * the kernel consumes at \a tail.  Both are free-running byte counters.
+ * The kernel prints the ring when the CPU becomes idle or on
+ * l4_vcon_ring_doorbell().
+ */
+typedef struct l4_vcon_ring_t
+{
+  l4_umword_t head; ///< producer index, written by the task
+  l4_umword_t tail; ///< consumer index, written by the kernel
+} l4_vcon_ring_t;
+
+/**
+ * \brief Register a log ring with the kernel vcon.
+ * \ingroup l4_vcon_api
+ *
+ * \param vcon    Kernel vcon object.
+ * \param ring    Log ring in kernel-user memory of the calling task, or
+ *                0 to unregister the current ring.
+ * \param order   Log2 of the size of the data area (6..20).
+ *
+ * \return Syscall return tag
+ *
+ * A newly registered ring replaces the ring registered before.
+ */
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_register(l4_cap_idx_t vcon, l4_vcon_ring_t *ring,
+                      unsigned order) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_register_u(l4_cap_idx_t vcon, l4_vcon_ring_t *ring,
+                        unsigned order, l4_utcb_t *utcb) L4_NOTHROW;
+
+/**
+ * \brief Append data to a log ring.
+ * \ingroup l4_vcon_api
+ *
+ * \param ring    Log ring.
+ * \param order   Log2 of the size of the data area.
+ * \param buf     Pointer to data buffer.
+ * \param size    Size of buffer in bytes.
+ *
+ * \return Number of bytes appended, less than \a size if the ring is full.
+ *
+ * Only one thread may write to a ring at a time.
+ */
+L4_INLINE int
+l4_vcon_ring_write(l4_vcon_ring_t *ring, unsigned order,
+                   char const *buf, int size) L4_NOTHROW;
+
+/**
+ * \brief Ask the kernel vcon to print its log ring now.
+ * \ingroup l4_vcon_api
+ *
+ * \param vcon    Kernel vcon object.
+ *
+ * \return Syscall return tag
+ */
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_doorbell(l4_cap_idx_t vcon) L4_NOTHROW;
+
+/**
+ * \internal
+ */
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_doorbell_u(l4_cap_idx_t vcon, l4_utcb_t *utcb) L4_NOTHROW;
+
 /**
  * \brief Vcon attribute structure.
  * \ingroup l4_vcon_api
@@ -200,6 +275,8 @@ enum L4_vcon_ops
   L4_VCON_WRITE_OP       = 0UL,    /**< Write */
   L4_VCON_SET_ATTR_OP    = 2UL,    /**< Get console attributes */
   L4_VCON_GET_ATTR_OP    = 3UL,    /**< Set console attributes */
+  L4_VCON_SET_RING_OP    = 4UL,    /**< Register log ring */
+  L4_VCON_DOORBELL_OP    = 5UL,    /**< Print log ring */
 };
 
 /******* Implementations ********************/
@@ -325,3 +402,63 @@ l4_vcon_get_attr(l4_cap_idx_t vcon, l4_vcon_attr_t *attr) L4_NOTHROW
 {
   return l4_vcon_get_attr_u(vcon, attr, l4_utcb());
 }
+
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_register_u(l4_cap_idx_t vcon, l4_vcon_ring_t *ring,
+                        unsigned order, l4_utcb_t *utcb) L4_NOTHROW
+{
+  l4_msg_regs_t *mr = l4_utcb_mr_u(utcb);
+
+  mr->mr[0] = L4_VCON_SET_RING_OP;
+  mr->mr[1] = (l4_addr_t)ring;
+  mr->mr[2] = order;
+
+  return l4_ipc_call(vcon, utcb,
+                     l4_msgtag(L4_PROTO_LOG, 3, 0, 0),
+                     L4_IPC_NEVER);
+}
+
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_register(l4_cap_idx_t vcon, l4_vcon_ring_t *ring,
+                      unsigned order) L4_NOTHROW
+{
+  return l4_vcon_ring_register_u(vcon, ring, order, l4_utcb());
+}
+
+L4_INLINE int
+l4_vcon_ring_write(l4_vcon_ring_t *ring, unsigned order,
+                   char const *buf, int size) L4_NOTHROW
+{
+  char *data = (char *)(ring + 1);
+  l4_umword_t mask = (1UL << order) - 1;
+  l4_umword_t head = ring->head;
+  l4_umword_t space = mask + 1 - (head - *(l4_umword_t volatile *)&ring->tail);
+  int i;
+
+  if (size < 0)
+    return -L4_EINVAL;
+
+  if ((l4_umword_t)size > space)
+    size = space;
+
+  for (i = 0; i < size; ++i)
+    data[(head + i) & mask] = buf[i];
+
+  __sync_synchronize();
+  *(l4_umword_t volatile *)&ring->head = head + size;
+  return size;
+}
+
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_doorbell_u(l4_cap_idx_t vcon, l4_utcb_t *utcb) L4_NOTHROW
+{
+  l4_utcb_mr_u(utcb)->mr[0] = L4_VCON_DOORBELL_OP;
+  return l4_ipc_send(vcon, utcb, l4_msgtag(L4_PROTO_LOG, 1, 0, 0),
+                     L4_IPC_NEVER);
+}
+
+L4_INLINE l4_msgtag_t
+l4_vcon_ring_doorbell(l4_cap_idx_t vcon) L4_NOTHROW
+{
+  return l4_vcon_ring_doorbell_u(vcon, l4_utcb());
+}
@@ -140,10 +140,24 @@ void map_mem(l4_fpage_t fp, Memory_type fn, l4_umword_t t, Answer *an)
 /* handler for page fault fault requests */
 static
 void
-handle_page_fault(l4_umword_t t, l4_utcb_t *utcb, Answer *answer)
+handle_page_fault(l4_umword_t t, l4_utcb_t *utcb, l4_msgtag_t tag,
+                  Answer *answer)
 {
   unsigned long pfa = l4_utcb_mr_u(utcb)->mr[0] & ~3UL;
+  l4_fpage_t w = l4_pf_around_window(tag, l4_utcb_mr_u(utcb));
 
+  /* map the whole fault-around window if all of it is available */
+  if (l4_fpage_size(w) > L4_LOG2_PAGESIZE)
+    {
+      unsigned long addr
+        = Mem_man::ram()->alloc(Region::bs(l4_fpage_page(w) << L4_PAGESHIFT,
+                                           1UL << l4_fpage_size(w), t));
+      if (addr != ~0UL)
+        {
+          answer->snd_fpage(addr, l4_fpage_size(w));
+          return;
+        }
+    }
 
   unsigned long addr
     = Mem_man::ram()->alloc(Region::bs(l4_trunc_page(pfa), L4_PAGESIZE, t));
@@ -287,7 +301,7 @@ pager(void)
 	      handle_service_request(t, utcb, &answer);
 	      break;
 	    case L4_PROTO_PAGE_FAULT:
-	      handle_page_fault(t, utcb, &answer);
+	      handle_page_fault(t, utcb, tag, &answer);
 	      break;
 	    case L4_PROTO_IO_PAGE_FAULT:
 	      handle_io_page_fault(t, utcb, &answer);